@@ -0,0 +1,134 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* per-packet cost of a chain of N emulation stages, nested as separate
+   shells (every hop a ferry that reads one device and writes the next)
+   versus fused into one ChainQueue (one read and one write in all).
+   Packet pipes stand in for the TUN devices, and every ferry runs on
+   this one thread, so the nested figure leaves out the context switches
+   between ferry processes and is a lower bound. The stages are all
+   "delay 0", so what is measured is the plumbing, not the emulation. */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <memory>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "chain_queue.hh"
+#include "delay_queue.hh"
+#include "ingress_batch.hh"
+#include "egress_batch.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static const unsigned int TOTAL_PACKETS = 200000;
+static const unsigned int BURST_SIZE = 64;
+static const size_t PACKET_SIZE = 1400;
+
+/* a pipe in "packet mode" keeps datagram boundaries, like a TUN device */
+static pair<FileDescriptor, FileDescriptor> packet_pipe( void )
+{
+    int fds[ 2 ];
+    SystemCall( "pipe2", pipe2( fds, O_DIRECT ) );
+    FileDescriptor read_end( fds[ 0 ] ), write_end( fds[ 1 ] );
+    read_end.set_blocking( false );
+
+    /* room for a whole burst (each packet occupies one page) */
+    SystemCall( "fcntl F_SETPIPE_SZ", fcntl( write_end.fd_num(), F_SETPIPE_SZ, 1024 * 1024 ) );
+
+    return make_pair( move( read_end ), move( write_end ) );
+}
+
+/* one ferry: everything waiting on in, through the queue, out */
+template <class QueueType>
+static unsigned int ferry( QueueType & queue, IngressBatch & ingress, EgressBatch & egress,
+                           FileDescriptor & in, FileDescriptor & out )
+{
+    ingress.drain( in );
+    for ( const auto & packet : ingress ) {
+        queue.read_packet( packet );
+    }
+    queue.write_packets( egress );
+    const unsigned int ret = egress.size();
+    egress.flush( out );
+    return ret;
+}
+
+/* ns per packet through the stages, one ferry per hop or all in one */
+static double ns_per_packet( const unsigned int hops, const bool fused )
+{
+    vector<pair<FileDescriptor, FileDescriptor>> devices;
+    for ( unsigned int i = 0; i < ( fused ? 1 : hops ); i++ ) {
+        devices.push_back( packet_pipe() );
+    }
+    FileDescriptor sink( SystemCall( "open /dev/null", open( "/dev/null", O_WRONLY ) ) );
+
+    string pipeline = "delay 0";
+    for ( unsigned int i = 1; i < hops; i++ ) {
+        pipeline += " | delay 0";
+    }
+    ChainQueue chain( ChainQueue::parse( pipeline ), ChainQueue::Direction::Downlink, "" );
+
+    vector<unique_ptr<DelayQueue>> nested;
+    for ( unsigned int i = 0; i < hops; i++ ) {
+        nested.emplace_back( new DelayQueue( 0 ) );
+    }
+
+    IngressBatch ingress( BURST_SIZE );
+    EgressBatch egress;
+    const string packet( PACKET_SIZE, 'x' );
+    uint64_t delivered = 0;
+
+    chrono::steady_clock::duration elapsed = chrono::steady_clock::duration::zero();
+
+    for ( unsigned int sent = 0; sent < TOTAL_PACKETS; sent += BURST_SIZE ) {
+        for ( unsigned int i = 0; i < BURST_SIZE; i++ ) {
+            devices.front().second.write( packet );
+        }
+
+        const auto start = chrono::steady_clock::now();
+
+        if ( fused ) {
+            delivered += ferry( chain, ingress, egress, devices.front().first, sink );
+        } else {
+            unsigned int released = 0;
+            for ( unsigned int i = 0; i < hops; i++ ) {
+                released = ferry( *nested[ i ], ingress, egress, devices[ i ].first,
+                                  i + 1 < hops ? devices[ i + 1 ].second : sink );
+            }
+            delivered += released;
+        }
+
+        elapsed += chrono::steady_clock::now() - start;
+    }
+
+    if ( delivered != TOTAL_PACKETS ) {
+        throw runtime_error( "chain-benchmark: packets went missing" );
+    }
+
+    return chrono::duration<double, nano>( elapsed ).count() / TOTAL_PACKETS;
+}
+
+int main( void )
+{
+    try {
+        cout << "ns per packet through N stages (packetshell-test nests 13)" << endl;
+        cout << setw( 6 ) << "N" << setw( 12 ) << "nested" << setw( 12 ) << "fused" << endl;
+
+        for ( const unsigned int hops : { 1, 2, 4, 8, 13 } ) {
+            const double nested = ns_per_packet( hops, false );
+            const double fused = ns_per_packet( hops, true );
+            cout << setw( 6 ) << hops << fixed << setprecision( 1 )
+                 << setw( 12 ) << nested << setw( 12 ) << fused << endl;
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
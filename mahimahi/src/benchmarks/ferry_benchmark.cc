@@ -0,0 +1,141 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* packets/s through a whole ferry (fd -> DelayQueue -> fd) on one thread,
+   as Ferry::loop runs by default, versus with FerryThreads reading and
+   writing the fds on threads of their own. A thread at either end plays
+   the other side of each TUN device; the one at the far end fails the
+   run if a packet goes missing or comes out of order. The threaded ferry
+   only pulls ahead with a core free for each stage. */
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <memory>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "delay_queue.hh"
+#include "ferry_threads.hh"
+#include "ingress_batch.hh"
+#include "egress_batch.hh"
+#include "poller.hh"
+#include "exception.hh"
+
+using namespace std;
+using namespace PollerShortNames;
+
+static const unsigned int TOTAL_PACKETS = 500000;
+static const unsigned int INGRESS_BATCH_SIZE = 64;
+static const size_t PACKET_SIZE = 1400;
+
+/* a pipe in "packet mode" keeps datagram boundaries, like a TUN device */
+static pair<FileDescriptor, FileDescriptor> packet_pipe( void )
+{
+    int fds[ 2 ];
+    SystemCall( "pipe2", pipe2( fds, O_DIRECT ) );
+    FileDescriptor read_end( fds[ 0 ] ), write_end( fds[ 1 ] );
+
+    SystemCall( "fcntl F_SETPIPE_SZ", fcntl( write_end.fd_num(), F_SETPIPE_SZ, 1024 * 1024 ) );
+
+    return make_pair( move( read_end ), move( write_end ) );
+}
+
+static double packets_per_second( const bool threaded )
+{
+    auto in = packet_pipe(), out = packet_pipe();
+    FileDescriptor & tun = in.first, & sibling = out.second;
+    tun.set_blocking( false );
+
+    DelayQueue queue( 0 );
+
+    const auto start = chrono::steady_clock::now();
+
+    /* the far side of each device: numbered packets in, checked on the way out */
+    thread source( [&] () {
+            string packet( PACKET_SIZE, 'x' );
+            for ( uint32_t i = 0; i < TOTAL_PACKETS; i++ ) {
+                memcpy( &packet[ 0 ], &i, sizeof( i ) );
+                in.second.write( packet );
+            }
+        } );
+
+    bool in_order = true;
+    thread sink( [&] () {
+            for ( uint32_t i = 0; i < TOTAL_PACKETS; i++ ) {
+                const string packet = out.first.read();
+                uint32_t number;
+                memcpy( &number, packet.data(), sizeof( number ) );
+                in_order = in_order and number == i and packet.size() == PACKET_SIZE;
+            }
+        } );
+
+    Poller poller( Poller::Backend::Epoll ); /* as the ferry's loop */
+    EgressBatch egress;
+    uint64_t released = 0;
+
+    if ( threaded ) {
+        FerryThreads threads( tun, sibling, INGRESS_BATCH_SIZE );
+
+        poller.add_action( Poller::Action( threads.arrivals_ready(), Direction::In, [&] () {
+                    threads.deliver_arrivals( queue );
+                    queue.write_packets( egress );
+                    released += egress.size();
+                    threads.depart( egress );
+                    return ResultType::Continue;
+                } ) );
+
+        while ( released < TOTAL_PACKETS ) {
+            poller.poll( -1 );
+        }
+        threads.stop();
+    } else {
+        IngressBatch ingress( INGRESS_BATCH_SIZE );
+
+        poller.add_action( Poller::Action( tun, Direction::In, [&] () {
+                    ingress.drain( tun );
+                    for ( const auto & packet : ingress ) {
+                        queue.read_packet( packet );
+                    }
+                    queue.write_packets( egress );
+                    released += egress.size();
+                    egress.flush( sibling );
+                    return ResultType::Continue;
+                } ) );
+
+        while ( released < TOTAL_PACKETS ) {
+            poller.poll( -1 );
+        }
+    }
+
+    source.join();
+    sink.join();
+
+    const double elapsed = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+    if ( not in_order ) {
+        throw runtime_error( string( threaded ? "threaded" : "single-threaded" )
+                             + " ferry lost or reordered packets" );
+    }
+
+    return TOTAL_PACKETS / elapsed;
+}
+
+int main( void )
+{
+    try {
+        const double single = packets_per_second( false );
+        const double threaded = packets_per_second( true );
+
+        cout << "ferry (DelayQueue, " << PACKET_SIZE << "-byte packets): "
+             << static_cast<uint64_t>( single ) << " pkts/s on one thread, "
+             << static_cast<uint64_t>( threaded ) << " pkts/s on three ("
+             << threaded / single << "x) with " << thread::hardware_concurrency() << " cores" << endl;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
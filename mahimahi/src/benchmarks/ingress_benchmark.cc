@@ -0,0 +1,134 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* packets/s through the ferry's ingress path (fd -> read_packet) for
+   LinkQueue, DelayQueue and LossQueue, reading one packet per wakeup into
+   a fresh string (the old Ferry::loop) versus draining the fd with an
+   IngressBatch of pooled buffers */
+
+#include <iostream>
+#include <chrono>
+#include <memory>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "link_queue.hh"
+#include "delay_queue.hh"
+#include "loss_queue.hh"
+#include "drop_tail_packet_queue.hh"
+#include "ingress_batch.hh"
+#include "egress_batch.hh"
+#include "temp_file.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static const unsigned int TOTAL_PACKETS = 1000000;
+static const unsigned int BURST_SIZE = 64;
+static const size_t PACKET_SIZE = 1400;
+
+/* a pipe in "packet mode" keeps datagram boundaries, like a TUN device */
+static pair<FileDescriptor, FileDescriptor> packet_pipe( void )
+{
+    int fds[ 2 ];
+    SystemCall( "pipe2", pipe2( fds, O_DIRECT ) );
+    FileDescriptor read_end( fds[ 0 ] ), write_end( fds[ 1 ] );
+
+    /* room for a whole burst (each packet occupies one page) */
+    SystemCall( "fcntl F_SETPIPE_SZ", fcntl( write_end.fd_num(), F_SETPIPE_SZ, 1024 * 1024 ) );
+
+    return make_pair( move( read_end ), move( write_end ) );
+}
+
+template <class QueueType>
+double packets_per_second( QueueType & queue, const bool batched )
+{
+    auto pipe = packet_pipe();
+    FileDescriptor & tun = pipe.first;
+    tun.set_blocking( false );
+
+    FileDescriptor sink( SystemCall( "open /dev/null", open( "/dev/null", O_WRONLY ) ) );
+
+    const string packet( PACKET_SIZE, 'x' );
+    IngressBatch ingress( BURST_SIZE );
+    EgressBatch egress;
+    pollfd tun_pollfd { tun.fd_num(), POLLIN, 0 };
+
+    chrono::steady_clock::duration elapsed = chrono::steady_clock::duration::zero();
+
+    for ( unsigned int sent = 0; sent < TOTAL_PACKETS; sent += BURST_SIZE ) {
+        for ( unsigned int i = 0; i < BURST_SIZE; i++ ) {
+            pipe.second.write( packet );
+        }
+
+        const auto start = chrono::steady_clock::now();
+
+        unsigned int received = 0;
+        while ( received < BURST_SIZE ) {
+            SystemCall( "poll", poll( &tun_pollfd, 1, -1 ) );
+
+            if ( batched ) {
+                ingress.drain( tun );
+                for ( const auto & x : ingress ) {
+                    queue.read_packet( x );
+                }
+                received += ingress.size();
+            } else {
+                queue.read_packet( PacketBuffer( tun.read() ) );
+                received++;
+            }
+        }
+
+        if ( queue.pending_output() ) {
+            queue.write_packets( egress );
+            egress.flush( sink );
+        }
+
+        elapsed += chrono::steady_clock::now() - start;
+    }
+
+    return TOTAL_PACKETS / chrono::duration<double>( elapsed ).count();
+}
+
+template <class QueueType>
+void report( const string & name, const function<QueueType *(void)> & make_queue )
+{
+    unique_ptr<QueueType> single( make_queue() ), batch( make_queue() );
+
+    const double before = packets_per_second( *single, false );
+    const double after = packets_per_second( *batch, true );
+
+    cout << name << ": " << static_cast<uint64_t>( before ) << " pkts/s one-per-wakeup, "
+         << static_cast<uint64_t>( after ) << " pkts/s batched ("
+         << after / before << "x)" << endl;
+}
+
+int main( void )
+{
+    try {
+        /* a fast trace (1000 MTU-sized opportunities per ms) so LinkQueue
+           releases packets roughly as quickly as they arrive */
+        TempFile trace( "/tmp/ingress_benchmark_trace" );
+        string trace_contents;
+        for ( unsigned int i = 0; i < 1000; i++ ) {
+            trace_contents += "1\n";
+        }
+        trace.write( trace_contents );
+
+        report<LinkQueue>( "LinkQueue", [&] () {
+                return new LinkQueue( "benchmark", trace.name(), "", false, true, false, false,
+                                      unique_ptr<AbstractPacketQueue>( new DropTailPacketQueue( "packets=1000" ) ),
+                                      "" );
+            } );
+
+        report<DelayQueue>( "DelayQueue", [] () { return new DelayQueue( 0 ); } );
+
+        report<IIDLoss>( "LossQueue", [] () { return new IIDLoss( 0 ); } );
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
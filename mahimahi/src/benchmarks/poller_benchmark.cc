@@ -0,0 +1,111 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* wakeup latency and CPU per wakeup of Poller with the poll(2) and
+   epoll(7) backends, as the number of watched fds grows. One fd at a
+   time is made readable; all the others stay idle, like the listening
+   and signal fds of a shell whose traffic is on one TUN device. */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <memory>
+
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "poller.hh"
+#include "exception.hh"
+
+using namespace std;
+using namespace PollerShortNames;
+
+static const unsigned int WAKEUPS = 20000;
+
+static double cpu_seconds( void )
+{
+    rusage usage;
+    SystemCall( "getrusage", getrusage( RUSAGE_SELF, &usage ) );
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1.0e6;
+}
+
+/* let the process hold as many fds as the hard limit allows */
+static void raise_fd_limit( const unsigned int needed )
+{
+    rlimit limit;
+    SystemCall( "getrlimit", getrlimit( RLIMIT_NOFILE, &limit ) );
+    if ( limit.rlim_cur < needed + 16 ) {
+        limit.rlim_cur = limit.rlim_max;
+        SystemCall( "setrlimit", setrlimit( RLIMIT_NOFILE, &limit ) );
+    }
+    if ( limit.rlim_cur < needed + 16 ) {
+        throw runtime_error( "RLIMIT_NOFILE too low for " + to_string( needed ) + " fds" );
+    }
+}
+
+static void measure( const unsigned int fd_count, const Poller::Backend backend )
+{
+    vector<unique_ptr<FileDescriptor>> fds;
+    for ( unsigned int i = 0; i < fd_count; i++ ) {
+        fds.emplace_back( new FileDescriptor( SystemCall( "eventfd", eventfd( 0, EFD_CLOEXEC ) ) ) );
+    }
+
+    Poller poller( backend );
+    unsigned int serviced = 0;
+    for ( auto & fd : fds ) {
+        FileDescriptor & this_fd = *fd;
+        poller.add_action( Poller::Action( this_fd, Direction::In,
+                                           [&] () {
+                                               this_fd.read( sizeof( uint64_t ) );
+                                               serviced++;
+                                               return ResultType::Continue;
+                                           } ) );
+    }
+
+    const uint64_t one = 1;
+    const string increment( reinterpret_cast<const char *>( &one ), sizeof( one ) );
+
+    chrono::steady_clock::duration latency = chrono::steady_clock::duration::zero();
+    const double cpu_before = cpu_seconds();
+
+    for ( unsigned int i = 0; i < WAKEUPS; i++ ) {
+        /* stride through the fds so no single one stays hot */
+        fds.at( (i * 7919) % fd_count )->write( increment );
+
+        const auto start = chrono::steady_clock::now();
+        if ( poller.poll( -1 ).result != Poller::Result::Type::Success ) {
+            throw runtime_error( "unexpected poll result" );
+        }
+        latency += chrono::steady_clock::now() - start;
+    }
+
+    const double cpu = cpu_seconds() - cpu_before;
+
+    if ( serviced != WAKEUPS ) {
+        throw runtime_error( "lost wakeups" );
+    }
+
+    cout << setw( 6 ) << fd_count << " fds  "
+         << (backend == Poller::Backend::Epoll ? "epoll" : "poll ")
+         << "  latency " << setw( 8 ) << fixed << setprecision( 2 )
+         << chrono::duration<double, micro>( latency ).count() / WAKEUPS << " us"
+         << "  cpu " << setw( 8 ) << cpu * 1.0e6 / WAKEUPS << " us/wakeup" << endl;
+}
+
+int main( void )
+{
+    try {
+        raise_fd_limit( 10000 );
+
+        for ( const unsigned int fd_count : { 3, 100, 10000 } ) {
+            measure( fd_count, Poller::Backend::Poll );
+            measure( fd_count, Poller::Backend::Epoll );
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* time LinkQueue spends emulating the link (i.e., in rationalize(), which
+   wait_time() calls) while replaying each bundled trace, plus a 1 Gbit/s
+   constant-rate one, under a saturating load; the link is driven on a
+   clock of the benchmark's own, a millisecond at a time, instead of
+   waiting. Each trace is replayed
+   without a log, with a text log (a flushed line per event) and with a
+   binary log (written by a background thread). */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+
+#include "link_queue.hh"
+#include "link_trace.hh"
+#include "drop_tail_packet_queue.hh"
+#include "egress_batch.hh"
+#include "timestamp.hh"
+#include "temp_file.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static const size_t PACKET_SIZE = 1500;
+
+/* keep this many packets more in the queue than left in the last millisecond */
+static const unsigned int SURPLUS = 4;
+
+/* nanoseconds spent in wait_time() over one pass of the trace */
+static double replay_ns( const string & filename, const uint64_t duration_ms,
+                         const string & logfile, const bool binary_log )
+{
+    LinkQueue link( "benchmark", filename, logfile, binary_log, false, false, false,
+                    unique_ptr<AbstractPacketQueue>( new DropTailPacketQueue( "packets=1000" ) ),
+                    "" );
+
+    const PacketBuffer packet( string( PACKET_SIZE, 'x' ) );
+    EgressBatch egress;
+    unsigned int to_send = 64;
+
+    /* not before the link's own start */
+    const uint64_t start = timestamp_us();
+
+    chrono::steady_clock::duration elapsed = chrono::steady_clock::duration::zero();
+
+    for ( uint64_t ms = 0; ms <= duration_ms; ms++ ) {
+        const uint64_t now = start + ms * 1000;
+
+        for ( unsigned int i = 0; i < to_send; i++ ) {
+            link.read_packet( packet, now );
+        }
+
+        const auto before = chrono::steady_clock::now();
+        link.wait_time( now + 1000 );
+        elapsed += chrono::steady_clock::now() - before;
+
+        link.write_packets( egress );
+        to_send = egress.size() + SURPLUS;
+        egress.clear();
+    }
+
+    return chrono::duration<double, nano>( elapsed ).count();
+}
+
+static void replay( const string & name, const string & filename )
+{
+    /* one pass over the trace, to count it */
+    uint64_t opportunities = 0, runs = 0;
+    const auto trace = LinkTrace::open( filename );
+    do {
+        opportunities += trace->run_length();
+        runs++;
+    } while ( not trace->advance() );
+    const uint64_t duration_ms = trace->duration() / 1000;
+
+    const double unlogged = replay_ns( filename, duration_ms, "", false );
+    const double logged = replay_ns( filename, duration_ms, "/dev/null", false );
+    const double binary_logged = replay_ns( filename, duration_ms, "/dev/null", true );
+
+    cout << left << setw( 26 ) << name << right
+         << setw( 7 ) << opportunities << " opportunities in "
+         << setw( 7 ) << runs << " runs: "
+         << fixed << setprecision( 1 )
+         << setw( 6 ) << unlogged / opportunities << " ns/opportunity, "
+         << setw( 6 ) << logged / opportunities << " text-logged, "
+         << setw( 6 ) << binary_logged / opportunities << " binary-logged" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        const string trace_dir = argc > 1 ? argv[ 1 ] : TRACE_DIR;
+
+        for ( const string trace : { "ATT-LTE-driving.down", "ATT-LTE-driving.up",
+                                     "TMobile-UMTS-driving.down", "TMobile-UMTS-driving.up",
+                                     "Verizon-EVDO-driving.down", "Verizon-EVDO-driving.up",
+                                     "Verizon-LTE-short.down", "Verizon-LTE-short.up" } ) {
+            replay( trace, trace_dir + "/" + trace );
+        }
+
+        /* 1 Gbit/s: 83 or 84 opportunities every millisecond for 10 s */
+        TempFile fast_trace( "/tmp/replay_benchmark_trace" );
+        string contents;
+        for ( unsigned int ms = 1; ms <= 10000; ms++ ) {
+            const unsigned int count = (ms * 250) / 3 - ((ms - 1) * 250) / 3;
+            for ( unsigned int i = 0; i < count; i++ ) {
+                contents += to_string( ms ) + "\n";
+            }
+        }
+        fast_trace.write( contents );
+        replay( "1Gbps (synthetic)", fast_trace.name() );
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* cost per packet of a ferry queue's store, the std::queue the queues
+   used to keep versus PacketRing: within one thread, as a ferry uses it
+   (a burst in, then out, over a standing backlog like a DelayQueue's),
+   and between two threads, against a std::queue behind a mutex */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+#include "packet_ring.hh"
+#include "packet_buffer.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static const unsigned int TOTAL_PACKETS = 1000000;
+
+/* sum of what comes out, so the work can't be optimized away */
+static uint64_t checksum = 0;
+
+/* a burst of packets in, then out, on top of a standing backlog; ns per packet */
+template <class Store>
+double ns_per_packet( const unsigned int backlog, const unsigned int burst )
+{
+    Store store;
+
+    /* a few distinct packets, shared by every handle to them */
+    vector<PacketBuffer> packets;
+    for ( unsigned int i = 0; i < 64; i++ ) {
+        packets.emplace_back( string( 1400, 'a' + i % 26 ) );
+    }
+
+    for ( unsigned int i = 0; i < backlog; i++ ) {
+        store.push( packets[ i % packets.size() ] );
+    }
+
+    const auto start = chrono::steady_clock::now();
+
+    for ( unsigned int sent = 0; sent < TOTAL_PACKETS; sent += burst ) {
+        for ( unsigned int i = 0; i < burst; i++ ) {
+            store.push( packets[ (sent + i) % packets.size() ] );
+        }
+        for ( unsigned int i = 0; i < burst; i++ ) {
+            checksum += store.front_size();
+            store.pop();
+        }
+    }
+
+    return chrono::duration<double, nano>( chrono::steady_clock::now() - start ).count() / TOTAL_PACKETS;
+}
+
+/* the two stores, behind the same calls */
+class QueueStore
+{
+private:
+    queue<PacketBuffer> queue_ {};
+
+public:
+    void push( const PacketBuffer & packet ) { queue_.emplace( packet ); }
+    size_t front_size( void ) const { return queue_.front().size(); }
+    void pop( void ) { queue_.pop(); }
+};
+
+class RingStore
+{
+private:
+    PacketRing<PacketBuffer> ring_ {};
+
+public:
+    void push( const PacketBuffer & packet ) { ring_.push( packet ); }
+    size_t front_size( void ) const { return ring_.front()->size(); }
+    void pop( void ) { ring_.pop(); }
+};
+
+/* between threads: packets/s from a producer to a consumer. (The handles
+   are plain numbers here, to time the rings alone; ferry-benchmark runs
+   real packets between threads.) */
+static double cross_thread_packets_per_second( const function<void( uint64_t )> & push,
+                                               const function<bool( uint64_t & )> & pop )
+{
+    const auto start = chrono::steady_clock::now();
+
+    thread producer( [&] () {
+            for ( uint64_t i = 1; i <= TOTAL_PACKETS; i++ ) {
+                push( i );
+            }
+        } );
+
+    uint64_t received = 0, handle;
+    while ( received < TOTAL_PACKETS ) {
+        if ( pop( handle ) ) {
+            checksum += handle;
+            received++;
+        } else {
+            this_thread::yield();
+        }
+    }
+
+    producer.join();
+
+    return TOTAL_PACKETS / chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+}
+
+int main( void )
+{
+    try {
+        cout << "ns per packet within one thread (at 1M packets/s, 1000 ns is a whole core)" << endl;
+        cout << setw( 10 ) << "backlog" << setw( 8 ) << "burst"
+             << setw( 14 ) << "std::queue" << setw( 14 ) << "PacketRing" << endl;
+
+        for ( const unsigned int backlog : { 0, 100000 } ) {
+            for ( const unsigned int burst : { 1, 64, 4096 } ) {
+                const double before = ns_per_packet<QueueStore>( backlog, burst );
+                const double after = ns_per_packet<RingStore>( backlog, burst );
+                cout << setw( 10 ) << backlog << setw( 8 ) << burst << fixed << setprecision( 1 )
+                     << setw( 14 ) << before << setw( 14 ) << after << endl;
+            }
+        }
+
+        mutex queue_mutex;
+        queue<uint64_t> locked_queue;
+        const double locked = cross_thread_packets_per_second(
+            [&] ( const uint64_t handle ) {
+                unique_lock<mutex> lock( queue_mutex );
+                locked_queue.push( handle );
+            },
+            [&] ( uint64_t & handle ) {
+                unique_lock<mutex> lock( queue_mutex );
+                if ( locked_queue.empty() ) {
+                    return false;
+                }
+                handle = locked_queue.front();
+                locked_queue.pop();
+                return true;
+            } );
+
+        SPSCRing<uint64_t> ring( PacketRing<uint64_t>::DEFAULT_CAPACITY );
+        const double lock_free = cross_thread_packets_per_second(
+            [&] ( const uint64_t handle ) {
+                while ( not ring.push( handle ) ) {
+                    this_thread::yield();
+                }
+            },
+            [&] ( uint64_t & handle ) {
+                const uint64_t * next = ring.front();
+                if ( not next ) {
+                    return false;
+                }
+                handle = *next;
+                ring.pop();
+                return true;
+            } );
+
+        cout << endl << "between two threads: " << static_cast<uint64_t>( locked )
+             << " packets/s through a std::queue and mutex, "
+             << static_cast<uint64_t>( lock_free ) << " packets/s through the SPSCRing" << endl;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return checksum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
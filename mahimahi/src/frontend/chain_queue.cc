@@ -0,0 +1,307 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <limits>
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "chain_queue.hh"
+#include "delay_queue.hh"
+#include "loss_queue.hh"
+#include "link_queue.hh"
+#include "infinite_packet_queue.hh"
+#include "drop_tail_packet_queue.hh"
+#include "drop_head_packet_queue.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+string ChainQueue::stage_usage( void )
+{
+    return "STAGE = delay MILLISECONDS\n"
+           "      | loss uplink|downlink RATE\n"
+           "      | onoff uplink|downlink MEAN-ON-TIME MEAN-OFF-TIME\n"
+           "      | link UPLINK-TRACE DOWNLINK-TRACE [--once] [--binary-log]\n"
+           "             [--uplink-log=FILENAME] [--downlink-log=FILENAME]\n"
+           "             [--uplink-queue=QUEUE_TYPE] [--downlink-queue=QUEUE_TYPE]\n"
+           "             [--uplink-queue-args=QUEUE_ARGS] [--downlink-queue-args=QUEUE_ARGS]";
+}
+
+static runtime_error stage_error( const ChainQueue::StageSpec & spec, const string & problem )
+{
+    string stage;
+    for ( const auto & word : spec ) {
+        stage += ( stage.empty() ? "" : " " ) + word;
+    }
+    return runtime_error( "mm-chain stage \"" + stage + "\": " + problem );
+}
+
+/* the stages' arguments, as the single-stage shells check them */
+
+static uint64_t delay_us( const ChainQueue::StageSpec & spec )
+{
+    const double delay_ms = myatof( spec.at( 1 ) );
+    if ( delay_ms < 0 ) {
+        throw stage_error( spec, "delay must be nonnegative" );
+    }
+    return llround( delay_ms * 1000 );
+}
+
+static bool applies_to( const ChainQueue::StageSpec & spec, const ChainQueue::Direction direction )
+{
+    if ( spec.at( 1 ) == "uplink" ) {
+        return direction == ChainQueue::Direction::Uplink;
+    } else if ( spec.at( 1 ) == "downlink" ) {
+        return direction == ChainQueue::Direction::Downlink;
+    }
+    throw stage_error( spec, "expected uplink or downlink" );
+}
+
+static double loss_rate( const ChainQueue::StageSpec & spec )
+{
+    const double rate = myatof( spec.at( 2 ) );
+    if ( not ( 0 <= rate and rate <= 1 ) ) {
+        throw stage_error( spec, "loss rate must be between 0 and 1" );
+    }
+    return rate;
+}
+
+static pair<double, double> on_off_times( const ChainQueue::StageSpec & spec )
+{
+    const double on_time = myatof( spec.at( 2 ) ), off_time = myatof( spec.at( 3 ) );
+    if ( not ( 0 <= on_time and 0 <= off_time ) or ( on_time == 0 and off_time == 0 ) ) {
+        throw stage_error( spec, "mean on- and off-times must be nonnegative, and not both 0" );
+    }
+    return make_pair( on_time, off_time );
+}
+
+static unique_ptr<AbstractPacketQueue> packet_queue( const string & type, const string & args )
+{
+    if ( type == "infinite" ) {
+        return unique_ptr<AbstractPacketQueue>( new InfinitePacketQueue( args ) );
+    } else if ( type == "droptail" ) {
+        return unique_ptr<AbstractPacketQueue>( new DropTailPacketQueue( args ) );
+    } else if ( type == "drophead" ) {
+        return unique_ptr<AbstractPacketQueue>( new DropHeadPacketQueue( args ) );
+    }
+    throw runtime_error( "unknown queue type " + type );
+}
+
+/* a link stage's traces and options, as mm-link takes them */
+struct LinkOptions
+{
+    string uplink_trace {}, downlink_trace {};
+    string uplink_log {}, downlink_log {};
+    bool binary_log = false, repeat = true;
+    string uplink_queue = "infinite", downlink_queue = "infinite";
+    string uplink_queue_args {}, downlink_queue_args {};
+
+    LinkOptions( const ChainQueue::StageSpec & spec )
+    {
+        vector<string> traces;
+
+        for ( size_t i = 1; i < spec.size(); i++ ) {
+            const string & word = spec[ i ];
+            const size_t equals = word.find( '=' );
+            const string name = word.substr( 0, equals );
+            const string value = equals == string::npos ? "" : word.substr( equals + 1 );
+
+            if ( word.compare( 0, 2, "--" ) ) {
+                traces.push_back( word );
+            } else if ( word == "--once" ) {
+                repeat = false;
+            } else if ( word == "--binary-log" ) {
+                binary_log = true;
+            } else if ( equals == string::npos ) {
+                throw stage_error( spec, "unknown option " + word );
+            } else if ( name == "--uplink-log" ) {
+                uplink_log = value;
+            } else if ( name == "--downlink-log" ) {
+                downlink_log = value;
+            } else if ( name == "--uplink-queue" ) {
+                uplink_queue = value;
+            } else if ( name == "--downlink-queue" ) {
+                downlink_queue = value;
+            } else if ( name == "--uplink-queue-args" ) {
+                uplink_queue_args = value;
+            } else if ( name == "--downlink-queue-args" ) {
+                downlink_queue_args = value;
+            } else {
+                throw stage_error( spec, "unknown option " + word );
+            }
+        }
+
+        if ( traces.size() != 2 ) {
+            throw stage_error( spec, "expected an uplink and a downlink trace" );
+        }
+        uplink_trace = traces[ 0 ];
+        downlink_trace = traces[ 1 ];
+
+        /* check the queues' arguments now */
+        try {
+            packet_queue( uplink_queue, uplink_queue_args );
+            packet_queue( downlink_queue, downlink_queue_args );
+        } catch ( const runtime_error & e ) {
+            throw stage_error( spec, e.what() );
+        }
+    }
+};
+
+vector<ChainQueue::StageSpec> ChainQueue::parse( const string & pipeline )
+{
+    vector<StageSpec> ret;
+
+    istringstream stages( pipeline );
+    string stage;
+    while ( getline( stages, stage, '|' ) ) {
+        istringstream words( stage );
+        StageSpec spec;
+        string word;
+        while ( words >> word ) {
+            spec.push_back( word );
+        }
+
+        if ( spec.empty() ) {
+            throw runtime_error( "mm-chain: empty stage in \"" + pipeline + "\"" );
+        }
+
+        const string & type = spec.front();
+        if ( type == "delay" and spec.size() == 2 ) {
+            delay_us( spec );
+        } else if ( type == "loss" and spec.size() == 3 ) {
+            applies_to( spec, Direction::Uplink );
+            loss_rate( spec );
+        } else if ( type == "onoff" and spec.size() == 4 ) {
+            applies_to( spec, Direction::Uplink );
+            on_off_times( spec );
+        } else if ( type == "link" ) {
+            LinkOptions options( spec );
+        } else {
+            throw stage_error( spec, "not a stage (or the wrong number of arguments)" );
+        }
+
+        ret.push_back( spec );
+    }
+
+    if ( ret.empty() ) {
+        throw runtime_error( "mm-chain: no stages" );
+    }
+
+    return ret;
+}
+
+unique_ptr<ChainQueue::Stage> ChainQueue::make_stage( const StageSpec & spec, const Direction direction,
+                                                      const string & command_line )
+{
+    const string & type = spec.front();
+    const bool uplink = direction == Direction::Uplink;
+
+    if ( type == "delay" ) {
+        return unique_ptr<Stage>( new QueueStage<DelayQueue>( delay_us( spec ) ) );
+    } else if ( type == "loss" ) {
+        if ( not applies_to( spec, direction ) ) {
+            return nullptr;
+        }
+        return unique_ptr<Stage>( new QueueStage<IIDLoss>( loss_rate( spec ) ) );
+    } else if ( type == "onoff" ) {
+        if ( not applies_to( spec, direction ) ) {
+            return nullptr;
+        }
+        const auto times = on_off_times( spec );
+        return unique_ptr<Stage>( new QueueStage<SwitchingLink>( times.first, times.second ) );
+    }
+
+    const LinkOptions options( spec );
+    return unique_ptr<Stage>( new QueueStage<LinkQueue>(
+                                  uplink ? "Uplink" : "Downlink",
+                                  uplink ? options.uplink_trace : options.downlink_trace,
+                                  uplink ? options.uplink_log : options.downlink_log,
+                                  options.binary_log, options.repeat, false, false,
+                                  packet_queue( uplink ? options.uplink_queue : options.downlink_queue,
+                                                uplink ? options.uplink_queue_args : options.downlink_queue_args ),
+                                  command_line ) );
+}
+
+ChainQueue::ChainQueue( const vector<StageSpec> & stages, const Direction direction,
+                        const string & command_line )
+    : stages_(),
+      handoff_()
+{
+    for ( const auto & spec : stages ) {
+        unique_ptr<Stage> stage = make_stage( spec, direction, command_line );
+        if ( stage ) {
+            stages_.push_back( move( stage ) );
+        }
+    }
+
+    /* the uplink enters at the innermost stage */
+    if ( direction == Direction::Uplink ) {
+        reverse( stages_.begin(), stages_.end() );
+    }
+
+    /* nothing to do in this direction: pass packets straight through */
+    if ( stages_.empty() ) {
+        stages_.emplace_back( new QueueStage<DelayQueue>( 0 ) );
+    }
+}
+
+void ChainQueue::read_packet( const PacketBuffer & contents, const uint64_t arrival_time )
+{
+    stages_.front()->read_packet( contents, arrival_time );
+}
+
+/* a stage's releases arrive at the next now, as they would have through a TUN device */
+bool ChainQueue::hand_off( const size_t stage, const uint64_t now )
+{
+    if ( not stages_[ stage ]->pending_output() ) {
+        return false;
+    }
+
+    stages_[ stage ]->write_packets( handoff_ );
+    for ( const auto & packet : handoff_ ) {
+        stages_[ stage + 1 ]->read_packet( packet, now );
+    }
+    handoff_.clear();
+    return true;
+}
+
+void ChainQueue::write_packets( EgressBatch & egress )
+{
+    const uint64_t now = timestamp_us();
+
+    for ( size_t i = 0; i + 1 < stages_.size(); i++ ) {
+        hand_off( i, now );
+    }
+
+    if ( stages_.back()->pending_output() ) {
+        stages_.back()->write_packets( egress );
+    }
+}
+
+unsigned int ChainQueue::wait_time( void )
+{
+    const uint64_t now = timestamp_us();
+
+    unsigned int ret = numeric_limits<unsigned int>::max();
+    for ( size_t i = 0; i < stages_.size(); i++ ) {
+        /* (a stage's wait_time can itself release packets, as a link's does) */
+        unsigned int stage_wait = stages_[ i ]->wait_time();
+        if ( i + 1 < stages_.size() and hand_off( i, now ) ) {
+            stage_wait = stages_[ i ]->wait_time();
+        }
+        ret = min( ret, stage_wait );
+    }
+    return ret;
+}
+
+bool ChainQueue::pending_output( void ) const
+{
+    return stages_.back()->pending_output();
+}
+
+bool ChainQueue::finished( void ) const
+{
+    return any_of( stages_.begin(), stages_.end(),
+                   [] ( const unique_ptr<Stage> & stage ) { return stage->finished(); } );
+}
@@ -0,0 +1,101 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef CHAIN_QUEUE_HH
+#define CHAIN_QUEUE_HH
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+#include "packet_buffer.hh"
+#include "egress_batch.hh"
+#include "timestamp.hh"
+
+/* Several ferry queues run back to back in one ferry, as mm-chain runs
+   them: what one stage releases goes straight into the next, still in
+   the same packet buffer, instead of out through one TUN device and in
+   through another's. The stages are named outermost first, as the
+   shells would be nested ("delay 20 | link up down" is mm-delay 20
+   mm-link up down), so the downlink crosses them in that order and the
+   uplink in reverse. */
+class ChainQueue
+{
+public:
+    enum class Direction { Uplink, Downlink };
+
+    /* one stage's words, as in { "loss", "uplink", "0.01" } */
+    typedef std::vector<std::string> StageSpec;
+
+    /* split "delay 20 | link up down | loss uplink 0.01" into stages,
+       checking each (before any are built, since that needs privileges dropped) */
+    static std::vector<StageSpec> parse( const std::string & pipeline );
+
+    /* what the stages accept, for usage messages */
+    static std::string stage_usage( void );
+
+private:
+    /* any ferry queue, behind one interface */
+    class Stage
+    {
+    public:
+        virtual void read_packet( const PacketBuffer & contents, const uint64_t arrival_time ) = 0;
+        virtual void write_packets( EgressBatch & egress ) = 0;
+        virtual unsigned int wait_time( void ) = 0;
+        virtual bool pending_output( void ) const = 0;
+        virtual bool finished( void ) const = 0;
+
+        virtual ~Stage() {}
+    };
+
+    template <class QueueType>
+    class QueueStage : public Stage
+    {
+    private:
+        QueueType queue_;
+
+    public:
+        template <typename... Targs>
+        QueueStage( Targs&&... Fargs ) : queue_( std::forward<Targs>( Fargs )... ) {}
+
+        void read_packet( const PacketBuffer & contents, const uint64_t arrival_time ) override
+        {
+            queue_.read_packet( contents, arrival_time );
+        }
+
+        void write_packets( EgressBatch & egress ) override { queue_.write_packets( egress ); }
+        unsigned int wait_time( void ) override { return queue_.wait_time(); }
+        bool pending_output( void ) const override { return queue_.pending_output(); }
+        bool finished( void ) const override { return queue_.finished(); }
+    };
+
+    std::vector<std::unique_ptr<Stage>> stages_; /* in the order packets cross them */
+    EgressBatch handoff_; /* what one stage has released, on its way into the next */
+
+    /* the stage's queue for this direction (null if it does nothing in this direction) */
+    static std::unique_ptr<Stage> make_stage( const StageSpec & spec, const Direction direction,
+                                              const std::string & command_line );
+
+    /* move what a stage has released into the next one (false if nothing) */
+    bool hand_off( const size_t stage, const uint64_t now );
+
+public:
+    ChainQueue( const std::vector<StageSpec> & stages, const Direction direction,
+                const std::string & command_line );
+
+    void read_packet( const PacketBuffer & contents, const uint64_t arrival_time = timestamp_us() );
+
+    void write_packets( EgressBatch & egress );
+
+    /* microseconds until the earliest stage's next event (an inner stage's
+       event is handled here, on the timer, since it writes nothing out) */
+    unsigned int wait_time( void );
+
+    /* whether the last stage has packets to write */
+    bool pending_output( void ) const;
+
+    bool finished( void ) const;
+};
+
+#endif /* CHAIN_QUEUE_HH */
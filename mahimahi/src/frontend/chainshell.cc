@@ -0,0 +1,62 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "chain_queue.hh"
+#include "util.hh"
+#include "packetshell.cc"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " \"STAGE [| STAGE]...\" [COMMAND...]" << endl;
+    cerr << endl;
+    cerr << ChainQueue::stage_usage() << endl;
+    cerr << endl;
+    cerr << "Stages are named outermost first, as the shells they replace would be nested:" << endl;
+    cerr << "\"delay 20 | link UP DOWN | loss uplink 0.01\" is mm-delay 20 mm-link UP DOWN -- mm-loss uplink 0.01" << endl << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        /* clear environment while running as root */
+        char ** const user_environment = environ;
+        environ = nullptr;
+
+        check_requirements( argc, argv );
+
+        if ( argc < 2 ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        const vector<ChainQueue::StageSpec> stages = ChainQueue::parse( argv[ 1 ] );
+
+        const string command_line = join( vector<string>( argv, argv + argc ) ); /* for the log files */
+
+        vector<string> command;
+
+        if ( argc == 2 ) {
+            command.push_back( shell_path() );
+        } else {
+            for ( int i = 2; i < argc; i++ ) {
+                command.push_back( argv[ i ] );
+            }
+        }
+
+        PacketShell<ChainQueue> chain_app( "chain", user_environment );
+
+        chain_app.start_uplink( "[chain " + string( argv[ 1 ] ) + "] ", command,
+                                stages, ChainQueue::Direction::Uplink, command_line );
+        chain_app.start_downlink( stages, ChainQueue::Direction::Downlink, command_line );
+        return chain_app.wait_for_exit();
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+}
@@ -7,31 +7,35 @@
 
 using namespace std;
 
-void DelayQueue::read_packet( const string & contents )
+void DelayQueue::read_packet( const PacketBuffer & contents, const uint64_t arrival_time )
 {
-    packet_queue_.emplace( timestamp() + delay_ms_, contents );
+    packet_queue_.emplace( arrival_time + delay_us_, contents );
 }
 
-void DelayQueue::write_packets( FileDescriptor & fd )
+void DelayQueue::write_packets( EgressBatch & egress )
 {
-    while ( (!packet_queue_.empty())
-            && (packet_queue_.front().first <= timestamp()) ) {
-        fd.write( packet_queue_.front().second );
+    const uint64_t now = timestamp_us();
+
+    for ( auto * next = packet_queue_.front();
+          next and next->first <= now;
+          next = packet_queue_.front() ) {
+        egress.push( move( next->second ) );
         packet_queue_.pop();
     }
 }
 
 unsigned int DelayQueue::wait_time( void ) const
 {
-    if ( packet_queue_.empty() ) {
-        return numeric_limits<uint16_t>::max();
+    const auto * next = packet_queue_.front();
+    if ( not next ) {
+        return numeric_limits<uint16_t>::max() * 1000;
     }
 
-    const auto now = timestamp();
+    const auto now = timestamp_us();
 
-    if ( packet_queue_.front().first <= now ) {
+    if ( next->first <= now ) {
         return 0;
     } else {
-        return packet_queue_.front().first - now;
+        return next->first - now;
     }
 }
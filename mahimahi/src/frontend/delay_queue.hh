@@ -3,26 +3,29 @@
 #ifndef DELAY_QUEUE_HH
 #define DELAY_QUEUE_HH
 
-#include <queue>
 #include <cstdint>
-#include <string>
 
-#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "egress_batch.hh"
+#include "packet_ring.hh"
+#include "timestamp.hh"
 
 class DelayQueue
 {
 private:
-    uint64_t delay_ms_;
-    std::queue< std::pair<uint64_t, std::string> > packet_queue_;
-    /* release timestamp, contents */
+    uint64_t delay_us_;
+    PacketRing< std::pair<uint64_t, PacketBuffer> > packet_queue_;
+    /* release timestamp (us), contents */
 
 public:
-    DelayQueue( const uint64_t & s_delay_ms ) : delay_ms_( s_delay_ms ), packet_queue_() {}
+    DelayQueue( const uint64_t & s_delay_us ) : delay_us_( s_delay_us ), packet_queue_() {}
 
-    void read_packet( const std::string & contents );
+    /* a packet arrived (by default, now; a threaded ferry stamps it as it is read) */
+    void read_packet( const PacketBuffer & contents, const uint64_t arrival_time = timestamp_us() );
 
-    void write_packets( FileDescriptor & fd );
+    void write_packets( EgressBatch & egress );
 
+    /* microseconds until the next packet is due */
     unsigned int wait_time( void ) const;
 
     bool pending_output( void ) const { return wait_time() <= 0; }
@@ -0,0 +1,102 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <sstream>
+#include <cmath>
+#include <stdexcept>
+
+#include "delay_trace.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+DelayTrace::DelayTrace( const string & filename )
+    : filename_( filename ),
+      file_( new MappedFile( filename ) ),
+      next_( file_->data() ),
+      line_number_( 0 ),
+      current_delay_( 0 ),
+      has_next_( false ),
+      next_time_( 0 ),
+      next_delay_( 0 )
+{
+    /* check every line now (keeping nothing), so that a bad one stops
+       the shell from starting instead of the emulation when time reaches it */
+    bool any_delays = false;
+    for ( read_next(); has_next_; read_next() ) {
+        any_delays = true;
+    }
+
+    if ( not any_delays ) {
+        throw runtime_error( filename + ": no delays found" );
+    }
+
+    /* then start again from the top */
+    next_ = file_->data();
+    line_number_ = 0;
+    next_time_ = 0;
+    read_next();
+
+    current_delay_ = next_delay_;
+}
+
+void DelayTrace::read_next( void )
+{
+    const char * const end = file_->data() + file_->size();
+    const uint64_t last_time = next_time_;
+
+    has_next_ = false;
+
+    while ( next_ and next_ < end ) {
+        const char * line_end = next_;
+        while ( line_end < end and *line_end != '\n' ) {
+            line_end++;
+        }
+        const string line( next_, line_end );
+        next_ = line_end + ( line_end < end ? 1 : 0 );
+        line_number_++;
+
+        istringstream words( line );
+        string time, delay, extra;
+        if ( not ( words >> time ) or time[ 0 ] == '#' ) {
+            continue;
+        }
+
+        const string where = filename_ + ":" + to_string( line_number_ ) + ": ";
+
+        if ( not ( words >> delay ) or ( words >> extra ) ) {
+            throw runtime_error( where + "expected TIME DELAY (in ms)" );
+        }
+
+        double time_ms, delay_ms;
+        try {
+            time_ms = myatof( time );
+            delay_ms = myatof( delay );
+        } catch ( const exception & e ) {
+            throw runtime_error( where + e.what() );
+        }
+
+        if ( time_ms < 0 or delay_ms < 0 ) {
+            throw runtime_error( where + "time and delay must be nonnegative" );
+        }
+
+        next_time_ = llround( time_ms * 1000 );
+        next_delay_ = llround( delay_ms * 1000 );
+
+        if ( next_time_ < last_time ) {
+            throw runtime_error( where + "times must not decrease" );
+        }
+
+        has_next_ = true;
+        return;
+    }
+}
+
+uint64_t DelayTrace::delay_at( const uint64_t time )
+{
+    while ( has_next_ and next_time_ <= time ) {
+        current_delay_ = next_delay_;
+        read_next();
+    }
+
+    return current_delay_;
+}
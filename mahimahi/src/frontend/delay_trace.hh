@@ -0,0 +1,52 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef DELAY_TRACE_HH
+#define DELAY_TRACE_HH
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "mapped_file.hh"
+
+/* a delay that changes over time: one "TIME DELAY" pair per line (both
+   in ms, which may be fractional; "#" lines and blank lines ignored),
+   each delay holding from its time until the next line's. The first
+   delay also holds before its time, and the last one for good. The file
+   is mapped and parsed a line at a time as time reaches it, so a trace
+   of any length costs constant memory and constant time per look-up.
+   The whole file is checked (in one pass, keeping nothing) when the
+   trace is made, so a look-up never finds a bad line. */
+
+class DelayTrace
+{
+private:
+    std::string filename_;
+    std::unique_ptr<MappedFile> file_; /* by pointer, to keep the trace movable */
+
+    const char * next_;         /* first unparsed line */
+    unsigned int line_number_;  /* of the line before next_ */
+
+    uint64_t current_delay_;
+    bool has_next_;
+    uint64_t next_time_, next_delay_; /* the next change (if has_next_) */
+
+    /* parse the next entry into next_time_ and next_delay_ */
+    void read_next( void );
+
+public:
+    DelayTrace( const std::string & filename );
+
+    /* the delay (us) at a time (us from the start of the trace);
+       look-ups must not go back in time */
+    uint64_t delay_at( const uint64_t time );
+
+    /* the mapping moves with the trace (next_ still points into it) */
+    DelayTrace( DelayTrace && other ) = default;
+
+    /* ban copying */
+    DelayTrace( const DelayTrace & other ) = delete;
+    DelayTrace & operator=( const DelayTrace & other ) = delete;
+};
+
+#endif /* DELAY_TRACE_HH */
@@ -2,14 +2,45 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include <getopt.h>
 
 #include "delay_queue.hh"
+#include "variable_delay_queue.hh"
 #include "util.hh"
 #include "ezio.hh"
 #include "packetshell.cc"
 
 using namespace std;
 
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " [OPTION]... DELAY-MILLISECONDS [COMMAND...]" << endl;
+    cerr << "       " << program_name << " --delay-trace=FILENAME [OPTION]... [COMMAND...]" << endl;
+    cerr << endl;
+    cerr << "Options = --jitter=MILLISECONDS" << endl;
+    cerr << "          --jitter-distribution=uniform|normal" << endl;
+    cerr << "          --packet-order=preserve|reorder" << endl;
+    cerr << "              (default: reorder with --jitter, preserve with --delay-trace)" << endl << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+/* fractional milliseconds are kept to the microsecond */
+uint64_t milliseconds_to_us( const char * arg, const string & name )
+{
+    const double ms = myatof( arg );
+    if ( ms < 0 ) {
+        throw runtime_error( name + " must be nonnegative" );
+    }
+    return llround( ms * 1000 );
+}
+
+string describe( const uint64_t us )
+{
+    return ( us % 1000 ) ? to_string( us ) + " us" : to_string( us / 1000 ) + " ms";
+}
+
 int main( int argc, char *argv[] )
 {
     try {
@@ -19,28 +50,109 @@ int main( int argc, char *argv[] )
 
         check_requirements( argc, argv );
 
-        if ( argc < 2 ) {
-            throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " delay-milliseconds [command...]" );
+        const option command_line_options[] = {
+            { "jitter",              required_argument, nullptr, 'j' },
+            { "jitter-distribution", required_argument, nullptr, 'd' },
+            { "delay-trace",         required_argument, nullptr, 't' },
+            { "packet-order",        required_argument, nullptr, 'o' },
+            { 0,                                     0, nullptr, 0 }
+        };
+
+        uint64_t jitter_us = 0;
+        JitterDelayQueue::Distribution distribution = JitterDelayQueue::Distribution::Uniform;
+        string delay_trace, packet_order;
+
+        while ( true ) {
+            /* stop at the delay (or the command), before the command's own options */
+            const int opt = getopt_long( argc, argv, "+", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 'j':
+                jitter_us = milliseconds_to_us( optarg, "jitter" );
+                break;
+            case 'd':
+                distribution = JitterDelayQueue::distribution( optarg );
+                break;
+            case 't':
+                delay_trace = optarg;
+                break;
+            case 'o':
+                packet_order = optarg;
+                if ( packet_order != "preserve" and packet_order != "reorder" ) {
+                    cerr << "Unknown packet order: " << packet_order << endl;
+                    usage_error( argv[ 0 ] );
+                }
+                break;
+            default:
+                usage_error( argv[ 0 ] );
+                break;
+            }
+        }
+
+        if ( not delay_trace.empty() and jitter_us ) {
+            cerr << "--jitter and --delay-trace cannot be combined" << endl;
+            usage_error( argv[ 0 ] );
         }
 
-        const uint64_t delay_ms = myatoi( argv[ 1 ] );
+        /* a trace takes the place of the fixed delay */
+        uint64_t delay_us = 0;
+        if ( delay_trace.empty() ) {
+            if ( optind >= argc ) {
+                usage_error( argv[ 0 ] );
+            }
+            delay_us = milliseconds_to_us( argv[ optind++ ], "delay" );
+        }
 
         vector< string > command;
 
-        if ( argc == 2 ) {
+        if ( optind == argc ) {
             command.push_back( shell_path() );
         } else {
-            for ( int i = 2; i < argc; i++ ) {
+            for ( int i = optind; i < argc; i++ ) {
                 command.push_back( argv[ i ] );
             }
         }
 
-        PacketShell<DelayQueue> delay_shell_app( "delay", user_environment );
+        if ( not delay_trace.empty() ) {
+            const bool preserve_order = packet_order != "reorder";
+
+            /* check the trace before starting anything (as the user: it's their file) */
+            {
+                TemporarilyUnprivileged tu;
+                DelayTrace check( delay_trace );
+            }
+
+            PacketShell<TraceDelayQueue> delay_shell_app( "delay", user_environment );
+
+            delay_shell_app.start_uplink( "[delay trace " + delay_trace + "] ",
+                                          command,
+                                          delay_trace, preserve_order );
+            delay_shell_app.start_downlink( delay_trace, preserve_order );
+            return delay_shell_app.wait_for_exit();
+        }
+
+        if ( jitter_us == 0 ) {
+            PacketShell<DelayQueue> delay_shell_app( "delay", user_environment );
+
+            delay_shell_app.start_uplink( "[delay " + describe( delay_us ) + "] ",
+                                          command,
+                                          delay_us );
+            delay_shell_app.start_downlink( delay_us );
+            return delay_shell_app.wait_for_exit();
+        }
+
+        /* with jitter, packets can overtake one another (unless told not to) */
+        const bool preserve_order = packet_order == "preserve";
+
+        PacketShell<JitterDelayQueue> delay_shell_app( "delay", user_environment );
 
-        delay_shell_app.start_uplink( "[delay " + to_string( delay_ms ) + " ms] ",
+        delay_shell_app.start_uplink( "[delay " + describe( delay_us ) + " jitter " + describe( jitter_us ) + "] ",
                                       command,
-                                      delay_ms );
-        delay_shell_app.start_downlink( delay_ms );
+                                      delay_us, jitter_us, distribution, preserve_order );
+        delay_shell_app.start_downlink( delay_us, jitter_us, distribution, preserve_order );
         return delay_shell_app.wait_for_exit();
     } catch ( const exception & e ) {
         print_exception( e );
@@ -0,0 +1,158 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+#include "link_log.hh"
+#include "exception.hh"
+
+using namespace std;
+
+/* records moved per write by the background thread */
+static const size_t WRITE_BATCH = 4096;
+
+/* records the ring holds, enough for a few milliseconds of a 10 Gbit/s link */
+static const size_t RING_CAPACITY = 1 << 16;
+
+const string BinaryLinkLog::MAGIC = string( "mmlog\0\0\x01", 8 );
+
+TextLinkLog::TextLinkLog( const string & filename, const string & header )
+    : log_( filename )
+{
+    if ( not log_.good() ) {
+        throw runtime_error( filename + ": error opening for writing" );
+    }
+
+    log_ << header << flush;
+}
+
+void TextLinkLog::print( ostream & output, const Record & event )
+{
+    /* the log stays in whole milliseconds */
+    const uint64_t time_ms = event.time_us / 1000;
+
+    output << time_ms << " " << char( event.type ) << " " << event.bytes;
+
+    if ( event.type == '-' ) {
+        output << " " << time_ms - event.arrival_us / 1000;
+    }
+}
+
+void TextLinkLog::record( const Record & event )
+{
+    print( log_, event );
+    log_ << endl;
+}
+
+BinaryLinkLog::BinaryLinkLog( const string & filename, const string & header )
+    : filename_( filename ),
+      log_( filename, ios::binary | ios::trunc ),
+      ring_( RING_CAPACITY ),
+      halt_( false ),
+      writer_failed_( false ),
+      writer_thread_exception_(),
+      writer_thread_()
+{
+    if ( not log_.good() ) {
+        throw runtime_error( filename + ": error opening for writing" );
+    }
+
+    const uint32_t header_length = header.size();
+    log_.write( MAGIC.data(), MAGIC.size() );
+    log_.write( reinterpret_cast<const char *>( &header_length ), sizeof( header_length ) );
+    log_ << header;
+
+    writer_thread_ = thread( [&] () {
+            try {
+                writer_loop();
+            } catch ( ... ) {
+                writer_thread_exception_ = current_exception();
+                writer_failed_ = true;
+            } } );
+}
+
+void BinaryLinkLog::writer_loop( void )
+{
+    vector<Record> batch( WRITE_BATCH );
+
+    while ( true ) {
+        /* check before draining, so that nothing pushed before the halt is left behind */
+        const bool halting = halt_;
+
+        const size_t count = ring_.pop( batch.data(), batch.size() );
+        if ( count ) {
+            log_.write( reinterpret_cast<const char *>( batch.data() ), count * sizeof( Record ) );
+            if ( not log_.good() ) {
+                throw runtime_error( filename_ + ": error writing log" );
+            }
+        } else if ( halting ) {
+            break;
+        } else {
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+        }
+    }
+
+    log_.flush();
+    if ( not log_.good() ) {
+        throw runtime_error( filename_ + ": error writing log" );
+    }
+}
+
+void BinaryLinkLog::record( const Record & event )
+{
+    /* if the writer has fallen a whole ring behind, wait for it rather than lose records */
+    while ( not ring_.push( event ) ) {
+        if ( writer_failed_ ) {
+            throw runtime_error( filename_ + ": log writer stopped" );
+        }
+        this_thread::yield();
+    }
+}
+
+BinaryLinkLog::~BinaryLinkLog()
+{
+    halt_ = true;
+    writer_thread_.join();
+
+    if ( writer_thread_exception_ != exception_ptr() ) {
+        try {
+            rethrow_exception( writer_thread_exception_ );
+        } catch ( const exception & e ) {
+            cerr << "BinaryLinkLog exited from exception: ";
+            print_exception( e );
+        }
+    }
+}
+
+void BinaryLinkLog::decode( istream & input, ostream & output )
+{
+    char magic[ 8 ] = {};
+    input.read( magic, sizeof( magic ) );
+    if ( input.gcount() != sizeof( magic ) or MAGIC != string( magic, sizeof( magic ) ) ) {
+        throw runtime_error( "not a binary mm-link log" );
+    }
+
+    uint32_t header_length = 0;
+    input.read( reinterpret_cast<char *>( &header_length ), sizeof( header_length ) );
+    string header( header_length, 0 );
+    input.read( &header[ 0 ], header_length );
+    if ( not input.good() ) {
+        throw runtime_error( "truncated binary mm-link log header" );
+    }
+
+    output << header;
+
+    Record event;
+    while ( input.read( reinterpret_cast<char *>( &event ), sizeof( event ) ) ) {
+        if ( event.type != '+' and event.type != '#' and event.type != '-' ) {
+            throw runtime_error( "invalid record in binary mm-link log" );
+        }
+        TextLinkLog::print( output, event );
+        output << "\n";
+    }
+
+    if ( input.gcount() != 0 ) {
+        throw runtime_error( "binary mm-link log ends with a partial record" );
+    }
+}
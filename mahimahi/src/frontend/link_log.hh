@@ -0,0 +1,86 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef LINK_LOG_HH
+#define LINK_LOG_HH
+
+#include <string>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <cstdint>
+
+#include "spsc_ring.hh"
+
+/* the arrivals, delivery opportunities and departures of an mm-link
+   queue, after a header of "# ..." lines */
+
+class LinkLog
+{
+public:
+    struct Record
+    {
+        uint64_t time_us;
+        uint64_t arrival_us;  /* departures only */
+        uint32_t bytes;
+        uint32_t type;        /* '+' arrival, '#' opportunities, '-' departure */
+    };
+
+    virtual void record( const Record & event ) = 0;
+
+    virtual ~LinkLog() = default;
+};
+
+/* one line per record, flushed as it is written (the format the
+   mm-throughput-graph and mm-delay-graph scripts read) */
+class TextLinkLog : public LinkLog
+{
+private:
+    std::ofstream log_;
+
+public:
+    TextLinkLog( const std::string & filename, const std::string & header );
+
+    void record( const Record & event ) override;
+
+    /* write a record as a line, without the newline */
+    static void print( std::ostream & output, const Record & event );
+};
+
+/* magic, header length (uint32) and header text, then the Records
+   themselves, in the byte order of the host. The packet-forwarding
+   thread only copies each record into a ring; a background thread
+   writes them out in batches and never flushes. */
+class BinaryLinkLog : public LinkLog
+{
+private:
+    std::string filename_;
+    std::ofstream log_;
+    SPSCRing<Record> ring_;
+
+    std::atomic<bool> halt_;
+    std::atomic<bool> writer_failed_;
+    std::exception_ptr writer_thread_exception_;
+    std::thread writer_thread_;
+
+    void writer_loop( void );
+
+public:
+    static const std::string MAGIC;
+
+    BinaryLinkLog( const std::string & filename, const std::string & header );
+    ~BinaryLinkLog();
+
+    void record( const Record & event ) override;
+
+    /* write a binary log in the text format */
+    static void decode( std::istream & input, std::ostream & output );
+
+    /* ban copying */
+    BinaryLinkLog( const BinaryLinkLog & other ) = delete;
+    BinaryLinkLog & operator=( const BinaryLinkLog & other ) = delete;
+};
+
+#endif /* LINK_LOG_HH */
@@ -6,20 +6,19 @@
 #include "link_queue.hh"
 #include "timestamp.hh"
 #include "util.hh"
-#include "ezio.hh"
 #include "abstract_packet_queue.hh"
 
 using namespace std;
 
 LinkQueue::LinkQueue( const string & link_name, const string & filename, const string & logfile,
+                      const bool binary_log,
                       const bool repeat, const bool graph_throughput, const bool graph_delay,
                       unique_ptr<AbstractPacketQueue> && packet_queue,
                       const string & command_line )
-    : next_delivery_( 0 ),
-      schedule_(),
-      base_timestamp_( timestamp() ),
+    : trace_(),
+      base_timestamp_( timestamp_us() ),
       packet_queue_( move( packet_queue ) ),
-      packet_in_transit_( "", 0 ),
+      packet_in_transit_( PacketBuffer(), 0 ),
       packet_in_transit_bytes_left_( 0 ),
       output_queue_(),
       log_(),
@@ -30,53 +29,24 @@ LinkQueue::LinkQueue( const string & link_name, const string & filename, const s
 {
     assert_not_root();
 
-    /* open filename and load schedule */
-    ifstream trace_file( filename );
-
-    if ( not trace_file.good() ) {
-        throw runtime_error( filename + ": error opening for reading" );
-    }
-
-    string line;
-
-    while ( trace_file.good() and getline( trace_file, line ) ) {
-        if ( line.empty() ) {
-            throw runtime_error( filename + ": invalid empty line" );
-        }
-
-        const uint64_t ms = myatoi( line );
-
-        if ( not schedule_.empty() ) {
-            if ( ms < schedule_.back() ) {
-                throw runtime_error( filename + ": timestamps must be monotonically nondecreasing" );
-            }
-        }
-
-        schedule_.emplace_back( ms );
-    }
-
-    if ( schedule_.empty() ) {
-        throw runtime_error( filename + ": no valid timestamps found" );
-    }
-
-    if ( schedule_.back() == 0 ) {
-        throw runtime_error( filename + ": trace must last for a nonzero amount of time" );
-    }
+    /* open the trace (binary traces are read lazily) */
+    trace_ = LinkTrace::open( filename );
 
     /* open logfile if called for */
     if ( not logfile.empty() ) {
-        log_.reset( new ofstream( logfile ) );
-        if ( not log_->good() ) {
-            throw runtime_error( logfile + ": error opening for writing" );
-        }
-
-        *log_ << "# mahimahi mm-link (" << link_name << ") [" << filename << "] > " << logfile << endl;
-        *log_ << "# command line: " << command_line << endl;
-        *log_ << "# queue: " << packet_queue_->to_string() << endl;
-        *log_ << "# base timestamp: " << base_timestamp_ << endl;
+        string header = "# mahimahi mm-link (" + link_name + ") [" + filename + "] > " + logfile + "\n";
+        header += "# command line: " + command_line + "\n";
+        header += "# queue: " + packet_queue_->to_string() + "\n";
+        header += "# base timestamp: " + to_string( base_timestamp_ / 1000 ) + "\n";
         const char * prefix = getenv( "MAHIMAHI_SHELL_PREFIX" );
         if ( prefix ) {
-            *log_ << "# mahimahi config: " << prefix << endl;
+            header += "# mahimahi config: " + string( prefix ) + "\n";
+        }
+
+        if ( binary_log ) {
+            log_.reset( new BinaryLinkLog( logfile, header ) );
+        } else {
+            log_.reset( new TextLinkLog( logfile, header ) );
         }
     }
 
@@ -106,7 +76,7 @@ void LinkQueue::record_arrival( const uint64_t arrival_time, const size_t pkt_si
 {
     /* log it */
     if ( log_ ) {
-        *log_ << arrival_time << " + " << pkt_size << endl;
+        log_->record( { arrival_time, 0, uint32_t( pkt_size ), '+' } );
     }
 
     /* meter it */
@@ -115,25 +85,28 @@ void LinkQueue::record_arrival( const uint64_t arrival_time, const size_t pkt_si
     }
 }
 
-void LinkQueue::record_departure_opportunity( void )
+void LinkQueue::record_departure_opportunities( const unsigned int count )
 {
-    /* log the delivery opportunity */
+    /* log the delivery opportunities (as one line, which the analysis scripts sum the same way) */
     if ( log_ ) {
-        *log_ << next_delivery_time() << " # " << PACKET_SIZE << endl;
+        log_->record( { next_delivery_time(), 0, count * PACKET_SIZE, '#' } );
     }
 
-    /* meter the delivery opportunity */
+    /* meter the delivery opportunities */
     if ( throughput_graph_ ) {
-        throughput_graph_->add_value_now( 0, PACKET_SIZE );
+        throughput_graph_->add_value_now( 0, count * PACKET_SIZE );
     }    
 }
 
 void LinkQueue::record_departure( const uint64_t departure_time, const QueuedPacket & packet )
 {
+    /* the log and graphs stay in whole milliseconds */
+    const uint64_t departure_ms = departure_time / 1000;
+    const uint64_t delay_ms = departure_ms - packet.arrival_time / 1000;
+
     /* log the delivery */
     if ( log_ ) {
-        *log_ << departure_time << " - " << packet.contents.size()
-              << " " << departure_time - packet.arrival_time << endl;
+        log_->record( { departure_time, packet.arrival_time, uint32_t( packet.contents.size() ), '-' } );
     }
 
     /* meter the delivery */
@@ -142,22 +115,20 @@ void LinkQueue::record_departure( const uint64_t departure_time, const QueuedPac
     }
 
     if ( delay_graph_ ) {
-        delay_graph_->set_max_value_now( 0, departure_time - packet.arrival_time );
+        delay_graph_->set_max_value_now( 0, delay_ms );
     }    
 }
 
-void LinkQueue::read_packet( const string & contents )
+void LinkQueue::read_packet( const PacketBuffer & contents, const uint64_t arrival_time )
 {
-    const uint64_t now = timestamp();
-
     if ( contents.size() > PACKET_SIZE ) {
         throw runtime_error( "packet size is greater than maximum" );
     }
 
-    rationalize( now );
+    rationalize( arrival_time );
 
-    record_arrival( now, contents.size());
-    packet_queue_->enqueue( QueuedPacket( contents, now ) );
+    record_arrival( arrival_time, contents.size());
+    packet_queue_->enqueue( QueuedPacket( contents, arrival_time ) );
 }
 
 uint64_t LinkQueue::next_delivery_time( void ) const
@@ -165,20 +136,18 @@ uint64_t LinkQueue::next_delivery_time( void ) const
     if ( finished_ ) {
         return -1;
     } else {
-        return schedule_.at( next_delivery_ ) + base_timestamp_;
+        return trace_->current() + base_timestamp_;
     }
 }
 
-void LinkQueue::use_a_delivery_opportunity( void )
+void LinkQueue::use_a_run_of_delivery_opportunities( void )
 {
-    record_departure_opportunity();
-
-    next_delivery_ = (next_delivery_ + 1) % schedule_.size();
+    record_departure_opportunities( trace_->run_length() );
 
     /* wraparound */
-    if ( next_delivery_ == 0 ) {
+    if ( trace_->advance() ) {
         if ( repeat_ ) {
-            base_timestamp_ += schedule_.back();
+            base_timestamp_ += trace_->duration();
         } else {
             finished_ = true;
         }
@@ -193,9 +162,11 @@ void LinkQueue::rationalize( const uint64_t now )
     while ( next_delivery_time() <= now ) {
         const uint64_t this_delivery_time = next_delivery_time();
 
-        /* burn a delivery opportunity */
-        unsigned int bytes_left_in_this_delivery = PACKET_SIZE;
-        use_a_delivery_opportunity();
+        /* burn every delivery opportunity at this time in one go; byte accounting is
+           unchanged, since an opportunity that finds the queue empty wastes its bytes,
+           and so will the rest of the run */
+        uint64_t bytes_left_in_this_delivery = uint64_t( PACKET_SIZE ) * trace_->run_length();
+        use_a_run_of_delivery_opportunities();
 
         while ( bytes_left_in_this_delivery > 0 ) {
             if ( not packet_in_transit_bytes_left_ ) {
@@ -213,7 +184,7 @@ void LinkQueue::rationalize( const uint64_t now )
 
             /* how many bytes of the delivery opportunity can we use? */
             const unsigned int amount_to_send = min( bytes_left_in_this_delivery,
-                                                     packet_in_transit_bytes_left_ );
+                                                     uint64_t( packet_in_transit_bytes_left_ ) );
 
             /* send that many bytes */
             packet_in_transit_bytes_left_ -= amount_to_send;
@@ -230,24 +201,22 @@ void LinkQueue::rationalize( const uint64_t now )
     }
 }
 
-void LinkQueue::write_packets( FileDescriptor & fd )
+void LinkQueue::write_packets( EgressBatch & egress )
 {
-    while ( not output_queue_.empty() ) {
-        fd.write( output_queue_.front() );
+    for ( auto * next = output_queue_.front(); next; next = output_queue_.front() ) {
+        egress.push( move( *next ) );
         output_queue_.pop();
     }
 }
 
-unsigned int LinkQueue::wait_time( void )
+unsigned int LinkQueue::wait_time( const uint64_t now )
 {
-    const auto now = timestamp();
-
     rationalize( now );
 
     if ( next_delivery_time() <= now ) {
         return 0;
     } else {
-        return next_delivery_time() - now;
+        return min( next_delivery_time() - now, uint64_t( numeric_limits<unsigned int>::max() ) );
     }
 }
 
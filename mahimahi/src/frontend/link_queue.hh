@@ -3,31 +3,32 @@
 #ifndef LINK_QUEUE_HH
 #define LINK_QUEUE_HH
 
-#include <queue>
 #include <cstdint>
 #include <string>
-#include <fstream>
 #include <memory>
 
-#include "file_descriptor.hh"
+#include "egress_batch.hh"
 #include "binned_livegraph.hh"
 #include "abstract_packet_queue.hh"
+#include "link_trace.hh"
+#include "link_log.hh"
+#include "packet_ring.hh"
+#include "timestamp.hh"
 
 class LinkQueue
 {
 private:
     const static unsigned int PACKET_SIZE = 1504; /* default max TUN payload size */
 
-    unsigned int next_delivery_;
-    std::vector<uint64_t> schedule_;
+    std::unique_ptr<LinkTrace> trace_;
     uint64_t base_timestamp_;
 
     std::unique_ptr<AbstractPacketQueue> packet_queue_;
     QueuedPacket packet_in_transit_;
     unsigned int packet_in_transit_bytes_left_;
-    std::queue<std::string> output_queue_;
+    PacketRing<PacketBuffer> output_queue_;
 
-    std::unique_ptr<std::ofstream> log_;
+    std::unique_ptr<LinkLog> log_;
     std::unique_ptr<BinnedLiveGraph> throughput_graph_;
     std::unique_ptr<BinnedLiveGraph> delay_graph_;
 
@@ -36,10 +37,10 @@ private:
 
     uint64_t next_delivery_time( void ) const;
 
-    void use_a_delivery_opportunity( void );
+    void use_a_run_of_delivery_opportunities( void );
 
     void record_arrival( const uint64_t arrival_time, const size_t pkt_size );
-    void record_departure_opportunity( void );
+    void record_departure_opportunities( const unsigned int count );
     void record_departure( const uint64_t departure_time, const QueuedPacket & packet );
 
     void rationalize( const uint64_t now );
@@ -47,15 +48,19 @@ private:
 
 public:
     LinkQueue( const std::string & link_name, const std::string & filename, const std::string & logfile,
+               const bool binary_log,
                const bool repeat, const bool graph_throughput, const bool graph_delay,
                std::unique_ptr<AbstractPacketQueue> && packet_queue,
                const std::string & command_line );
 
-    void read_packet( const std::string & contents );
+    /* a packet arrived (by default, now; a threaded ferry stamps it as it is read) */
+    void read_packet( const PacketBuffer & contents, const uint64_t arrival_time = timestamp_us() );
 
-    void write_packets( FileDescriptor & fd );
+    void write_packets( EgressBatch & egress );
 
-    unsigned int wait_time( void );
+    /* microseconds until the next delivery opportunity (by default, from
+       now; the replay benchmark drives the link on a clock of its own) */
+    unsigned int wait_time( const uint64_t now = timestamp_us() );
 
     bool pending_output( void ) const;
 
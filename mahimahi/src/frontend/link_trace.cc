@@ -0,0 +1,275 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <fstream>
+#include <cstring>
+
+#include "link_trace.hh"
+#include "ezio.hh"
+#include "exception.hh"
+
+using namespace std;
+
+const string BinaryLinkTrace::MAGIC = string( "mmtrace\x01", 8 );
+
+static const size_t HEADER_SIZE = 24; /* magic, count, duration */
+
+unique_ptr<LinkTrace> LinkTrace::open( const string & filename )
+{
+    ifstream trace_file( filename );
+
+    if ( not trace_file.good() ) {
+        throw runtime_error( filename + ": error opening for reading" );
+    }
+
+    char magic[ 8 ] = {};
+    trace_file.read( magic, sizeof( magic ) );
+
+    if ( trace_file.gcount() == sizeof( magic ) and BinaryLinkTrace::MAGIC == string( magic, sizeof( magic ) ) ) {
+        return unique_ptr<LinkTrace>( new BinaryLinkTrace( filename ) );
+    }
+
+    return unique_ptr<LinkTrace>( new TextLinkTrace( filename ) );
+}
+
+/* nanoseconds per trace timestamp, from a "# units: ..." header line */
+static uint64_t trace_units( const string & filename, const string & header )
+{
+    const string prefix = "# units: ";
+    const string units = header.substr( 0, prefix.size() ) == prefix ? header.substr( prefix.size() ) : "";
+
+    if ( units == "ms" ) {
+        return 1000000;
+    } else if ( units == "us" ) {
+        return 1000;
+    } else if ( units == "ns" ) {
+        return 1;
+    }
+
+    throw runtime_error( filename + ": invalid header \"" + header + "\" (expected \"# units: ms|us|ns\")" );
+}
+
+/* check the properties every trace must have */
+static void check_duration( const string & filename, const uint64_t count, const uint64_t duration )
+{
+    if ( count == 0 ) {
+        throw runtime_error( filename + ": no valid timestamps found" );
+    }
+
+    if ( duration == 0 ) {
+        throw runtime_error( filename + ": trace must last for a nonzero amount of time" );
+    }
+}
+
+TextLinkTrace::TextLinkTrace( const string & filename )
+    : runs_(),
+      next_( 0 )
+{
+    ifstream trace_file( filename );
+
+    if ( not trace_file.good() ) {
+        throw runtime_error( filename + ": error opening for reading" );
+    }
+
+    string line;
+
+    /* timestamps are in milliseconds unless the trace
+       starts with a "# units: us" (or "ns") line */
+    uint64_t ns_per_unit = 1000000;
+    if ( trace_file.peek() == '#' ) {
+        getline( trace_file, line );
+        ns_per_unit = trace_units( filename, line );
+    }
+
+    while ( trace_file.good() and getline( trace_file, line ) ) {
+        if ( line.empty() ) {
+            throw runtime_error( filename + ": invalid empty line" );
+        }
+
+        const uint64_t us = myatoi( line ) * ns_per_unit / 1000;
+
+        if ( not runs_.empty() ) {
+            if ( us < runs_.back().first ) {
+                throw runtime_error( filename + ": timestamps must be monotonically nondecreasing" );
+            }
+
+            if ( us == runs_.back().first ) {
+                runs_.back().second++;
+                continue;
+            }
+        }
+
+        runs_.emplace_back( us, 1 );
+    }
+
+    check_duration( filename, runs_.size(), runs_.empty() ? 0 : runs_.back().first );
+}
+
+bool TextLinkTrace::advance( void )
+{
+    next_ = (next_ + 1) % runs_.size();
+    return next_ == 0;
+}
+
+static uint64_t get_uint64( const char * const data )
+{
+    uint64_t ret = 0;
+    for ( unsigned int i = 0; i < 8; i++ ) {
+        ret |= uint64_t( static_cast<unsigned char>( data[ i ] ) ) << (8 * i);
+    }
+    return ret;
+}
+
+static void put_uint64( string & output, const uint64_t value )
+{
+    for ( unsigned int i = 0; i < 8; i++ ) {
+        output.push_back( char( (value >> (8 * i)) & 0xff ) );
+    }
+}
+
+BinaryLinkTrace::BinaryLinkTrace( const string & filename )
+    : file_( filename ),
+      count_( 0 ),
+      duration_( 0 ),
+      next_( nullptr ),
+      remaining_( 0 ),
+      current_( 0 ),
+      run_length_( 0 ),
+      next_delta_( 0 )
+{
+    if ( file_.size() < HEADER_SIZE or MAGIC != string( file_.data(), MAGIC.size() ) ) {
+        throw runtime_error( filename + ": not a binary mahimahi trace" );
+    }
+
+    count_ = get_uint64( file_.data() + 8 );
+    duration_ = get_uint64( file_.data() + 16 );
+
+    check_duration( filename, count_, duration_ );
+
+    /* every opportunity takes at least one byte */
+    if ( file_.size() - HEADER_SIZE < count_ ) {
+        throw runtime_error( filename + ": truncated binary trace" );
+    }
+
+    try {
+        check_deltas();
+    } catch ( const runtime_error & e ) {
+        throw runtime_error( filename + ": " + e.what() );
+    }
+
+    rewind();
+}
+
+/* decode the whole trace once, so that a bad one is refused when it
+   is opened rather than when the link first wraps around it */
+void BinaryLinkTrace::check_deltas( void )
+{
+    next_ = file_.data() + HEADER_SIZE;
+
+    uint64_t total = 0;
+    for ( uint64_t i = 0; i < count_; i++ ) {
+        const uint64_t delta = read_delta();
+        if ( delta > duration_ - total ) {
+            throw runtime_error( "opportunities add up to more than the stated duration" );
+        }
+        total += delta;
+    }
+
+    if ( total != duration_ ) {
+        throw runtime_error( "opportunities add up to less than the stated duration" );
+    }
+
+    if ( next_ != file_.data() + file_.size() ) {
+        throw runtime_error( "data after the last opportunity" );
+    }
+}
+
+void BinaryLinkTrace::rewind( void )
+{
+    next_ = file_.data() + HEADER_SIZE;
+    remaining_ = count_ - 1;
+    read_run( read_delta() );
+}
+
+/* the run's first opportunity has been decoded; gather the rest,
+   stopping after decoding the first opportunity of the next run */
+void BinaryLinkTrace::read_run( const uint64_t start )
+{
+    current_ = start;
+    run_length_ = 1;
+    next_delta_ = 0;
+
+    while ( remaining_ > 0 ) {
+        const uint64_t delta = read_delta();
+        remaining_--;
+
+        if ( delta ) {
+            next_delta_ = delta;
+            return;
+        }
+
+        run_length_++;
+    }
+}
+
+uint64_t BinaryLinkTrace::read_delta( void )
+{
+    const char * const end = file_.data() + file_.size();
+
+    uint64_t value = 0;
+    for ( unsigned int shift = 0; shift < 64; shift += 7 ) {
+        if ( next_ == end ) {
+            throw runtime_error( "truncated varint" );
+        }
+
+        const uint8_t byte = *next_++;
+        value |= uint64_t( byte & 0x7f ) << shift;
+        if ( not (byte & 0x80) ) {
+            return value;
+        }
+    }
+
+    throw runtime_error( "varint too long" );
+}
+
+bool BinaryLinkTrace::advance( void )
+{
+    /* the last run ends at the stated duration (checked when the trace was opened) */
+    if ( next_delta_ == 0 ) {
+        rewind();
+        return true;
+    }
+
+    read_run( current_ + next_delta_ );
+    return false;
+}
+
+void BinaryLinkTrace::convert( LinkTrace & source, ostream & output )
+{
+    string encoded;
+    uint64_t count = 0, previous = 0;
+
+    /* the source starts at its first run; take it round once */
+    do {
+        uint64_t delta = source.current() - previous;
+        previous = source.current();
+        count += source.run_length();
+
+        while ( delta >= 0x80 ) {
+            encoded.push_back( char( (delta & 0x7f) | 0x80 ) );
+            delta >>= 7;
+        }
+        encoded.push_back( char( delta ) );
+
+        /* the rest of the run is zero deltas */
+        encoded.append( source.run_length() - 1, char( 0 ) );
+    } while ( not source.advance() );
+
+    string header = MAGIC;
+    put_uint64( header, count );
+    put_uint64( header, previous );
+
+    output << header << encoded;
+    if ( not output.good() ) {
+        throw runtime_error( "error writing binary trace" );
+    }
+}
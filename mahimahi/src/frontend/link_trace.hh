@@ -0,0 +1,94 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef LINK_TRACE_HH
+#define LINK_TRACE_HH
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+
+#include "mapped_file.hh"
+
+/* the delivery opportunities of an mm-link trace, in microseconds
+   from the start of the trace, visited in order and wrapping around;
+   opportunities that share a timestamp are visited as one run */
+
+class LinkTrace
+{
+public:
+    /* time of the current run of delivery opportunities */
+    virtual uint64_t current( void ) const = 0;
+
+    /* number of opportunities in the current run */
+    virtual unsigned int run_length( void ) const = 0;
+
+    /* move to the next run; true if that wrapped around to the first */
+    virtual bool advance( void ) = 0;
+
+    /* time of the last opportunity */
+    virtual uint64_t duration( void ) const = 0;
+
+    virtual ~LinkTrace() = default;
+
+    /* open a text or binary trace, telling them apart by the binary magic */
+    static std::unique_ptr<LinkTrace> open( const std::string & filename );
+};
+
+/* one integer timestamp per line, in ms unless the first
+   line is "# units: us" (or ns); parsed up front */
+class TextLinkTrace : public LinkTrace
+{
+private:
+    std::vector<std::pair<uint64_t, unsigned int>> runs_; /* timestamp, count */
+    size_t next_;
+
+public:
+    TextLinkTrace( const std::string & filename );
+
+    uint64_t current( void ) const override { return runs_[ next_ ].first; }
+    unsigned int run_length( void ) const override { return runs_[ next_ ].second; }
+    bool advance( void ) override;
+    uint64_t duration( void ) const override { return runs_.back().first; }
+};
+
+/* header (magic, opportunity count, duration in us, as little-endian
+   uint64s) followed by one LEB128 varint per opportunity holding the us
+   since the previous one; mapped read-only and decoded as it is used */
+class BinaryLinkTrace : public LinkTrace
+{
+private:
+    MappedFile file_;
+    uint64_t count_, duration_;
+
+    const char * next_;   /* first undecoded delta */
+    uint64_t remaining_;  /* opportunities not yet decoded */
+    uint64_t current_;
+    unsigned int run_length_;
+    uint64_t next_delta_; /* from current to the next run (0: this is the last) */
+
+    void rewind( void );
+    void check_deltas( void );
+    uint64_t read_delta( void );
+    void read_run( const uint64_t start );
+
+public:
+    static const std::string MAGIC;
+
+    BinaryLinkTrace( const std::string & filename );
+
+    uint64_t current( void ) const override { return current_; }
+    unsigned int run_length( void ) const override { return run_length_; }
+    bool advance( void ) override;
+    uint64_t duration( void ) const override { return duration_; }
+
+    /* write one pass of any trace in this format */
+    static void convert( LinkTrace & source, std::ostream & output );
+
+    /* ban copying */
+    BinaryLinkTrace( const BinaryLinkTrace & other ) = delete;
+    BinaryLinkTrace & operator=( const BinaryLinkTrace & other ) = delete;
+};
+
+#endif /* LINK_TRACE_HH */
@@ -16,6 +16,7 @@ void usage_error( const string & program_name )
     cerr << endl;
     cerr << "Options = --once" << endl;
     cerr << "          --uplink-log=FILENAME --downlink-log=FILENAME" << endl;
+    cerr << "          --binary-log" << endl;
     cerr << "          --meter-uplink --meter-uplink-delay" << endl;
     cerr << "          --meter-downlink --meter-downlink-delay" << endl;
     cerr << "          --meter-all" << endl;
@@ -82,6 +83,7 @@ int main( int argc, char *argv[] )
         const option command_line_options[] = {
             { "uplink-log",           required_argument, nullptr, 'u' },
             { "downlink-log",         required_argument, nullptr, 'd' },
+            { "binary-log",                 no_argument, nullptr, 'l' },
             { "once",                       no_argument, nullptr, 'o' },
             { "meter-uplink",               no_argument, nullptr, 'm' },
             { "meter-downlink",             no_argument, nullptr, 'n' },
@@ -96,6 +98,7 @@ int main( int argc, char *argv[] )
         };
 
         string uplink_logfile, downlink_logfile;
+        bool binary_log = false;
         bool repeat = true;
         bool meter_uplink = false, meter_downlink = false;
         bool meter_uplink_delay = false, meter_downlink_delay = false;
@@ -115,6 +118,9 @@ int main( int argc, char *argv[] )
             case 'd':
                 downlink_logfile = optarg;
                 break;
+            case 'l':
+                binary_log = true;
+                break;
             case 'o':
                 repeat = false;
                 break;
@@ -175,11 +181,11 @@ int main( int argc, char *argv[] )
         PacketShell<LinkQueue> link_shell_app( "link", user_environment );
 
         link_shell_app.start_uplink( "[link] ", command,
-                                     "Uplink", uplink_filename, uplink_logfile, repeat, meter_uplink, meter_uplink_delay,
+                                     "Uplink", uplink_filename, uplink_logfile, binary_log, repeat, meter_uplink, meter_uplink_delay,
                                      get_packet_queue( uplink_queue_type, uplink_queue_args, argv[ 0 ] ),
                                      command_line );
 
-        link_shell_app.start_downlink( "Downlink", downlink_filename, downlink_logfile, repeat, meter_downlink, meter_downlink_delay,
+        link_shell_app.start_downlink( "Downlink", downlink_filename, downlink_logfile, binary_log, repeat, meter_downlink, meter_downlink_delay,
                                        get_packet_queue( downlink_queue_type, downlink_queue_args, argv[ 0 ] ),
                                        command_line );
 
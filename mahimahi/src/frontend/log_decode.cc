@@ -0,0 +1,38 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* write a binary mm-link log (from --binary-log) in the text format */
+
+#include <fstream>
+#include <iostream>
+
+#include "link_log.hh"
+#include "util.hh"
+#include "exception.hh"
+
+using namespace std;
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc != 2 ) {
+            throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " BINARY-LOG" );
+        }
+
+        ifstream input( argv[ 1 ], ios::binary );
+        if ( not input.good() ) {
+            throw runtime_error( string( argv[ 1 ] ) + ": error opening for reading" );
+        }
+
+        BinaryLinkLog::decode( input, cout );
+
+        cout.flush();
+        if ( not cout.good() ) {
+            throw runtime_error( "error writing to standard output" );
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -11,44 +11,44 @@ LossQueue::LossQueue()
     : prng_( random_device()() )
 {}
 
-void LossQueue::read_packet( const string & contents )
+void LossQueue::read_packet( const PacketBuffer & contents, const uint64_t arrival_time __attribute((unused)) )
 {
     if ( not drop_packet( contents ) ) {
-        packet_queue_.emplace( contents );
+        packet_queue_.push( contents );
     }
 }
 
-void LossQueue::write_packets( FileDescriptor & fd )
+void LossQueue::write_packets( EgressBatch & egress )
 {
-    while ( not packet_queue_.empty() ) {
-        fd.write( packet_queue_.front() );
+    for ( auto * next = packet_queue_.front(); next; next = packet_queue_.front() ) {
+        egress.push( move( *next ) );
         packet_queue_.pop();
     }
 }
 
 unsigned int LossQueue::wait_time( void )
 {
-    return packet_queue_.empty() ? numeric_limits<uint16_t>::max() : 0;
+    return packet_queue_.empty() ? numeric_limits<uint16_t>::max() * 1000 : 0;
 }
 
-bool IIDLoss::drop_packet( const string & packet __attribute((unused)) )
+bool IIDLoss::drop_packet( const PacketBuffer & packet __attribute((unused)) )
 {
     return drop_dist_( prng_ );
 }
 
-static const double MS_PER_SECOND = 1000.0;
+static const double US_PER_SECOND = 1000000.0;
 
 SwitchingLink::SwitchingLink( const double mean_on_time, const double mean_off_time )
     : link_is_on_( false ),
-      on_process_( 1.0 / (MS_PER_SECOND * mean_off_time) ),
-      off_process_( 1.0 / (MS_PER_SECOND * mean_on_time) ),
-      next_switch_time_( timestamp() )
+      on_process_( 1.0 / (US_PER_SECOND * mean_off_time) ),
+      off_process_( 1.0 / (US_PER_SECOND * mean_on_time) ),
+      next_switch_time_( timestamp_us() )
 {}
 
 uint64_t bound( const double x )
 {
-    if ( x > (1 << 30) ) {
-        return 1 << 30;
+    if ( x > (uint64_t( 1 ) << 40) ) {
+        return uint64_t( 1 ) << 40;
     }
 
     return x;
@@ -56,7 +56,7 @@ uint64_t bound( const double x )
 
 unsigned int SwitchingLink::wait_time( void )
 {
-    const uint64_t now = timestamp();
+    const uint64_t now = timestamp_us();
 
     while ( next_switch_time_ <= now ) {
         /* switch */
@@ -69,14 +69,14 @@ unsigned int SwitchingLink::wait_time( void )
         return 0;
     }
 
-    if ( next_switch_time_ - now > numeric_limits<uint16_t>::max() ) {
-        return numeric_limits<uint16_t>::max();
+    if ( next_switch_time_ - now > numeric_limits<uint16_t>::max() * 1000u ) {
+        return numeric_limits<uint16_t>::max() * 1000;
     }
 
     return next_switch_time_ - now;
 }
 
-bool SwitchingLink::drop_packet( const string & packet __attribute((unused)) )
+bool SwitchingLink::drop_packet( const PacketBuffer & packet __attribute((unused)) )
 {
     return !link_is_on_;
 }
@@ -3,31 +3,35 @@
 #ifndef LOSS_QUEUE_HH
 #define LOSS_QUEUE_HH
 
-#include <queue>
 #include <cstdint>
-#include <string>
 #include <random>
 
-#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "egress_batch.hh"
+#include "packet_ring.hh"
+#include "timestamp.hh"
 
 class LossQueue
 {
 private:
-    std::queue<std::string> packet_queue_ {};
+    PacketRing<PacketBuffer> packet_queue_ {};
 
-    virtual bool drop_packet( const std::string & packet ) = 0;
+    virtual bool drop_packet( const PacketBuffer & packet ) = 0;
 
 protected:
     std::default_random_engine prng_;
 
 public:
     LossQueue();
+    LossQueue( LossQueue && other ) = default; /* the shells move their ferry queues */
     virtual ~LossQueue() {}
 
-    void read_packet( const std::string & contents );
+    /* a packet arrived (by default, now; a threaded ferry stamps it as it is read) */
+    void read_packet( const PacketBuffer & contents, const uint64_t arrival_time = timestamp_us() );
 
-    void write_packets( FileDescriptor & fd );
+    void write_packets( EgressBatch & egress );
 
+    /* microseconds until the next event */
     unsigned int wait_time( void );
 
     bool pending_output( void ) const { return not packet_queue_.empty(); }
@@ -40,7 +44,7 @@ class IIDLoss : public LossQueue
 private:
     std::bernoulli_distribution drop_dist_;
 
-    bool drop_packet( const std::string & packet ) override;
+    bool drop_packet( const PacketBuffer & packet ) override;
 
 public:
     IIDLoss( const double loss_rate ) : drop_dist_( loss_rate ) {}
@@ -57,7 +61,7 @@ private:
 
     void calculate_next_switch_time( void );
 
-    bool drop_packet( const std::string & packet ) override;
+    bool drop_packet( const PacketBuffer & packet ) override;
 
 public:
     SwitchingLink( const double mean_on_time_, const double mean_off_time );
@@ -17,9 +17,9 @@ MeterQueue::MeterQueue( const string & name, const bool graph )
     }
 }
 
-void MeterQueue::read_packet( const string & contents )
+void MeterQueue::read_packet( const PacketBuffer & contents, const uint64_t arrival_time __attribute((unused)) )
 {
-    packet_queue_.emplace( contents );
+    packet_queue_.push( contents );
 
     /* meter it */
     if ( graph_ ) {
@@ -27,15 +27,15 @@ void MeterQueue::read_packet( const string & contents )
     }
 }
 
-void MeterQueue::write_packets( FileDescriptor & fd )
+void MeterQueue::write_packets( EgressBatch & egress )
 {
-    while ( not packet_queue_.empty() ) {
-        fd.write( packet_queue_.front() );
+    for ( auto * next = packet_queue_.front(); next; next = packet_queue_.front() ) {
+        egress.push( move( *next ) );
         packet_queue_.pop();
     }
 }
 
 unsigned int MeterQueue::wait_time( void ) const
 {
-    return packet_queue_.empty() ? numeric_limits<uint16_t>::max() : 0;
+    return packet_queue_.empty() ? numeric_limits<uint16_t>::max() * 1000 : 0;
 }
@@ -3,26 +3,30 @@
 #ifndef METER_QUEUE_HH
 #define METER_QUEUE_HH
 
-#include <queue>
 #include <string>
 #include <memory>
 
-#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "egress_batch.hh"
+#include "packet_ring.hh"
 #include "binned_livegraph.hh"
+#include "timestamp.hh"
 
 class MeterQueue
 {
 private:
-    std::queue<std::string> packet_queue_;
+    PacketRing<PacketBuffer> packet_queue_;
     std::unique_ptr<BinnedLiveGraph> graph_;
 
 public:
     MeterQueue( const std::string & name, const bool graph );
 
-    void read_packet( const std::string & contents );
+    /* a packet arrived (by default, now; a threaded ferry stamps it as it is read) */
+    void read_packet( const PacketBuffer & contents, const uint64_t arrival_time = timestamp_us() );
 
-    void write_packets( FileDescriptor & fd );
+    void write_packets( EgressBatch & egress );
 
+    /* microseconds until the next event */
     unsigned int wait_time( void ) const;
 
     bool pending_output( void ) const { return not packet_queue_.empty(); }
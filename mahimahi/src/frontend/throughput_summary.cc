@@ -0,0 +1,254 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* summarize an mm-link log as mm-throughput-graph does (average capacity,
+   throughput and utilization, and 95th-percentile per-packet queueing and
+   signal delays), in one pass and in bounded memory */
+
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+
+#include "quantile_sketch.hh"
+#include "util.hh"
+#include "exception.hh"
+
+using namespace std;
+
+class ThroughputSummary
+{
+private:
+    bool have_base_timestamp_;
+    uint64_t base_timestamp_;
+
+    bool have_events_;
+    uint64_t first_timestamp_, last_timestamp_;
+    uint64_t capacity_bits_, departure_bits_;
+
+    QuantileSketch delays_, signal_delays_;
+
+    /* signal delay (the least delay of any packet sent in a given millisecond,
+       or for a millisecond when nothing was sent, one more than the next
+       millisecond's) is settled for each send time once a later one shows up;
+       the queues are FIFO, so the send times of departures never go back */
+    bool have_send_time_;
+    uint64_t send_time_, send_time_delay_;
+    uint64_t last_settled_send_time_;
+
+    void settle_send_time( void );
+    void record_departure( const uint64_t timestamp, const uint64_t delay );
+
+public:
+    ThroughputSummary();
+
+    void parse_line( const string & line );
+
+    void print( ostream & output );
+};
+
+ThroughputSummary::ThroughputSummary()
+    : have_base_timestamp_( false ),
+      base_timestamp_( 0 ),
+      have_events_( false ),
+      first_timestamp_( 0 ),
+      last_timestamp_( 0 ),
+      capacity_bits_( 0 ),
+      departure_bits_( 0 ),
+      delays_(),
+      signal_delays_(),
+      have_send_time_( false ),
+      send_time_( 0 ),
+      send_time_delay_( 0 ),
+      last_settled_send_time_( 0 )
+{}
+
+/* parse an unsigned decimal field, advancing past it and any following blanks */
+static bool parse_number( const char * & cursor, uint64_t & value )
+{
+    if ( not isdigit( *cursor ) ) {
+        return false;
+    }
+
+    char * end;
+    value = strtoull( cursor, &end, 10 );
+    cursor = end;
+
+    if ( *cursor and not isspace( *cursor ) ) {
+        return false;
+    }
+
+    while ( isspace( *cursor ) ) {
+        cursor++;
+    }
+
+    return true;
+}
+
+void ThroughputSummary::parse_line( const string & line )
+{
+    const string base_prefix = "# base timestamp: ";
+
+    if ( line.compare( 0, base_prefix.size(), base_prefix ) == 0 ) {
+        if ( have_base_timestamp_ ) {
+            throw runtime_error( "base timestamp multiply defined" );
+        }
+        base_timestamp_ = strtoull( line.c_str() + base_prefix.size(), nullptr, 10 );
+        have_base_timestamp_ = true;
+        return;
+    } else if ( line.empty() or line.front() == '#' ) {
+        return;
+    }
+
+    /* timestamp event_type num_bytes [delay] */
+    const char * cursor = line.c_str();
+    uint64_t timestamp, num_bytes, delay = 0;
+
+    if ( not parse_number( cursor, timestamp ) ) {
+        throw runtime_error( "Invalid timestamp: " + line );
+    }
+
+    const char event_type = *cursor;
+    if ( not event_type or not isspace( cursor[ 1 ] ) ) {
+        throw runtime_error( "Format: timestamp event_type num_bytes [delay]: " + line );
+    }
+    cursor += 2;
+
+    if ( not parse_number( cursor, num_bytes ) ) {
+        throw runtime_error( "Invalid byte count: " + line );
+    }
+
+    if ( not have_base_timestamp_ ) {
+        throw runtime_error( "logfile is missing base timestamp" );
+    }
+
+    if ( timestamp < base_timestamp_ ) {
+        throw runtime_error( "timestamp before base timestamp: " + line );
+    }
+    timestamp -= base_timestamp_; /* correct for startup time variation */
+
+    if ( not have_events_ ) {
+        first_timestamp_ = last_timestamp_ = timestamp;
+        have_events_ = true;
+    }
+    last_timestamp_ = max( timestamp, last_timestamp_ );
+
+    switch ( event_type ) {
+    case '+':
+        break;
+    case '#':
+        capacity_bits_ += num_bytes * 8;
+        break;
+    case '-':
+        if ( not parse_number( cursor, delay ) ) {
+            throw runtime_error( "Departure format: timestamp - num_bytes delay: " + line );
+        }
+        if ( delay > timestamp ) {
+            throw runtime_error( "Invalid timestamp and delay: " + line );
+        }
+        departure_bits_ += num_bytes * 8;
+        record_departure( timestamp, delay );
+        break;
+    default:
+        throw runtime_error( "Unknown event type: " + line );
+    }
+}
+
+void ThroughputSummary::record_departure( const uint64_t timestamp, const uint64_t delay )
+{
+    delays_.add( delay );
+
+    const uint64_t send_time = timestamp - delay;
+
+    if ( have_send_time_ and send_time == send_time_ ) {
+        send_time_delay_ = min( send_time_delay_, delay );
+        return;
+    }
+
+    if ( have_send_time_ ) {
+        if ( send_time < send_time_ ) {
+            throw runtime_error( "departures out of arrival order at " + to_string( timestamp )
+                                 + " ms (signal delay needs a FIFO queue)" );
+        }
+        settle_send_time();
+    }
+
+    have_send_time_ = true;
+    send_time_ = send_time;
+    send_time_delay_ = delay;
+}
+
+void ThroughputSummary::settle_send_time( void )
+{
+    /* fill in the milliseconds since the last send time, counting down to this one */
+    if ( last_settled_send_time_ < send_time_ and signal_delays_.samples() ) {
+        for ( uint64_t gap = send_time_ - last_settled_send_time_ - 1; gap > 0; gap-- ) {
+            signal_delays_.add( send_time_delay_ + gap );
+        }
+    }
+
+    signal_delays_.add( send_time_delay_ );
+    last_settled_send_time_ = send_time_;
+}
+
+void ThroughputSummary::print( ostream & output )
+{
+    if ( not delays_.samples() ) {
+        throw runtime_error( "Must have at least one departure event" );
+    }
+
+    if ( last_timestamp_ == first_timestamp_ ) {
+        throw runtime_error( "log covers no time" );
+    }
+
+    settle_send_time();
+    have_send_time_ = false;
+
+    const double duration = (last_timestamp_ - first_timestamp_) / 1000.0;
+    const double average_capacity = capacity_bits_ / duration / 1000000.0;
+    const double average_throughput = departure_bits_ / duration / 1000000.0;
+
+    char buffer[ 256 ];
+
+    snprintf( buffer, sizeof( buffer ), "Average capacity: %.2f Mbits/s\n", average_capacity );
+    output << buffer;
+    snprintf( buffer, sizeof( buffer ), "Average throughput: %.2f Mbits/s (%.1f%% utilization)\n",
+              average_throughput, 100.0 * average_throughput / average_capacity );
+    output << buffer;
+    output << "95th percentile per-packet queueing delay: " << delays_.quantile( 0.95 ) << " ms\n";
+    output << "95th percentile signal delay: " << signal_delays_.quantile( 0.95 ) << " ms\n";
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc > 2 ) {
+            throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " [LOGFILE]" );
+        }
+
+        ifstream file;
+        if ( argc == 2 ) {
+            file.open( argv[ 1 ] );
+            if ( not file.good() ) {
+                throw runtime_error( string( argv[ 1 ] ) + ": error opening for reading" );
+            }
+        }
+        istream & input = argc == 2 ? file : cin;
+
+        ios::sync_with_stdio( false );
+
+        ThroughputSummary summary;
+        string line;
+        while ( getline( input, line ) ) {
+            summary.parse_line( line );
+        }
+
+        summary.print( cout );
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
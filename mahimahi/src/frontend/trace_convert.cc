@@ -0,0 +1,34 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* convert an mm-link trace (text or binary) to the binary format */
+
+#include <fstream>
+
+#include "link_trace.hh"
+#include "util.hh"
+#include "exception.hh"
+
+using namespace std;
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc != 3 ) {
+            throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " INPUT-TRACE OUTPUT-TRACE" );
+        }
+
+        const unique_ptr<LinkTrace> source = LinkTrace::open( argv[ 1 ] );
+
+        ofstream output( argv[ 2 ], ios::binary | ios::trunc );
+        if ( not output.good() ) {
+            throw runtime_error( string( argv[ 2 ] ) + ": error opening for writing" );
+        }
+
+        BinaryLinkTrace::convert( *source, output );
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
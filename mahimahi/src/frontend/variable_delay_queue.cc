@@ -0,0 +1,121 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+
+#include "variable_delay_queue.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+VariableDelayQueue::VariableDelayQueue( const bool preserve_order )
+    : preserve_order_( preserve_order ),
+      packet_queue_( timestamp_us() ),
+      fifo_( preserve_order ? PacketRing< pair<uint64_t, PacketBuffer> >::DEFAULT_CAPACITY : 1 ),
+      last_release_( 0 )
+{}
+
+void VariableDelayQueue::read_packet( const PacketBuffer & contents, const uint64_t arrival_time )
+{
+    const uint64_t release = arrival_time + packet_delay( arrival_time );
+
+    if ( preserve_order_ ) {
+        /* not before the packet ahead of it */
+        last_release_ = max( release, last_release_ );
+        fifo_.emplace( last_release_, contents );
+    } else {
+        PacketBuffer packet( contents );
+        packet_queue_.insert( release, move( packet ) );
+    }
+}
+
+void VariableDelayQueue::write_packets( EgressBatch & egress )
+{
+    const uint64_t now = timestamp_us();
+
+    if ( preserve_order_ ) {
+        for ( auto * next = fifo_.front();
+              next and next->first <= now;
+              next = fifo_.front() ) {
+            egress.push( move( next->second ) );
+            fifo_.pop();
+        }
+        return;
+    }
+
+    packet_queue_.advance( now,
+                           [&] ( const uint64_t, PacketBuffer && packet ) { egress.push( move( packet ) ); } );
+}
+
+unsigned int VariableDelayQueue::wait_time( void )
+{
+    const unsigned int idle = numeric_limits<uint16_t>::max() * 1000;
+
+    if ( preserve_order_ ? fifo_.empty() : packet_queue_.empty() ) {
+        return idle;
+    }
+
+    const auto now = timestamp_us();
+
+    /* bring what is due down to level 0, where pending_output sees it */
+    if ( not preserve_order_ ) {
+        packet_queue_.cascade( now );
+    }
+
+    const uint64_t next = preserve_order_ ? fifo_.front()->first : packet_queue_.next_deadline();
+
+    if ( next <= now ) {
+        return 0;
+    } else {
+        return min( next - now, uint64_t( idle ) );
+    }
+}
+
+bool VariableDelayQueue::pending_output( void ) const
+{
+    const auto now = timestamp_us();
+
+    if ( preserve_order_ ) {
+        return not fifo_.empty() and fifo_.front()->first <= now;
+    }
+
+    return packet_queue_.due( now );
+}
+
+JitterDelayQueue::Distribution JitterDelayQueue::distribution( const string & name )
+{
+    if ( name == "uniform" ) {
+        return Distribution::Uniform;
+    } else if ( name == "normal" ) {
+        return Distribution::Normal;
+    }
+    throw runtime_error( "unknown jitter distribution " + name );
+}
+
+JitterDelayQueue::JitterDelayQueue( const uint64_t delay_us, const uint64_t jitter_us,
+                                    const Distribution distribution, const bool preserve_order )
+    : VariableDelayQueue( preserve_order ),
+      delay_us_( delay_us ),
+      jitter_us_( jitter_us ),
+      distribution_( distribution ),
+      prng_( random_device()() )
+{}
+
+uint64_t JitterDelayQueue::packet_delay( const uint64_t arrival_time __attribute((unused)) )
+{
+    const double offset = distribution_ == Distribution::Uniform ? uniform_( prng_ ) : normal_( prng_ );
+    const double delay = delay_us_ + offset * jitter_us_;
+    return delay > 0 ? llround( delay ) : 0;
+}
+
+TraceDelayQueue::TraceDelayQueue( const string & filename, const bool preserve_order )
+    : VariableDelayQueue( preserve_order ),
+      trace_( filename ),
+      base_timestamp_( timestamp_us() )
+{}
+
+uint64_t TraceDelayQueue::packet_delay( const uint64_t arrival_time )
+{
+    return trace_.delay_at( arrival_time > base_timestamp_ ? arrival_time - base_timestamp_ : 0 );
+}
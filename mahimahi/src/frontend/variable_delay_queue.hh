@@ -0,0 +1,95 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef VARIABLE_DELAY_QUEUE_HH
+#define VARIABLE_DELAY_QUEUE_HH
+
+#include <cstdint>
+#include <string>
+#include <random>
+
+#include "packet_buffer.hh"
+#include "egress_batch.hh"
+#include "packet_ring.hh"
+#include "timing_wheel.hh"
+#include "delay_trace.hh"
+#include "timestamp.hh"
+
+/* Like DelayQueue, but each packet has a delay of its own. Packets may
+   then leave in a different order than they came, waiting in a timing
+   wheel, whose work per packet does not grow with how many are in
+   flight (though its cache misses do, as a heap's would).
+   Or they may keep their order: a packet is held until the one before
+   it has left, and a FIFO does. */
+class VariableDelayQueue
+{
+private:
+    bool preserve_order_;
+
+    TimingWheel<PacketBuffer> packet_queue_; /* when reordering */
+
+    PacketRing< std::pair<uint64_t, PacketBuffer> > fifo_; /* when preserving order */
+    uint64_t last_release_;
+
+    /* the delay (us) of a packet arriving at the given time */
+    virtual uint64_t packet_delay( const uint64_t arrival_time ) = 0;
+
+public:
+    VariableDelayQueue( const bool preserve_order );
+    VariableDelayQueue( VariableDelayQueue && other ) = default; /* the shells move their ferry queues */
+    virtual ~VariableDelayQueue() {}
+
+    /* a packet arrived (by default, now; a threaded ferry stamps it as it is read) */
+    void read_packet( const PacketBuffer & contents, const uint64_t arrival_time = timestamp_us() );
+
+    void write_packets( EgressBatch & egress );
+
+    /* microseconds until the next packet is due (or until the wheel
+       next needs to cascade, which releases nothing) */
+    unsigned int wait_time( void );
+
+    /* whether a packet is due now */
+    bool pending_output( void ) const;
+
+    static bool finished( void ) { return false; }
+};
+
+/* a fixed delay, plus or minus random jitter */
+class JitterDelayQueue : public VariableDelayQueue
+{
+public:
+    enum class Distribution { Uniform, Normal };
+
+    /* "uniform" or "normal" */
+    static Distribution distribution( const std::string & name );
+
+private:
+    uint64_t delay_us_, jitter_us_;
+    Distribution distribution_;
+
+    std::default_random_engine prng_;
+    std::uniform_real_distribution<> uniform_ { -1.0, 1.0 };
+    std::normal_distribution<> normal_ {};
+
+    uint64_t packet_delay( const uint64_t arrival_time ) override;
+
+public:
+    /* uniform: within jitter of the delay; normal: the delay on average,
+       with jitter as standard deviation. Never less than 0. */
+    JitterDelayQueue( const uint64_t delay_us, const uint64_t jitter_us,
+                      const Distribution distribution, const bool preserve_order );
+};
+
+/* a delay that follows a DelayTrace, from when the queue is made */
+class TraceDelayQueue : public VariableDelayQueue
+{
+private:
+    DelayTrace trace_;
+    uint64_t base_timestamp_;
+
+    uint64_t packet_delay( const uint64_t arrival_time ) override;
+
+public:
+    TraceDelayQueue( const std::string & filename, const bool preserve_order );
+};
+
+#endif /* VARIABLE_DELAY_QUEUE_HH */
@@ -0,0 +1,33 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include "egress_batch.hh"
+
+using namespace std;
+
+EgressBatch::EgressBatch()
+    : packets_(),
+      packets_written_( 0 ),
+      write_calls_( 0 )
+{}
+
+void EgressBatch::flush( FileDescriptor & fd )
+{
+    for ( const auto & packet : packets_ ) {
+        fd.write( packet );
+        write_calls_++;
+    }
+
+    packets_written_ += packets_.size();
+
+    /* keeps the vector's capacity for the next wakeup */
+    packets_.clear();
+}
+
+void EgressBatch::hand_off( PacketRing<PacketBuffer> & ring )
+{
+    for ( auto & packet : packets_ ) {
+        ring.push( move( packet ) );
+    }
+
+    packets_.clear();
+}
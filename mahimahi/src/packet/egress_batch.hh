@@ -0,0 +1,52 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef EGRESS_BATCH_HH
+#define EGRESS_BATCH_HH
+
+#include <vector>
+#include <cstdint>
+
+#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "packet_ring.hh"
+
+/* packets a ferry queue has released, flushed to the sibling's TUN
+   device together in one pass per wakeup. A TUN device takes exactly
+   one packet per write(2), so one write per packet is the floor; what
+   the batch saves is the per-packet trip through the poller. */
+class EgressBatch
+{
+private:
+    std::vector<PacketBuffer> packets_;
+
+    uint64_t packets_written_, write_calls_;
+
+public:
+    EgressBatch();
+
+    /* a packet is ready to leave */
+    void push( PacketBuffer && packet ) { packets_.emplace_back( std::move( packet ) ); }
+
+    typedef std::vector<PacketBuffer>::const_iterator const_iterator;
+
+    /* what is ready, for a caller that passes it on itself (then clear()s) */
+    const_iterator begin( void ) const { return packets_.begin(); }
+    const_iterator end( void ) const { return packets_.end(); }
+
+    bool empty( void ) const { return packets_.empty(); }
+    size_t size( void ) const { return packets_.size(); }
+
+    /* drop everything without writing it (for replays with no TUN device, or once passed on) */
+    void clear( void ) { packets_.clear(); }
+
+    /* write everything that is ready */
+    void flush( FileDescriptor & fd );
+
+    /* or pass it all to another thread, which will write it (not counted here) */
+    void hand_off( PacketRing<PacketBuffer> & ring );
+
+    uint64_t packets_written( void ) const { return packets_written_; }
+    uint64_t write_calls( void ) const { return write_calls_; }
+};
+
+#endif /* EGRESS_BATCH_HH */
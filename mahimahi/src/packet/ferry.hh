@@ -0,0 +1,133 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FERRY_HH
+#define FERRY_HH
+
+#include <string>
+#include <memory>
+
+#include "event_loop.hh"
+#include "file_descriptor.hh"
+#include "ferry_stats.hh"
+#include "ferry_threads.hh"
+#include "ingress_batch.hh"
+#include "egress_batch.hh"
+#include "timestamp.hh"
+
+/* one direction of a packetshell: packets read from a TUN device go
+   through the ferry queue and out to the sibling's TUN device */
+template <class FerryQueueType>
+class Ferry : public EventLoop
+{
+private:
+    /* most packets taken from the TUN device per wakeup */
+    const static unsigned int INGRESS_BATCH_SIZE = 64;
+
+    const unsigned int threads_;
+
+    FerryStats stats_;
+
+public:
+    /* threads: 1, or 3 to read and write the TUN devices on threads of their own.
+       Every fd in the loop is read or written only by its own actions, so
+       it can use epoll */
+    Ferry( const std::string & name, const unsigned int threads )
+        : EventLoop( Poller::Backend::Epoll ), threads_( threads ), stats_( name ) {}
+
+    int loop( FerryQueueType & ferry_queue, FileDescriptor & tun, FileDescriptor & sibling );
+};
+
+template <class FerryQueueType>
+int Ferry<FerryQueueType>::loop( FerryQueueType & ferry_queue,
+                                 FileDescriptor & tun,
+                                 FileDescriptor & sibling )
+{
+    using namespace PollerShortNames;
+
+    /* drain the tun device without blocking once poll says it's readable
+       (TUN writes never block in practice, so the shared O_NONBLOCK is harmless) */
+    tun.set_blocking( false );
+    IngressBatch ingress( INGRESS_BATCH_SIZE );
+    EgressBatch egress;
+
+    /* or leave reading and writing the TUN devices to threads of their own */
+    std::unique_ptr<FerryThreads> threads;
+
+    if ( threads_ == 3 ) {
+        threads.reset( new FerryThreads( tun, sibling, INGRESS_BATCH_SIZE ) );
+
+        /* ingress thread has stamped datagrams -> give them to ferry */
+        add_simple_input_handler( threads->arrivals_ready(),
+                                  [&] () {
+                                      threads->deliver_arrivals( ferry_queue );
+                                      return ResultType::Continue;
+                                  } );
+    } else {
+        /* tun device gets datagrams -> read all that are ready -> give to ferry */
+        add_simple_input_handler( tun,
+                                  [&] () {
+                                      ingress.drain( tun );
+                                      for ( const auto & packet : ingress ) {
+                                          ferry_queue.read_packet( packet );
+                                      }
+                                      return ResultType::Continue;
+                                  } );
+
+        /* ferry ready to write datagrams -> send all of them to sibling's tun device */
+        add_action( Poller::Action( sibling, Direction::Out,
+                                    [&] () {
+                                        ferry_queue.write_packets( egress );
+                                        egress.flush( sibling );
+                                        return ResultType::Continue;
+                                    },
+                                    [&] () { return ferry_queue.pending_output(); } ) );
+    }
+
+    /* exit if finished */
+    add_action( Poller::Action( sibling, Direction::Out,
+                                [&] () {
+                                    return Result( ResultType::Exit, 77 );
+                                },
+                                [&] () { return ferry_queue.finished(); } ) );
+
+    /* wake (via timerfd) exactly when the queue's next event is due. Threaded,
+       nothing on this thread writes the sibling (so no action can poll it for
+       that): instead, what is due is handed to the egress thread each time
+       round the loop, which that same timer wakes. wait_time comes first,
+       since it is what brings a link's queue up to now (releasing what the
+       opportunity that woke us delivers), and again after each hand-off. */
+    const int ret = internal_loop_until( [&] () {
+            unsigned int wait = ferry_queue.wait_time();
+            while ( threads and ferry_queue.pending_output() ) {
+                ferry_queue.write_packets( egress );
+                threads->depart( egress );
+                wait = ferry_queue.wait_time();
+            }
+            return timestamp_us() + wait;
+        } );
+
+    stats_.threads = threads_;
+    stats_.poll_calls = poll_calls();
+    stats_.lateness = lateness();
+
+    if ( threads ) {
+        threads->stop();
+        stats_.packets_in = threads->ingress().packets_read();
+        stats_.read_calls = threads->ingress().read_calls();
+        stats_.packets_out = threads->egress().packets_written();
+        stats_.write_calls = threads->egress().write_calls();
+        stats_.poll_calls += threads->ingress_poll_calls();
+        stats_.ring_overflows = threads->ring_overflows();
+    } else {
+        stats_.packets_in = ingress.packets_read();
+        stats_.read_calls = ingress.read_calls();
+        stats_.packets_out = egress.packets_written();
+        stats_.write_calls = egress.write_calls();
+    }
+
+    stats_.report_if_requested();
+
+    return ret;
+}
+
+#endif /* FERRY_HH */
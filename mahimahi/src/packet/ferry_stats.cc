@@ -0,0 +1,62 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "ferry_stats.hh"
+
+using namespace std;
+
+FerryStats::FerryStats( const string & s_name )
+    : name( s_name ),
+      packets_in( 0 ), read_calls( 0 ),
+      packets_out( 0 ), write_calls( 0 ),
+      poll_calls( 0 ),
+      threads( 1 ), ring_overflows( 0 ),
+      lateness()
+{}
+
+static double per_packet( const uint64_t calls, const uint64_t packets )
+{
+    return packets ? double( calls ) / packets : 0;
+}
+
+string FerryStats::summary( void ) const
+{
+    ostringstream ret;
+    ret << fixed << setprecision( 3 );
+
+    ret << name << ": "
+        << packets_in << " packets in (" << read_calls << " reads, "
+        << per_packet( read_calls, packets_in ) << "/packet), "
+        << packets_out << " packets out (" << write_calls << " writes, "
+        << per_packet( write_calls, packets_out ) << "/packet), "
+        << poll_calls << " polls, "
+        << per_packet( read_calls + write_calls + poll_calls, packets_out ) << " syscalls/packet, ";
+
+    if ( threads > 1 ) {
+        ret << threads << " threads (" << ring_overflows << " packets dropped at full rings), ";
+    }
+
+    ret << "timer lateness " << lateness.str();
+
+    return ret.str();
+}
+
+void FerryStats::report_if_requested( void ) const
+{
+    const char * const filename = getenv( "MAHIMAHI_FERRY_STATS" );
+    if ( not filename ) {
+        return;
+    }
+
+    ofstream stats_file( filename, ios::app );
+    if ( not stats_file.good() ) {
+        throw runtime_error( string( filename ) + ": error opening for appending" );
+    }
+
+    stats_file << summary() << endl;
+}
@@ -0,0 +1,36 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FERRY_STATS_HH
+#define FERRY_STATS_HH
+
+#include <string>
+#include <cstdint>
+
+#include "latency_histogram.hh"
+
+/* per-direction syscall accounting and timer lateness for a ferry, appended
+   as one line to the file named by $MAHIMAHI_FERRY_STATS (if set) when the
+   ferry exits */
+struct FerryStats
+{
+    std::string name;
+
+    uint64_t packets_in, read_calls;
+    uint64_t packets_out, write_calls;
+    uint64_t poll_calls;
+
+    /* with more than one thread, packets dropped because a ring between them was full */
+    unsigned int threads;
+    uint64_t ring_overflows;
+
+    /* how long after its deadline each timer wakeup ran */
+    LatencyHistogram lateness;
+
+    FerryStats( const std::string & s_name );
+
+    std::string summary( void ) const;
+
+    void report_if_requested( void ) const;
+};
+
+#endif /* FERRY_STATS_HH */
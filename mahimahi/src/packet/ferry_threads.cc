@@ -0,0 +1,167 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <iostream>
+
+#include <unistd.h>
+
+#include "ferry_threads.hh"
+#include "poller.hh"
+#include "timestamp.hh"
+#include "exception.hh"
+
+using namespace std;
+using namespace PollerShortNames;
+
+FerryThreads::FerryThreads( FileDescriptor & tun, FileDescriptor & sibling,
+                            const unsigned int ingress_batch_size )
+    : tun_( SystemCall( "dup", dup( tun.fd_num() ) ) ),
+      sibling_( SystemCall( "dup", dup( sibling.fd_num() ) ) ),
+      arrivals_( PacketRing<Arrival>::DEFAULT_CAPACITY, PacketRing<Arrival>::WhenFull::Drop ),
+      departures_( PacketRing<PacketBuffer>::DEFAULT_CAPACITY, PacketRing<PacketBuffer>::WhenFull::Drop ),
+      arrivals_ready_(),
+      departures_ready_(),
+      halt_ingress_(),
+      egress_asleep_( false ),
+      halt_( false ),
+      ingress_( ingress_batch_size ),
+      egress_(),
+      ingress_poll_calls_( 0 ),
+      failed_( false ),
+      ingress_exception_(),
+      egress_exception_(),
+      ingress_thread_(),
+      egress_thread_()
+{
+    /* packets will now be read, queued and released on different threads */
+    PacketBufferPool::global().share_between_threads();
+
+    ingress_thread_ = thread( [&] () {
+            try {
+                ingress_loop();
+            } catch ( ... ) {
+                ingress_exception_ = current_exception();
+                failed_ = true;
+                arrivals_ready_.signal();
+            } } );
+
+    egress_thread_ = thread( [&] () {
+            try {
+                egress_loop();
+            } catch ( ... ) {
+                egress_exception_ = current_exception();
+                failed_ = true;
+                arrivals_ready_.signal();
+            } } );
+}
+
+void FerryThreads::ingress_loop( void )
+{
+    /* each fd is read only by its own action, as in the ferry's loop */
+    Poller poller( Poller::Backend::Epoll );
+
+    /* read everything that is ready, stamp it, and wake the queue */
+    poller.add_action( Poller::Action( tun_, Direction::In,
+                                       [&] () {
+                                           ingress_.drain( tun_ );
+                                           if ( ingress_.size() == 0 ) {
+                                               return ResultType::Continue;
+                                           }
+
+                                           const uint64_t now = timestamp_us();
+                                           for ( const auto & packet : ingress_ ) {
+                                               arrivals_.emplace( now, packet );
+                                           }
+                                           arrivals_ready_.signal();
+                                           return ResultType::Continue;
+                                       } ) );
+
+    poller.add_action( Poller::Action( halt_ingress_.fd(), Direction::In,
+                                       [] () { return Result( ResultType::Exit ); } ) );
+
+    while ( poller.poll( -1 ).result != Poller::Result::Type::Exit ) {}
+
+    ingress_poll_calls_ = poller.poll_calls();
+}
+
+void FerryThreads::egress_loop( void )
+{
+    while ( true ) {
+        /* check before draining, so that nothing released before the halt is left behind */
+        const bool halting = halt_;
+
+        for ( auto * next = departures_.front();
+              next and egress_.size() < EGRESS_BATCH_SIZE;
+              next = departures_.front() ) {
+            egress_.push( move( *next ) );
+            departures_.pop();
+        }
+
+        if ( not egress_.empty() ) {
+            egress_.flush( sibling_ );
+            continue;
+        }
+
+        if ( halting ) {
+            break;
+        }
+
+        /* sleep until rung: say so, then look once more, since depart()
+           only rings after it has pushed and then seen the flag */
+        egress_asleep_ = true;
+        atomic_thread_fence( memory_order_seq_cst );
+        if ( departures_.empty() and not halt_ ) {
+            departures_ready_.read_count();
+        }
+        egress_asleep_ = false;
+    }
+}
+
+void FerryThreads::depart( EgressBatch & released )
+{
+    if ( released.empty() ) {
+        return;
+    }
+
+    released.hand_off( departures_ );
+
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( egress_asleep_.load( memory_order_relaxed ) ) {
+        departures_ready_.signal();
+    }
+}
+
+void FerryThreads::rethrow_if_failed( void ) const
+{
+    if ( not failed_ ) {
+        return;
+    }
+
+    if ( ingress_exception_ != exception_ptr() ) {
+        rethrow_exception( ingress_exception_ );
+    }
+
+    rethrow_exception( egress_exception_ );
+}
+
+void FerryThreads::stop( void )
+{
+    if ( not ingress_thread_.joinable() ) {
+        return;
+    }
+
+    halt_ = true;
+    halt_ingress_.signal();
+    departures_ready_.signal();
+
+    ingress_thread_.join();
+    egress_thread_.join();
+}
+
+FerryThreads::~FerryThreads()
+{
+    try {
+        stop();
+    } catch ( const exception & e ) { /* don't throw from destructor */
+        print_exception( e );
+    }
+}
@@ -0,0 +1,104 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FERRY_THREADS_HH
+#define FERRY_THREADS_HH
+
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <utility>
+#include <cstdint>
+
+#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "packet_ring.hh"
+#include "ingress_batch.hh"
+#include "egress_batch.hh"
+#include "eventfd.hh"
+
+/* The outer stages of a threaded ferry, each on a thread of its own: one
+   reads the TUN device and stamps each packet with the time it was read,
+   the other writes what the queue releases to the sibling's TUN device.
+   The ferry's own thread runs the queue between them, and the stages hand
+   packets on through SPSCRings. The queue sees the same arrival times as
+   it would with one thread, so the trace keeps its schedule, while the
+   system calls at either end run on other cores. */
+class FerryThreads
+{
+public:
+    typedef std::pair<uint64_t, PacketBuffer> Arrival; /* time read (us), contents */
+
+private:
+    /* most packets the egress thread takes from its ring per pass */
+    const static unsigned int EGRESS_BATCH_SIZE = 64;
+
+    /* the stages' own duplicates of the ferry's fds, so that what a
+       FileDescriptor counts is only ever touched by one thread */
+    FileDescriptor tun_;
+    FileDescriptor sibling_;
+
+    /* between threads, so bounded: they drop (and count) when full */
+    PacketRing<Arrival> arrivals_;        /* ingress thread -> queue */
+    PacketRing<PacketBuffer> departures_; /* queue -> egress thread */
+
+    EventFD arrivals_ready_;   /* polled by the ferry's own thread */
+    EventFD departures_ready_; /* rung only while the egress thread sleeps */
+    EventFD halt_ingress_;
+    std::atomic<bool> egress_asleep_;
+    std::atomic<bool> halt_;
+
+    IngressBatch ingress_; /* the ingress thread's */
+    EgressBatch egress_;   /* the egress thread's */
+    uint64_t ingress_poll_calls_;
+
+    std::atomic<bool> failed_;
+    std::exception_ptr ingress_exception_, egress_exception_;
+
+    std::thread ingress_thread_, egress_thread_;
+
+    void ingress_loop( void );
+    void egress_loop( void );
+
+    /* a stage's thread has stopped from an exception: pass it on */
+    void rethrow_if_failed( void ) const;
+
+public:
+    /* starts both threads (the TUN device must already be nonblocking) */
+    FerryThreads( FileDescriptor & tun, FileDescriptor & sibling,
+                  const unsigned int ingress_batch_size );
+    ~FerryThreads();
+
+    /* the ferry's thread polls this for input when arrivals are waiting */
+    FileDescriptor & arrivals_ready( void ) { return arrivals_ready_.fd(); }
+
+    /* give the queue every packet that has arrived, with the time it was read */
+    template <class FerryQueueType>
+    void deliver_arrivals( FerryQueueType & queue )
+    {
+        arrivals_ready_.read_count();
+        rethrow_if_failed();
+
+        for ( auto * next = arrivals_.front(); next; next = arrivals_.front() ) {
+            queue.read_packet( next->second, next->first );
+            arrivals_.pop();
+        }
+    }
+
+    /* pass what the queue released to the egress thread */
+    void depart( EgressBatch & released );
+
+    /* stop both threads, once every packet already released is written */
+    void stop( void );
+
+    /* after stop(), the outer stages' accounting */
+    const IngressBatch & ingress( void ) const { return ingress_; }
+    const EgressBatch & egress( void ) const { return egress_; }
+    uint64_t ingress_poll_calls( void ) const { return ingress_poll_calls_; }
+    uint64_t ring_overflows( void ) const { return arrivals_.overflows() + departures_.overflows(); }
+
+    /* forbid copying */
+    FerryThreads( const FerryThreads & other ) = delete;
+    FerryThreads & operator=( const FerryThreads & other ) = delete;
+};
+
+#endif /* FERRY_THREADS_HH */
@@ -0,0 +1,39 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <stdexcept>
+
+#include "ingress_batch.hh"
+
+using namespace std;
+
+IngressBatch::IngressBatch( const unsigned int capacity )
+    : buffers_( capacity ),
+      size_( 0 ),
+      packets_read_( 0 ),
+      read_calls_( 0 )
+{
+    if ( capacity == 0 ) {
+        throw runtime_error( "IngressBatch: capacity must be positive" );
+    }
+}
+
+unsigned int IngressBatch::drain( FileDescriptor & fd )
+{
+    size_ = 0;
+
+    while ( size_ < buffers_.size() ) {
+        read_calls_++;
+        if ( not fd.read_into( buffers_[ size_ ] ) ) {
+            break; /* nothing more ready */
+        }
+
+        if ( fd.eof() ) {
+            break;
+        }
+
+        size_++;
+    }
+
+    packets_read_ += size_;
+    return size_;
+}
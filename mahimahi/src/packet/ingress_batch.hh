@@ -0,0 +1,42 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef INGRESS_BATCH_HH
+#define INGRESS_BATCH_HH
+
+#include <vector>
+#include <cstdint>
+
+#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+
+/* ring of pooled receive buffers that drains every packet a (nonblocking)
+   TUN device has ready at once; a slot's slab is reused on the next wakeup
+   unless a queue is still holding on to it */
+class IngressBatch
+{
+private:
+    std::vector<PacketBuffer> buffers_;
+    unsigned int size_;
+
+    uint64_t packets_read_, read_calls_;
+
+public:
+    typedef std::vector<PacketBuffer>::const_iterator const_iterator;
+
+    IngressBatch( const unsigned int capacity );
+
+    /* read packets until the fd would block or the ring is full */
+    unsigned int drain( FileDescriptor & fd );
+
+    const_iterator begin( void ) const { return buffers_.begin(); }
+    const_iterator end( void ) const { return buffers_.begin() + size_; }
+
+    unsigned int size( void ) const { return size_; }
+    unsigned int capacity( void ) const { return buffers_.size(); }
+
+    /* totals, including the read that finds the fd empty */
+    uint64_t packets_read( void ) const { return packets_read_; }
+    uint64_t read_calls( void ) const { return read_calls_; }
+};
+
+#endif /* INGRESS_BATCH_HH */
@@ -0,0 +1,84 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PACKET_RING_HH
+#define PACKET_RING_HH
+
+#include <iostream>
+#include <cstdint>
+#include <memory>
+
+#include "spsc_ring.hh"
+
+/* the store behind a ferry queue: packet handles (or whatever a queue
+   keeps with them) in a preallocated SPSCRing, instead of a std::queue
+   whose deque allocates chunks as it grows. A queue's ring grows (to
+   twice the size) when it fills, since a delay line or a link's output
+   must never drop what the emulation has not chosen to drop; that needs
+   the pushing and popping on one thread, as a ferry queue's are. A ring
+   between two threads can't grow under its consumer, so like a NIC's
+   ring it is bounded, and drops (and counts) what arrives when it is
+   full. (The ring is held by pointer, which keeps the queue movable, as
+   the shells need their ferry queues to be.) */
+template <typename T>
+class PacketRing
+{
+public:
+    enum class WhenFull { Grow, Drop };
+
+private:
+    std::unique_ptr<SPSCRing<T>> ring_;
+    WhenFull when_full_;
+    uint64_t overflows_; /* producer's */
+
+    /* move everything into a ring twice the size */
+    void grow( void )
+    {
+        std::unique_ptr<SPSCRing<T>> bigger( new SPSCRing<T>( ring_->capacity() * 2 ) );
+        for ( T * next = ring_->front(); next; next = ring_->front() ) {
+            bigger->push( std::move( *next ) );
+            ring_->pop();
+        }
+        ring_ = std::move( bigger );
+    }
+
+    template <typename Item>
+    void push_item( Item && item )
+    {
+        if ( ring_->push( std::forward<Item>( item ) ) ) {
+            return;
+        }
+
+        if ( when_full_ == WhenFull::Grow ) {
+            grow();
+            ring_->push( std::forward<Item>( item ) ); /* untouched by the failed push */
+        } else if ( overflows_++ == 0 ) {
+            std::cerr << "Packet ring full (" << ring_->capacity() << " packets); dropping." << std::endl;
+        }
+    }
+
+public:
+    /* 2^17 slots: over a second of packets at 100k packets/s */
+    const static size_t DEFAULT_CAPACITY = 1 << 17;
+
+    PacketRing( const size_t capacity = DEFAULT_CAPACITY, const WhenFull when_full = WhenFull::Grow )
+        : ring_( new SPSCRing<T>( capacity ) ), when_full_( when_full ), overflows_( 0 )
+    {}
+
+    /* producer: queue the item (growing the ring, or dropping the item, if it is full) */
+    void push( const T & item ) { push_item( item ); }
+    void push( T && item ) { push_item( std::move( item ) ); }
+
+    template <typename... Args>
+    void emplace( Args &&... args ) { push( T( std::forward<Args>( args )... ) ); }
+
+    /* consumer: the oldest item, if any, and dropping it */
+    T * front( void ) { return ring_->front(); }
+    const T * front( void ) const { return static_cast<const SPSCRing<T> &>( *ring_ ).front(); }
+    void pop( void ) { ring_->pop(); }
+    bool empty( void ) const { return ring_->empty(); }
+
+    /* items dropped (only a ring that drops drops any) */
+    uint64_t overflows( void ) const { return overflows_; }
+};
+
+#endif /* PACKET_RING_HH */
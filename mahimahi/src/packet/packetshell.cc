@@ -16,6 +16,7 @@
 #include "timestamp.hh"
 #include "exception.hh"
 #include "bindworkaround.hh"
+#include "ferry.hh"
 #include "config.h"
 
 using namespace std;
@@ -24,12 +25,14 @@ using namespace PollerShortNames;
 template <class FerryQueueType>
 PacketShell<FerryQueueType>::PacketShell( const std::string & device_prefix, char ** const user_environment )
     : user_environment_( user_environment ),
+      device_prefix_( device_prefix ),
       egress_ingress( two_unassigned_addresses( get_mahimahi_base() ) ),
       nameserver_( first_nameserver() ),
       egress_tun_( device_prefix + "-" + to_string( getpid() ) , egress_addr(), ingress_addr() ),
       dns_outside_( egress_addr(), nameserver_, nameserver_ ),
       nat_rule_( ingress_addr() ),
       pipe_( UnixDomainSocket::make_pair() ),
+      ferry_threads_( get_ferry_threads() ),
       event_loop_()
 {
     /* make sure environment has been cleared */
@@ -39,6 +42,9 @@ PacketShell<FerryQueueType>::PacketShell( const std::string & device_prefix, cha
 
     /* initialize base timestamp value before any forking */
     initial_timestamp();
+
+    /* likewise the scheduling resolution, which the user may choose */
+    set_timebase( get_timebase() );
 }
 
 template <class FerryQueueType>
@@ -77,7 +83,7 @@ void PacketShell<FerryQueueType>::start_uplink( const string & shell_prefix,
 
             SystemCall( "ioctl SIOCADDRT", ioctl( UDPSocket().fd_num(), SIOCADDRT, &route ) );
 
-            Ferry inner_ferry;
+            Ferry<FerryQueueType> inner_ferry( device_prefix_ + " uplink", ferry_threads_ );
 
             /* dnsmasq doesn't distinguish between UDP and TCP forwarding nameservers,
                so use a DNSProxy that listens on the same UDP and TCP port */
@@ -149,7 +155,7 @@ void PacketShell<FerryQueueType>::start_downlink( Targs&&... Fargs )
             /* downlink packets go to inner namespace's TUN device */
             FileDescriptor ingress_tun = pipe_.second.recv_fd();
 
-            Ferry outer_ferry;
+            Ferry<FerryQueueType> outer_ferry( device_prefix_ + " downlink", ferry_threads_ );
 
             dns_outside_.register_handlers( outer_ferry );
 
@@ -164,36 +170,6 @@ int PacketShell<FerryQueueType>::wait_for_exit( void )
     return event_loop_.loop();
 }
 
-template <class FerryQueueType>
-int PacketShell<FerryQueueType>::Ferry::loop( FerryQueueType & ferry_queue,
-                                              FileDescriptor & tun,
-                                              FileDescriptor & sibling )
-{
-    /* tun device gets datagram -> read it -> give to ferry */
-    add_simple_input_handler( tun, 
-                              [&] () {
-                                  ferry_queue.read_packet( tun.read() );
-                                  return ResultType::Continue;
-                              } );
-
-    /* ferry ready to write datagram -> send to sibling's tun device */
-    add_action( Poller::Action( sibling, Direction::Out,
-                                [&] () {
-                                    ferry_queue.write_packets( sibling );
-                                    return ResultType::Continue;
-                                },
-                                [&] () { return ferry_queue.pending_output(); } ) );
-
-    /* exit if finished */
-    add_action( Poller::Action( sibling, Direction::Out,
-                                [&] () {
-                                    return Result( ResultType::Exit, 77 );
-                                },
-                                [&] () { return ferry_queue.finished(); } ) );
-
-    return internal_loop( [&] () { return ferry_queue.wait_time(); } );
-}
-
 struct TemporaryEnvironment
 {
     TemporaryEnvironment( char ** const env )
@@ -210,6 +186,36 @@ struct TemporaryEnvironment
     }
 };
 
+template <class FerryQueueType>
+Timebase PacketShell<FerryQueueType>::get_timebase( void ) const
+{
+    TemporarilyUnprivileged tu;
+    TemporaryEnvironment te { user_environment_ };
+
+    const char * const timebase_name = getenv( "MAHIMAHI_TIMEBASE" );
+    if ( not timebase_name ) {
+        return timebase();
+    }
+
+    return parse_timebase( timebase_name );
+}
+
+template <class FerryQueueType>
+unsigned int PacketShell<FerryQueueType>::get_ferry_threads( void ) const
+{
+    TemporarilyUnprivileged tu;
+    TemporaryEnvironment te { user_environment_ };
+
+    const char * const threads = getenv( "MAHIMAHI_FERRY_THREADS" );
+    if ( not threads or threads == string( "1" ) ) {
+        return 1;
+    } else if ( threads == string( "3" ) ) {
+        return 3;
+    }
+
+    throw runtime_error( "MAHIMAHI_FERRY_THREADS must be 1 or 3, not \"" + string( threads ) + "\"" );
+}
+
 template <class FerryQueueType>
 Address PacketShell<FerryQueueType>::get_mahimahi_base( void ) const
 {
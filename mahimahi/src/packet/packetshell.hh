@@ -12,12 +12,14 @@
 #include "dns_proxy.hh"
 #include "event_loop.hh"
 #include "socketpair.hh"
+#include "timestamp.hh"
 
 template <class FerryQueueType>
 class PacketShell
 {
 private:
     char ** const user_environment_;
+    const std::string device_prefix_;
     std::pair<Address, Address> egress_ingress;
     Address nameserver_;
     TunDevice egress_tun_;
@@ -26,18 +28,17 @@ private:
 
     std::pair<UnixDomainSocket, UnixDomainSocket> pipe_;
 
+    /* threads per ferry: 1, or 3 to read and write the TUN devices on threads of their own */
+    const unsigned int ferry_threads_;
+
     EventLoop event_loop_;
 
     const Address & egress_addr( void ) { return egress_ingress.first; }
     const Address & ingress_addr( void ) { return egress_ingress.second; }
 
-    class Ferry : public EventLoop
-    {
-    public:
-        int loop( FerryQueueType & ferry_queue, FileDescriptor & tun, FileDescriptor & sibling );
-    };
-
     Address get_mahimahi_base( void ) const;
+    Timebase get_timebase( void ) const;
+    unsigned int get_ferry_threads( void ) const;
 
 public:
     PacketShell( const std::string & device_prefix, char ** const user_environment );
@@ -0,0 +1,296 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* runs ferry queues through the real Ferry::loop (its Poller, timerfd
+   and, with 3 threads, FerryThreads), with packet pipes standing in for
+   the TUN devices, and checks that every packet the queue should pass
+   comes out, in order where the queue keeps it, and that the loop keeps
+   running until it is told to stop. No root or TUN device is needed
+   (and as root the loop refuses to run, so the test is skipped). */
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <exception>
+#include <memory>
+#include <sstream>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "ferry.hh"
+#include "delay_queue.hh"
+#include "chain_queue.hh"
+#include "link_queue.hh"
+#include "link_trace.hh"
+#include "packet_buffer.hh"
+#include "infinite_packet_queue.hh"
+#include "variable_delay_queue.hh"
+#include "temp_file.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static const unsigned int PACKETS = 200;
+static const size_t PACKET_SIZE = 100;
+
+/* a pipe in "packet mode" keeps datagram boundaries, like a TUN device */
+static pair<FileDescriptor, FileDescriptor> packet_pipe( void )
+{
+    int fds[ 2 ];
+    SystemCall( "pipe2", pipe2( fds, O_DIRECT ) );
+
+    /* room for every packet (each occupies one page), so the test never
+       blocks writing to a ferry that has stopped */
+    SystemCall( "fcntl F_SETPIPE_SZ", fcntl( fds[ 1 ], F_SETPIPE_SZ, 1024 * 1024 ) );
+
+    return make_pair( FileDescriptor( fds[ 0 ] ), FileDescriptor( fds[ 1 ] ) );
+}
+
+/* a packet out of the far pipe: its number, and when (ms after the test started) */
+struct Received
+{
+    uint32_t number;
+    double ms;
+};
+
+/* the packets that come out of the far pipe within the timeout */
+static vector<Received> collect( FileDescriptor & out, const unsigned int expected, const int timeout_ms,
+                                 const chrono::steady_clock::time_point & start )
+{
+    vector<Received> ret;
+    const auto give_up = chrono::steady_clock::now() + chrono::milliseconds( timeout_ms );
+
+    while ( ret.size() < expected or expected == 0 ) {
+        const auto left = chrono::duration_cast<chrono::milliseconds>( give_up - chrono::steady_clock::now() );
+        if ( left.count() <= 0 ) {
+            break;
+        }
+
+        pollfd readable { out.fd_num(), POLLIN, 0 };
+        if ( 0 == SystemCall( "poll", poll( &readable, 1, left.count() ) ) ) {
+            break;
+        }
+
+        const string packet = out.read();
+        uint32_t number;
+        memcpy( &number, packet.data(), sizeof( number ) );
+        ret.push_back( { number, chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count() } );
+    }
+
+    return ret;
+}
+
+/* PACKETS numbered packets, about 100 us apart, through a queue made
+   (on the ferry's thread, as the shells make theirs) by make_queue; if
+   latest_ms is given, each must come out between earliest_ms and
+   latest_ms after the test starts (which is before the queue is made) */
+template <class QueueType, class MakeQueue>
+static void check( const string & name, const unsigned int threads,
+                   const MakeQueue & make_queue,
+                   const unsigned int expected, const bool in_order,
+                   const unsigned int earliest_ms = 0, const unsigned int latest_ms = 0 )
+{
+    auto in = packet_pipe(), out = packet_pipe();
+    exception_ptr failure;
+    const auto start = chrono::steady_clock::now();
+
+    thread ferry_thread( [&] () {
+            try {
+                Ferry<QueueType> ferry( name, threads );
+                QueueType queue = make_queue();
+                ferry.loop( queue, in.first, out.second );
+            } catch ( ... ) {
+                failure = current_exception();
+            }
+        } );
+
+    string packet( PACKET_SIZE, 'x' );
+    for ( uint32_t i = 0; i < PACKETS; i++ ) {
+        memcpy( &packet[ 0 ], &i, sizeof( i ) );
+        in.second.write( packet );
+        this_thread::sleep_for( chrono::microseconds( 100 ) );
+    }
+
+    /* nothing is expected: make sure nothing comes */
+    const vector<Received> received = collect( out.first, expected, expected ? 5000 : 200, start );
+
+    /* the ferry blocks SIGTERM and reads it from a signalfd, and then exits */
+    pthread_kill( ferry_thread.native_handle(), SIGTERM );
+    ferry_thread.join();
+
+    if ( failure ) {
+        rethrow_exception( failure );
+    }
+
+    if ( received.size() != expected ) {
+        throw runtime_error( name + ": " + to_string( received.size() ) + " packets came out, not "
+                             + to_string( expected ) );
+    }
+
+    for ( size_t i = 0; in_order and i < received.size(); i++ ) {
+        if ( received[ i ].number != i ) {
+            throw runtime_error( name + ": packets came out of order" );
+        }
+    }
+
+    for ( const auto & packet : received ) {
+        if ( latest_ms and not ( earliest_ms <= packet.ms and packet.ms <= latest_ms ) ) {
+            throw runtime_error( name + ": packet " + to_string( packet.number ) + " came out after "
+                                 + to_string( packet.ms ) + " ms, not between " + to_string( earliest_ms )
+                                 + " and " + to_string( latest_ms ) );
+        }
+    }
+
+    cout << "ferry-test: " << name << " OK" << endl;
+}
+
+int main( void )
+{
+    try {
+        if ( geteuid() == 0 ) {
+            cerr << "ferry-test: skipped (the ferry will not run as root)" << endl;
+            return 77; /* automake's "skipped" */
+        }
+
+        /* a delay that drops from 6 ms to 1 ms and back, every 10 ms, so
+           that reordering shows */
+        TempFile trace( "/tmp/ferry-test-trace" );
+        string lines = "# time delay\n";
+        for ( unsigned int time = 0; time < 1000; time += 10 ) {
+            lines += to_string( time ) + " " + ( time % 20 ? "1" : "6" ) + "\n";
+        }
+        trace.write( lines );
+        const string trace_name = trace.name();
+
+        /* a bad line, however late, stops the queue being made */
+        TempFile bad_trace( "/tmp/ferry-test-bad-trace" );
+        bad_trace.write( lines + "1000 1 1\n" );
+        try {
+            TraceDelayQueue( bad_trace.name(), false );
+            throw runtime_error( "ferry-test: a delay trace with a bad last line was accepted" );
+        } catch ( const runtime_error & e ) {
+            if ( string( e.what() ).find( ":102: " ) == string::npos ) {
+                throw;
+            }
+        }
+
+        /* a packet too big for a slab stops the ferry, rather than going
+           on cut short */
+        auto oversized = packet_pipe();
+        oversized.second.write( string( PacketBuffer::CAPACITY, 'x' ) );
+        oversized.second.write( string( PacketBuffer::CAPACITY + 1, 'x' ) );
+        PacketBuffer slab;
+        if ( not oversized.first.read_into( slab ) or slab.size() != PacketBuffer::CAPACITY ) {
+            throw runtime_error( "ferry-test: a packet that fills a slab was not read whole" );
+        }
+        try {
+            oversized.first.read_into( slab );
+            throw runtime_error( "ferry-test: a packet bigger than a slab was read" );
+        } catch ( const runtime_error & e ) {
+            if ( string( e.what() ) != "packet size is greater than maximum" ) {
+                throw;
+            }
+        }
+
+        /* a link that delivers only every 200 ms, but then room enough for
+           every packet (20 opportunities of 1504 bytes) */
+        TempFile link_trace( "/tmp/ferry-test-link-trace" );
+        string opportunities;
+        for ( unsigned int i = 0; i < 20; i++ ) {
+            opportunities += "200\n";
+        }
+        link_trace.write( opportunities );
+        const string link_trace_name = link_trace.name();
+
+        /* a binary trace whose stated duration its opportunities don't add
+           up to, or with anything after them, is refused when it is opened */
+        ostringstream binary;
+        BinaryLinkTrace::convert( *LinkTrace::open( link_trace_name ), binary );
+        for ( const int change : { -1, 1, 0 } ) {
+            string bad_binary = binary.str();
+            bad_binary[ 16 ] += change; /* the low byte of the duration */
+            if ( change == 0 ) {
+                bad_binary += '\x01';
+            }
+
+            TempFile bad_binary_trace( "/tmp/ferry-test-bad-binary-trace" );
+            bad_binary_trace.write( bad_binary );
+            try {
+                LinkTrace::open( bad_binary_trace.name() );
+                throw runtime_error( "ferry-test: a bad binary link trace was accepted" );
+            } catch ( const runtime_error & e ) {
+                if ( string( e.what() ).find( bad_binary_trace.name() + ": " ) != 0 ) {
+                    throw;
+                }
+            }
+        }
+
+        for ( const unsigned int threads : { 1, 3 } ) {
+            const string suffix = ", " + to_string( threads ) + " thread" + ( threads > 1 ? "s" : "" );
+
+            check<DelayQueue>( "delay 1 ms" + suffix, threads,
+                               [] () { return DelayQueue( 1000 ); }, PACKETS, true );
+
+            /* only the last stage writes out: an inner stage's release must not
+               look like pending output */
+            check<ChainQueue>( "chain \"delay 1 | delay 1\"" + suffix, threads,
+                               [] () { return ChainQueue( ChainQueue::parse( "delay 1 | delay 1" ),
+                                                          ChainQueue::Direction::Downlink, "" ); },
+                               PACKETS, true );
+
+            check<ChainQueue>( "chain \"delay 1 | loss downlink 1\"" + suffix, threads,
+                               [] () { return ChainQueue( ChainQueue::parse( "delay 1 | loss downlink 1" ),
+                                                          ChainQueue::Direction::Downlink, "" ); },
+                               0, true );
+
+            /* a wheel item waits above level 0 until the wheel cascades: that
+               must not count as pending output */
+            check<JitterDelayQueue>( "delay 5 ms, no jitter, reordering" + suffix, threads,
+                                     [] () { return JitterDelayQueue( 5000, 0, JitterDelayQueue::Distribution::Uniform,
+                                                                      false ); },
+                                     PACKETS, true );
+
+            check<JitterDelayQueue>( "delay 5 ms, jitter 2 ms, reordering" + suffix, threads,
+                                     [] () { return JitterDelayQueue( 5000, 2000, JitterDelayQueue::Distribution::Uniform,
+                                                                      false ); },
+                                     PACKETS, false );
+
+            check<JitterDelayQueue>( "delay 5 ms, jitter 2 ms, in order" + suffix, threads,
+                                     [] () { return JitterDelayQueue( 5000, 2000, JitterDelayQueue::Distribution::Normal,
+                                                                      true ); },
+                                     PACKETS, true );
+
+            check<TraceDelayQueue>( "delay trace, reordering" + suffix, threads,
+                                    [&] () { return TraceDelayQueue( trace_name, false ); },
+                                    PACKETS, false );
+
+            check<TraceDelayQueue>( "delay trace, in order" + suffix, threads,
+                                    [&] () { return TraceDelayQueue( trace_name, true ); },
+                                    PACKETS, true );
+
+            /* what the opportunity that wakes the ferry delivers must leave
+               then, not at the next one (at 400 ms) */
+            check<LinkQueue>( "link every 200 ms" + suffix, threads,
+                              [&] () { return LinkQueue( "Downlink", link_trace_name, "", false, true, false, false,
+                                                         unique_ptr<AbstractPacketQueue>( new InfinitePacketQueue( "" ) ),
+                                                         "" ); },
+                              PACKETS, true, 200, 300 );
+
+            check<ChainQueue>( "chain \"delay 1 | link\" every 200 ms" + suffix, threads,
+                               [&] () { return ChainQueue( ChainQueue::parse( "delay 1 | link " + link_trace_name
+                                                                              + " " + link_trace_name ),
+                                                           ChainQueue::Direction::Downlink, "" ); },
+                               PACKETS, true, 200, 300 );
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
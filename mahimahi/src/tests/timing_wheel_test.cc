@@ -0,0 +1,128 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* checks TimingWheel against a binary heap (std::priority_queue), with
+   deadlines at every level of the wheel and past its reach (more than
+   2^32 us ahead), some already passed or repeated, and time advancing
+   in steps from 1 us to hours, across 2^32 us. At each step the wheel
+   must release exactly the items the heap says are due, earliest
+   first, and after a cascade, due() and next_deadline() must agree
+   with it. */
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "timing_wheel.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static const unsigned int STEPS = 20000;
+static const unsigned int MAX_INSERTS_PER_STEP = 20;
+
+typedef pair<uint64_t, uint32_t> Entry; /* deadline, id */
+
+static void check( const bool condition, const string & problem )
+{
+    if ( not condition ) {
+        throw runtime_error( "timing-wheel-test: " + problem );
+    }
+}
+
+/* a time span up to 2^max_bits us, with every power of two as likely */
+static uint64_t span( default_random_engine & prng, const unsigned int max_bits )
+{
+    const unsigned int bits = uniform_int_distribution<unsigned int>( 0, max_bits )( prng );
+    return uniform_int_distribution<uint64_t>( 0, ( uint64_t( 1 ) << bits ) - 1 )( prng );
+}
+
+int main( void )
+{
+    try {
+        default_random_engine prng( 1 );
+
+        /* start just short of 2^32 us, so that time crosses it */
+        const uint64_t start = ( uint64_t( 1 ) << 32 ) - 12345;
+        TimingWheel<uint32_t> wheel( start );
+        priority_queue<Entry, vector<Entry>, greater<Entry>> heap;
+
+        uint64_t now = start, earliest_allowed = start; /* an earlier deadline is released as if it were this */
+        uint64_t last_deadline = start;
+        uint32_t next_id = 0;
+        uint64_t released_total = 0;
+
+        for ( unsigned int step = 0; step < STEPS; step++ ) {
+            const unsigned int inserts = uniform_int_distribution<unsigned int>( 0, MAX_INSERTS_PER_STEP )( prng );
+            for ( unsigned int i = 0; i < inserts; i++ ) {
+                uint64_t deadline;
+                switch ( uniform_int_distribution<unsigned int>( 0, 9 )( prng ) ) {
+                case 0: /* already passed */
+                    deadline = earliest_allowed - min( earliest_allowed, span( prng, 20 ) );
+                    break;
+                case 1: /* the same as another */
+                    deadline = max( last_deadline, earliest_allowed );
+                    break;
+                default: /* anywhere up to 2^36 us (19 hours) ahead */
+                    deadline = earliest_allowed + span( prng, 36 );
+                }
+                last_deadline = deadline;
+
+                const uint32_t id = next_id++;
+                wheel.insert( deadline, uint32_t( id ) );
+                heap.emplace( max( deadline, earliest_allowed ), id );
+            }
+
+            now += span( prng, 34 );
+
+            /* a cascade brings everything due down to level 0 */
+            if ( step % 2 ) {
+                wheel.cascade( now );
+                const bool heap_due = not heap.empty() and heap.top().first <= now;
+                check( wheel.due( now ) == heap_due, "due() disagrees with the heap after a cascade" );
+                if ( wheel.next_deadline() <= now ) {
+                    check( wheel.due( now ), "next_deadline() has passed, but nothing is due" );
+                }
+            }
+
+            /* the hint is never later than the next deadline */
+            check( heap.empty() or wheel.next_deadline() <= heap.top().first,
+                   "next_deadline() is after the earliest item" );
+
+            vector<Entry> released, expected;
+            wheel.advance( now, [&] ( const uint64_t deadline, uint32_t && id ) {
+                    check( deadline <= now, "item released before its deadline" );
+                    check( released.empty() or released.back().first <= deadline,
+                           "items released out of deadline order" );
+                    released.emplace_back( deadline, id );
+                } );
+
+            while ( not heap.empty() and heap.top().first <= now ) {
+                expected.push_back( heap.top() );
+                heap.pop();
+            }
+
+            /* items with the same deadline come out in any order */
+            sort( released.begin(), released.end() );
+            check( released == expected, "released " + to_string( released.size() ) + " items at "
+                   + to_string( now ) + ", not the " + to_string( expected.size() ) + " due" );
+            check( wheel.size() == heap.size(), "size() disagrees with the heap" );
+
+            released_total += released.size();
+            earliest_allowed = now + 1;
+        }
+
+        check( released_total > STEPS, "too few items released to mean anything" );
+
+        cout << "timing-wheel-test: " << next_id << " items, " << released_total
+             << " released over " << STEPS << " steps OK" << endl;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
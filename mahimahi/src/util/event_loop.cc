@@ -4,14 +4,17 @@
 
 #include "event_loop.hh"
 #include "exception.hh"
+#include "timerfd.hh"
+#include "timestamp.hh"
 
 using namespace std;
 using namespace PollerShortNames;
 
-EventLoop::EventLoop()
+EventLoop::EventLoop( const Poller::Backend backend )
     : signals_( { SIGCHLD, SIGCONT, SIGHUP, SIGTERM, SIGQUIT, SIGINT } ),
-      poller_(),
-      child_processes_()
+      poller_( backend ),
+      child_processes_(),
+      lateness_()
 {
     signals_.set_as_mask(); /* block signals so we can later use signalfd to read them */
 }
@@ -80,7 +83,7 @@ Result EventLoop::handle_signal( const signalfd_siginfo & sig )
     return ResultType::Continue;
 }
 
-int EventLoop::internal_loop( const std::function<int(void)> & wait_time )
+int EventLoop::internal_loop( const std::function<int64_t(void)> & wait_time_us )
 {
     TemporarilyUnprivileged tu;
 
@@ -98,9 +101,51 @@ int EventLoop::internal_loop( const std::function<int(void)> & wait_time )
                               [&] () { return handle_signal( signal_fd.read_signal() ); } );
 
     while ( true ) {
-        const auto poll_result = poller_.poll( wait_time() );
+        const auto poll_result = poller_.poll_us( wait_time_us() );
         if ( poll_result.result == Poller::Result::Type::Exit ) {
             return poll_result.exit_status;
         }
     }
 }
+
+int EventLoop::internal_loop_until( const std::function<uint64_t(void)> & next_deadline_us )
+{
+    TimerFD timer;
+    uint64_t armed_deadline = NO_DEADLINE;
+
+    add_simple_input_handler( timer.fd(),
+                              [&] () {
+                                  timer.read_expirations();
+                                  /* unrounded clock, so the "ms" timebase shows its lateness too */
+                                  const uint64_t now = timestamp_ns() / 1000;
+                                  lateness_.add( now > armed_deadline ? now - armed_deadline : 0 );
+                                  armed_deadline = NO_DEADLINE;
+                                  return ResultType::Continue;
+                              } );
+
+    return internal_loop( [&] () -> int64_t {
+            uint64_t deadline = next_deadline_us();
+
+            /* the clock only ticks in whole ms on that timebase, so waking earlier is useless */
+            if ( timebase() == Timebase::Milliseconds and deadline != NO_DEADLINE and deadline % 1000 ) {
+                deadline += 1000 - deadline % 1000;
+            }
+
+            /* already due: don't wait at all */
+            if ( deadline <= timestamp_us() ) {
+                return 0;
+            }
+
+            /* only touch the timer when the deadline moves */
+            if ( deadline != armed_deadline ) {
+                if ( deadline == NO_DEADLINE ) {
+                    timer.disarm();
+                } else {
+                    timer.arm_at( deadline );
+                }
+                armed_deadline = deadline;
+            }
+
+            return -1;
+        } );
+}
@@ -11,6 +11,7 @@
 #include "signalfd.hh"
 #include "child_process.hh"
 #include "util.hh"
+#include "latency_histogram.hh"
 
 class EventLoop
 {
@@ -18,15 +19,27 @@ private:
     SignalMask signals_;
     Poller poller_;
     std::vector<std::pair<int, ChildProcess>> child_processes_;
+    LatencyHistogram lateness_;
     PollerShortNames::Result handle_signal( const signalfd_siginfo & sig );
 
 protected:
     void add_action( Poller::Action action ) { poller_.add_action( action ); }
 
-    int internal_loop( const std::function<int(void)> & wait_time );
+    /* wait_time_us() gives the poll timeout in microseconds (negative for none) */
+    int internal_loop( const std::function<int64_t(void)> & wait_time_us );
+
+    /* next_deadline_us() gives an absolute timestamp_us() at which to wake
+       (or NO_DEADLINE); a timerfd wakes us then, and how late each such
+       wakeup ran is recorded in lateness() */
+    const static uint64_t NO_DEADLINE = uint64_t( -1 );
+    int internal_loop_until( const std::function<uint64_t(void)> & next_deadline_us );
+
+    const LatencyHistogram & lateness( void ) const { return lateness_; }
+
+    uint64_t poll_calls( void ) const { return poller_.poll_calls(); }
 
 public:
-    EventLoop();
+    EventLoop( const Poller::Backend backend = Poller::Backend::Poll );
 
     void add_simple_input_handler( FileDescriptor & fd, const Poller::Action::CallbackType & callback );
 
@@ -0,0 +1,39 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "eventfd.hh"
+#include "exception.hh"
+
+using namespace std;
+
+EventFD::EventFD()
+    : fd_( SystemCall( "eventfd", eventfd( 0, EFD_CLOEXEC ) ) )
+{
+}
+
+/* from another thread, so this leaves fd_'s read and write counts alone */
+void EventFD::signal( void )
+{
+    const uint64_t one = 1;
+    SystemCall( "write", ::write( fd_.fd_num(), &one, sizeof( one ) ) );
+}
+
+/* read (and reset) the count */
+uint64_t EventFD::read_count( void )
+{
+    uint64_t count;
+
+    const string count_str = fd_.read( sizeof( count ) );
+
+    if ( count_str.size() != sizeof( count ) ) {
+        throw runtime_error( "eventfd read size mismatch" );
+    }
+
+    memcpy( &count, count_str.data(), sizeof( count ) );
+
+    return count;
+}
@@ -0,0 +1,28 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef EVENTFD_HH
+#define EVENTFD_HH
+
+#include <cstdint>
+
+#include "file_descriptor.hh"
+
+/* wrapper class for an event file descriptor, which one thread
+   signals to wake another that is polling or reading it */
+
+class EventFD
+{
+private:
+    FileDescriptor fd_;
+
+public:
+    EventFD();
+
+    FileDescriptor & fd( void ) { return fd_; }
+
+    void signal( void );
+
+    uint64_t read_count( void ); /* signals since last read (blocks if none) */
+};
+
+#endif /* EVENTFD_HH */
@@ -5,6 +5,7 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 
 using namespace std;
 
@@ -82,6 +83,68 @@ string FileDescriptor::read( const size_t limit )
     return string( buffer, bytes_read );
 }
 
+/* read one packet into a pooled buffer */
+bool FileDescriptor::read_into( PacketBuffer & buffer )
+{
+    if ( not buffer.unique() ) {
+        buffer = PacketBuffer::allocate();
+    }
+
+    /* room for one byte more than a slab holds, so that a packet too
+       big for it is caught rather than silently cut short */
+    char overflow;
+    iovec parts[ 2 ] = { { buffer.mutable_data(), PacketBuffer::CAPACITY }, { &overflow, 1 } };
+
+    const ssize_t bytes_read = ::readv( fd_, parts, 2 );
+    if ( bytes_read < 0 and (errno == EAGAIN or errno == EWOULDBLOCK) ) {
+        buffer.resize( 0 );
+        return false;
+    }
+
+    SystemCall( "readv", bytes_read );
+    if ( bytes_read == 0 ) {
+        set_eof();
+    }
+
+    register_read();
+
+    if ( size_t( bytes_read ) > PacketBuffer::CAPACITY ) {
+        buffer.resize( 0 );
+        throw runtime_error( "packet size is greater than maximum" );
+    }
+
+    buffer.resize( bytes_read );
+    return true;
+}
+
+/* write one packet */
+void FileDescriptor::write( const PacketBuffer & buffer )
+{
+    if ( buffer.empty() ) {
+        throw runtime_error( "nothing to write" );
+    }
+
+    const ssize_t bytes_written = SystemCall( "write", ::write( fd_, buffer.data(), buffer.size() ) );
+    if ( size_t( bytes_written ) != buffer.size() ) {
+        throw runtime_error( "write: packet was not written in one piece" );
+    }
+
+    register_write();
+}
+
+/* set or clear O_NONBLOCK */
+void FileDescriptor::set_blocking( const bool block )
+{
+    int flags = SystemCall( "fcntl F_GETFL", fcntl( fd_, F_GETFL ) );
+    if ( block ) {
+        flags &= ~O_NONBLOCK;
+    } else {
+        flags |= O_NONBLOCK;
+    }
+
+    SystemCall( "fcntl F_SETFL", fcntl( fd_, F_SETFL, flags ) );
+}
+
 /* write method */
 string::const_iterator FileDescriptor::write( const std::string & buffer, const bool write_all )
 {
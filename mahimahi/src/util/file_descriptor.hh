@@ -5,6 +5,8 @@
 
 #include <string>
 
+#include "packet_buffer.hh"
+
 /* Unix file descriptors (sockets, files, etc.) */
 class FileDescriptor
 {
@@ -38,8 +40,20 @@ public:
     unsigned int read_count( void ) const { return read_count_; }
     unsigned int write_count( void ) const { return write_count_; }
 
+    /* set or clear O_NONBLOCK */
+    void set_blocking( const bool block );
+
     /* read and write methods */
     std::string read( const size_t limit = BUFFER_SIZE );
+
+    /* read one packet into a pooled buffer (reusing its slab if not shared);
+       returns false if a nonblocking fd had nothing to read, and throws if
+       the packet is bigger than a slab */
+    bool read_into( PacketBuffer & buffer );
+
+    /* write one packet in a single call */
+    void write( const PacketBuffer & buffer );
+
     std::string::const_iterator write( const std::string & buffer, const bool write_all = true );
     std::string::const_iterator write( const std::string::const_iterator & begin,
                                        const std::string::const_iterator & end );
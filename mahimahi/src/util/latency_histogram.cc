@@ -0,0 +1,70 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <sstream>
+
+#include "latency_histogram.hh"
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(),
+      samples_( 0 ),
+      max_( 0 )
+{}
+
+unsigned int LatencyHistogram::bucket( const uint64_t value_us )
+{
+    unsigned int ret = 0;
+    for ( uint64_t x = value_us; x and ret < BUCKETS - 1; x >>= 1 ) {
+        ret++;
+    }
+    return ret;
+}
+
+void LatencyHistogram::add( const uint64_t value_us )
+{
+    counts_.at( bucket( value_us ) )++;
+    samples_++;
+    if ( value_us > max_ ) {
+        max_ = value_us;
+    }
+}
+
+/* bucket i holds values below 2^i */
+static uint64_t bucket_limit( const unsigned int i )
+{
+    return uint64_t( 1 ) << i;
+}
+
+uint64_t LatencyHistogram::quantile( const double q ) const
+{
+    uint64_t seen = 0;
+    for ( unsigned int i = 0; i < BUCKETS; i++ ) {
+        seen += counts_[ i ];
+        if ( seen > 0 and seen >= q * samples_ ) {
+            return bucket_limit( i );
+        }
+    }
+
+    return 0;
+}
+
+string LatencyHistogram::str( void ) const
+{
+    ostringstream ret;
+
+    ret << "p50 <" << quantile( 0.5 ) << " us, p99 <" << quantile( 0.99 ) << " us, max "
+        << max_ << " us (n=" << samples_ << ") [";
+
+    bool first = true;
+    for ( unsigned int i = 0; i < BUCKETS; i++ ) {
+        if ( counts_[ i ] ) {
+            ret << (first ? "" : " ") << "<" << bucket_limit( i ) << ":" << counts_[ i ];
+            first = false;
+        }
+    }
+
+    ret << "]";
+
+    return ret.str();
+}
@@ -0,0 +1,38 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef LATENCY_HISTOGRAM_HH
+#define LATENCY_HISTOGRAM_HH
+
+#include <array>
+#include <string>
+#include <cstdint>
+
+/* counts of microsecond durations in power-of-two buckets:
+   bucket 0 holds 0 us, bucket i holds [2^(i-1), 2^i) us */
+
+class LatencyHistogram
+{
+private:
+    const static unsigned int BUCKETS = 32;
+
+    std::array<uint64_t, BUCKETS> counts_;
+    uint64_t samples_, max_;
+
+    static unsigned int bucket( const uint64_t value_us );
+
+public:
+    LatencyHistogram();
+
+    void add( const uint64_t value_us );
+
+    uint64_t samples( void ) const { return samples_; }
+    uint64_t max( void ) const { return max_; }
+
+    /* upper bound of the bucket holding the given quantile (0 to 1) */
+    uint64_t quantile( const double q ) const;
+
+    /* e.g. "p50 <4 us, p99 <64 us, max 80 us (n=1000) [<1:2 <2:30 ...]" */
+    std::string str( void ) const;
+};
+
+#endif /* LATENCY_HISTOGRAM_HH */
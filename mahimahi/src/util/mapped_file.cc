@@ -0,0 +1,44 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "mapped_file.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static size_t file_size( const FileDescriptor & fd )
+{
+    struct stat info;
+    SystemCall( "fstat", fstat( fd.fd_num(), &info ) );
+    return info.st_size;
+}
+
+MappedFile::MappedFile( const string & filename )
+    : fd_( SystemCall( "open " + filename, open( filename.c_str(), O_RDONLY | O_CLOEXEC ) ) ),
+      size_( file_size( fd_ ) ),
+      data_( nullptr )
+{
+    if ( size_ == 0 ) {
+        return; /* can't map an empty file */
+    }
+
+    void * const mapping = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fd_.fd_num(), 0 );
+    if ( mapping == MAP_FAILED ) {
+        throw unix_error( "mmap " + filename );
+    }
+
+    /* the readers of these files go front to back */
+    SystemCall( "madvise", madvise( mapping, size_, MADV_SEQUENTIAL ) );
+
+    data_ = static_cast<const char *>( mapping );
+}
+
+MappedFile::~MappedFile()
+{
+    if ( data_ ) {
+        munmap( const_cast<char *>( data_ ), size_ );
+    }
+}
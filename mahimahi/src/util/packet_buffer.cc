@@ -0,0 +1,139 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "packet_buffer.hh"
+
+using namespace std;
+
+PacketBufferPool & PacketBufferPool::global( void )
+{
+    static PacketBufferPool pool;
+    return pool;
+}
+
+/* a lock that is only taken once the pool is shared */
+static unique_lock<mutex> lock_if( mutex & m, const bool shared )
+{
+    return shared ? unique_lock<mutex>( m ) : unique_lock<mutex>( m, defer_lock );
+}
+
+PacketBuffer::Slab * PacketBufferPool::take( void )
+{
+    const auto lock = lock_if( mutex_, shared_ );
+
+    if ( not free_list_ ) {
+        /* grow the pool by one chunk */
+        chunks_.emplace_back( new PacketBuffer::Slab[ SLABS_PER_CHUNK ] );
+        for ( unsigned int i = 0; i < SLABS_PER_CHUNK; i++ ) {
+            push_free( &chunks_.back()[ i ] );
+        }
+    }
+
+    PacketBuffer::Slab * const ret = free_list_;
+    free_list_ = ret->next_free;
+
+    ret->refcount.store( 1, memory_order_relaxed );
+    ret->length = 0;
+    ret->next_free = nullptr;
+
+    return ret;
+}
+
+void PacketBufferPool::give_back( PacketBuffer::Slab * const slab )
+{
+    const auto lock = lock_if( mutex_, shared_ );
+    push_free( slab );
+}
+
+void PacketBufferPool::push_free( PacketBuffer::Slab * const slab )
+{
+    slab->refcount.store( 0, memory_order_relaxed );
+    slab->next_free = free_list_;
+    free_list_ = slab;
+}
+
+PacketBuffer PacketBuffer::allocate( void )
+{
+    PacketBuffer ret;
+    ret.slab_ = PacketBufferPool::global().take();
+    return ret;
+}
+
+PacketBuffer::PacketBuffer( const string & contents )
+    : PacketBuffer( allocate() )
+{
+    resize( contents.size() );
+    memcpy( mutable_data(), contents.data(), contents.size() );
+}
+
+PacketBuffer::PacketBuffer( const PacketBuffer & other )
+    : slab_( other.slab_ )
+{
+    if ( slab_ ) {
+        slab_->refcount.fetch_add( 1, memory_order_relaxed );
+    }
+}
+
+PacketBuffer::PacketBuffer( PacketBuffer && other )
+    : slab_( other.slab_ )
+{
+    other.slab_ = nullptr;
+}
+
+PacketBuffer & PacketBuffer::operator=( const PacketBuffer & other )
+{
+    Slab * const incoming = other.slab_; /* other may be *this */
+    if ( incoming ) {
+        incoming->refcount.fetch_add( 1, memory_order_relaxed );
+    }
+
+    release();
+    slab_ = incoming;
+
+    return *this;
+}
+
+PacketBuffer & PacketBuffer::operator=( PacketBuffer && other )
+{
+    if ( this != &other ) {
+        release();
+        slab_ = other.slab_;
+        other.slab_ = nullptr;
+    }
+
+    return *this;
+}
+
+void PacketBuffer::release( void )
+{
+    if ( slab_ ) {
+        /* the last handle out (in whichever thread) returns the slab, after
+           every other thread's use of it (hence acquire and release) */
+        const unsigned int previous = slab_->refcount.fetch_sub( 1, memory_order_acq_rel );
+        assert( previous > 0 );
+        if ( previous == 1 ) {
+            PacketBufferPool::global().give_back( slab_ );
+        }
+        slab_ = nullptr;
+    }
+}
+
+char * PacketBuffer::mutable_data( void )
+{
+    assert( unique() );
+    return slab_->data;
+}
+
+void PacketBuffer::resize( const size_t length )
+{
+    assert( unique() );
+
+    if ( length > CAPACITY ) {
+        throw runtime_error( "PacketBuffer: packet size is greater than maximum" );
+    }
+
+    slab_->length = length;
+}
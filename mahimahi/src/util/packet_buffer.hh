@@ -0,0 +1,101 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PACKET_BUFFER_HH
+#define PACKET_BUFFER_HH
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+/* Reference-counted handle to a fixed-size slab from a per-process pool.
+   Copying a PacketBuffer shares the slab, so a packet can travel from
+   the TUN read to the TUN write without its bytes being copied. The
+   refcount is atomic, so handles to one slab may live in different
+   threads (as in a threaded ferry); the pool takes a lock only once it
+   has been told it is shared. */
+class PacketBuffer
+{
+public:
+    /* default max TUN payload size (MTU plus packet-information header) */
+    const static size_t CAPACITY = 1504;
+
+    struct Slab
+    {
+        std::atomic<unsigned int> refcount;
+        size_t length;
+        Slab * next_free;
+        char data[ CAPACITY ];
+    };
+
+private:
+    Slab * slab_;
+
+    void release( void );
+
+public:
+    /* empty handle (no slab) */
+    PacketBuffer() : slab_( nullptr ) {}
+
+    /* take a fresh, zero-length slab from the pool */
+    static PacketBuffer allocate( void );
+
+    /* copy a string into a fresh slab */
+    explicit PacketBuffer( const std::string & contents );
+
+    /* sharing the slab is cheap; these never copy the contents */
+    PacketBuffer( const PacketBuffer & other );
+    PacketBuffer( PacketBuffer && other );
+    PacketBuffer & operator=( const PacketBuffer & other );
+    PacketBuffer & operator=( PacketBuffer && other );
+    ~PacketBuffer() { release(); }
+
+    /* accessors */
+    const char * data( void ) const { return slab_ ? slab_->data : nullptr; }
+    size_t size( void ) const { return slab_ ? slab_->length : 0; }
+    bool empty( void ) const { return size() == 0; }
+
+    /* is this the only handle to its slab? (only then may it be written) */
+    bool unique( void ) const { return slab_ and slab_->refcount.load( std::memory_order_acquire ) == 1; }
+
+    /* writable storage for a reader (requires a unique slab) */
+    char * mutable_data( void );
+    void resize( const size_t length );
+
+    /* copy of the contents, for logging and tests */
+    std::string str( void ) const { return std::string( data(), size() ); }
+};
+
+class PacketBufferPool
+{
+private:
+    /* slabs are allocated this many at a time and never returned to the heap */
+    const static unsigned int SLABS_PER_CHUNK = 256;
+
+    std::vector<std::unique_ptr<PacketBuffer::Slab[]>> chunks_;
+    PacketBuffer::Slab * free_list_;
+
+    std::mutex mutex_;
+    bool shared_; /* set before a second thread starts, and never cleared */
+
+    void push_free( PacketBuffer::Slab * const slab );
+
+public:
+    PacketBufferPool() : chunks_(), free_list_( nullptr ), mutex_(), shared_( false ) {}
+
+    PacketBuffer::Slab * take( void );
+    void give_back( PacketBuffer::Slab * const slab );
+
+    /* from now on, slabs may be taken and given back from several threads */
+    void share_between_threads( void ) { shared_ = true; }
+
+    /* the pool shared by every PacketBuffer in this process */
+    static PacketBufferPool & global( void );
+
+    /* forbid copying */
+    PacketBufferPool( const PacketBufferPool & other ) = delete;
+    PacketBufferPool & operator=( const PacketBufferPool & other ) = delete;
+};
+
+#endif /* PACKET_BUFFER_HH */
@@ -1,16 +1,46 @@
 /* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 #include <algorithm>
+#include <numeric>
+#include <cerrno>
+
 #include "poller.hh"
 #include "exception.hh"
 
 using namespace std;
 using namespace PollerShortNames;
 
+Poller::Poller( const Backend s_backend )
+    : backend_( s_backend ),
+      actions_(),
+      pollfds_(),
+      epoll_fd_(),
+      registrations_(),
+      conditional_fds_(),
+      dirty_fds_(),
+      action_events_(),
+      interested_actions_( 0 ),
+      ready_events_(),
+      poll_calls_( 0 )
+{}
+
 void Poller::add_action( Poller::Action action )
 {
+    const int fd_num = action.fd.fd_num();
+
     actions_.push_back( action );
-    pollfds_.push_back( { action.fd.fd_num(), 0, 0 } );
+    pollfds_.push_back( { fd_num, 0, 0 } );
+    action_events_.push_back( 0 );
+
+    Registration & registration = registrations_[ fd_num ];
+    registration.actions.push_back( actions_.size() - 1 );
+
+    if ( action.conditional and not registration.conditional ) {
+        registration.conditional = true;
+        conditional_fds_.push_back( fd_num );
+    }
+
+    mark_dirty( registration, fd_num );
 }
 
 unsigned int Poller::Action::service_count( void ) const
@@ -18,21 +48,75 @@ unsigned int Poller::Action::service_count( void ) const
     return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
+bool Poller::Action::interested( void ) const
+{
+    /* don't poll in on fds that have had EOF */
+    if ( direction == Direction::In and fd.eof() ) {
+        return false;
+    }
+
+    return active and when_interested();
+}
+
 Poller::Result Poller::poll( const int & timeout_ms )
+{
+    return poll_us( timeout_ms < 0 ? -1 : int64_t( timeout_ms ) * 1000 );
+}
+
+Poller::Result Poller::poll_us( const int64_t & timeout_us )
+{
+    return backend_ == Backend::Epoll ? poll_with_epoll( timeout_us ) : poll_with_poll( timeout_us );
+}
+
+static timespec to_timespec( const int64_t & timeout_us )
+{
+    timespec ts;
+    ts.tv_sec = timeout_us / 1000000;
+    ts.tv_nsec = (timeout_us % 1000000) * 1000;
+    return ts;
+}
+
+/* a signal handler interrupted the wait. glibc runs one on every thread
+   when any thread changes the process's credentials (as
+   TemporarilyUnprivileged does), and ppoll(2) and epoll_wait(2) are
+   never restarted: the caller just polls again */
+static bool interrupted( const int ret )
+{
+    return ret < 0 and errno == EINTR;
+}
+
+Poller::Result Poller::run_callback( const size_t action_index )
+{
+    Action & action = actions_.at( action_index );
+
+    const auto count_before = action.service_count();
+    auto result = action.callback();
+
+    switch ( result.result ) {
+    case ResultType::Exit:
+        return Result( Result::Type::Exit, result.exit_status );
+    case ResultType::Cancel:
+        action.active = false;
+        break;
+    case ResultType::Continue:
+        break;
+    }
+
+    if ( count_before == action.service_count() ) {
+        throw runtime_error( "Poller: busy wait detected: callback did not read/write fd" );
+    }
+
+    return Result::Type::Success;
+}
+
+Poller::Result Poller::poll_with_poll( const int64_t & timeout_us )
 {
     assert( pollfds_.size() == actions_.size() );
 
     /* tell poll whether we care about each fd */
     for ( unsigned int i = 0; i < actions_.size(); i++ ) {
         assert( pollfds_.at( i ).fd == actions_.at( i ).fd.fd_num() );
-        pollfds_.at( i ).events = (actions_.at( i ).active and actions_.at( i ).when_interested())
-            ? actions_.at( i ).direction : 0;
-
-        /* don't poll in on fds that have had EOF */
-        if ( actions_.at( i ).direction == Direction::In
-             and actions_.at( i ).fd.eof() ) {
-            pollfds_.at( i ).events = 0;
-        }
+        pollfds_.at( i ).events = actions_.at( i ).interested() ? actions_.at( i ).direction : 0;
     }
 
     /* Quit if no member in pollfds_ has a non-zero direction */
@@ -41,7 +125,15 @@ Poller::Result Poller::poll( const int & timeout_ms )
         return Result::Type::Exit;
     }
 
-    if ( 0 == SystemCall( "poll", ::poll( &pollfds_[ 0 ], pollfds_.size(), timeout_ms ) ) ) {
+    const timespec timeout = to_timespec( timeout_us );
+
+    poll_calls_++;
+    const int ready_count = ::ppoll( &pollfds_[ 0 ], pollfds_.size(),
+                                     timeout_us < 0 ? nullptr : &timeout, nullptr );
+    if ( interrupted( ready_count ) ) {
+        return Result::Type::Success;
+    }
+    if ( 0 == SystemCall( "ppoll", ready_count ) ) {
         return Result::Type::Timeout;
     }
 
@@ -54,23 +146,172 @@ Poller::Result Poller::poll( const int & timeout_ms )
         if ( pollfds_[ i ].revents & pollfds_[ i ].events ) {
             /* we only want to call callback if revents includes
                the event we asked for */
-            const auto count_before = actions_.at( i ).service_count();
-            auto result = actions_.at( i ).callback();
-
-            switch ( result.result ) {
-            case ResultType::Exit:
-                return Result( Result::Type::Exit, result.exit_status );
-            case ResultType::Cancel:
-                actions_.at( i ).active = false;
-                break;
-            case ResultType::Continue:
-                break;
+            const auto result = run_callback( i );
+            if ( result.result == Result::Type::Exit ) {
+                return result;
             }
+        }
+    }
+
+    return Result::Type::Success;
+}
+
+/* the epoll(7) flags for a poll(2) direction */
+static uint32_t epoll_events( const short direction )
+{
+    switch ( direction ) {
+    case Direction::In: return EPOLLIN;
+    case Direction::Out: return EPOLLOUT;
+    default: return 0;
+    }
+}
+
+void Poller::mark_dirty( Registration & registration, const int fd_num )
+{
+    if ( not registration.dirty ) {
+        registration.dirty = true;
+        dirty_fds_.push_back( fd_num );
+    }
+}
 
-            if ( count_before == actions_.at( i ).service_count() ) {
-                throw runtime_error( "Poller: busy wait detected: callback did not read/write fd" );
+/* recompute what we want from one fd, and tell the kernel only if that changed */
+void Poller::update_registration( const int fd_num, Registration & registration )
+{
+    uint32_t events = 0;
+
+    for ( const auto & i : registration.actions ) {
+        const short wanted = actions_[ i ].interested() ? actions_[ i ].direction : 0;
+
+        if ( wanted and not action_events_[ i ] ) {
+            interested_actions_++;
+        } else if ( action_events_[ i ] and not wanted ) {
+            interested_actions_--;
+        }
+        action_events_[ i ] = wanted;
+
+        events |= epoll_events( wanted );
+    }
+
+    epoll_event event;
+    event.events = events;
+    event.data.fd = fd_num;
+
+    if ( not registration.added ) {
+        if ( epoll_ctl( epoll_fd_->fd_num(), EPOLL_CTL_ADD, fd_num, &event ) < 0 ) {
+            if ( errno == EPERM ) {
+                /* e.g. a regular file: epoll can't watch it, but poll can */
+                backend_ = Backend::Poll;
+                return;
+            }
+            throw unix_error( "epoll_ctl" );
+        }
+        registration.added = true;
+    } else if ( events != registration.registered_events ) {
+        if ( epoll_ctl( epoll_fd_->fd_num(), EPOLL_CTL_MOD, fd_num, &event ) < 0 ) {
+            /* the fd was closed and its number reused since we added it */
+            if ( errno != ENOENT ) {
+                throw unix_error( "epoll_ctl" );
+            }
+            SystemCall( "epoll_ctl", epoll_ctl( epoll_fd_->fd_num(), EPOLL_CTL_ADD, fd_num, &event ) );
+        }
+    }
+
+    registration.registered_events = events;
+}
+
+/* epoll_wait(2) only takes whole milliseconds, so a finer timeout waits
+   on the epoll fd itself with ppoll(2) and then collects what's ready
+   (-1 if the wait was interrupted) */
+int Poller::epoll_wait_us( const int64_t & timeout_us )
+{
+    if ( timeout_us > 0 and timeout_us % 1000 ) {
+        pollfd epoll_pollfd { epoll_fd_->fd_num(), POLLIN, 0 };
+        const timespec timeout = to_timespec( timeout_us );
+
+        const int ready = ::ppoll( &epoll_pollfd, 1, &timeout, nullptr );
+        if ( interrupted( ready ) ) {
+            return -1;
+        }
+        if ( 0 == SystemCall( "ppoll", ready ) ) {
+            return 0;
+        }
+
+        return SystemCall( "epoll_wait", epoll_wait( epoll_fd_->fd_num(),
+                                                     &ready_events_[ 0 ], ready_events_.size(),
+                                                     0 ) );
+    }
+
+    const int ready_count = epoll_wait( epoll_fd_->fd_num(),
+                                        &ready_events_[ 0 ], ready_events_.size(),
+                                        timeout_us < 0 ? -1 : timeout_us / 1000 );
+    if ( interrupted( ready_count ) ) {
+        return -1;
+    }
+    return SystemCall( "epoll_wait", ready_count );
+}
+
+Poller::Result Poller::poll_with_epoll( const int64_t & timeout_us )
+{
+    if ( not epoll_fd_ ) {
+        epoll_fd_.reset( new FileDescriptor( SystemCall( "epoll_create1", epoll_create1( EPOLL_CLOEXEC ) ) ) );
+    }
+
+    /* interest can only have changed on fds whose actions were serviced
+       (EOF, cancellation) or that carry a caller-supplied predicate */
+    for ( const int fd_num : dirty_fds_ ) {
+        Registration & registration = registrations_.at( fd_num );
+        registration.dirty = false;
+        update_registration( fd_num, registration );
+        if ( backend_ == Backend::Poll ) {
+            return poll_with_poll( timeout_us );
+        }
+    }
+    dirty_fds_.clear();
+
+    for ( const int fd_num : conditional_fds_ ) {
+        update_registration( fd_num, registrations_.at( fd_num ) );
+    }
+
+    /* Quit if no action is interested in anything */
+    if ( interested_actions_ == 0 ) {
+        return Result::Type::Exit;
+    }
+
+    ready_events_.resize( registrations_.size() );
+
+    poll_calls_++;
+    const int ready_count = epoll_wait_us( timeout_us );
+    if ( ready_count < 0 ) {
+        return Result::Type::Success; /* interrupted: nothing serviced */
+    }
+    if ( ready_count == 0 ) {
+        return Result::Type::Timeout;
+    }
+
+    for ( int j = 0; j < ready_count; j++ ) {
+        if ( ready_events_[ j ].events & (EPOLLERR | EPOLLHUP) ) {
+            return Result::Type::Exit;
+        }
+    }
+
+    for ( int j = 0; j < ready_count; j++ ) {
+        const int fd_num = ready_events_[ j ].data.fd;
+        Registration & registration = registrations_.at( fd_num );
+
+        for ( const auto & i : registration.actions ) {
+            const uint32_t asked = epoll_events( action_events_[ i ] );
+
+            /* we only want to call callback if events includes
+               the event we asked for */
+            if ( ready_events_[ j ].events & asked ) {
+                const auto result = run_callback( i );
+                if ( result.result == Result::Type::Exit ) {
+                    return result;
+                }
             }
         }
+
+        mark_dirty( registration, fd_num );
     }
 
     return Result::Type::Success;
@@ -0,0 +1,76 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <stdexcept>
+#include <algorithm>
+
+#include "quantile_sketch.hh"
+
+using namespace std;
+
+static const unsigned int EXACT_BITS = 10; /* values below 2^10 get their own bucket */
+static const uint64_t EXACT_LIMIT = uint64_t( 1 ) << EXACT_BITS;
+static const uint64_t HALF_LIMIT = EXACT_LIMIT / 2;
+
+QuantileSketch::QuantileSketch()
+    : counts_(),
+      samples_( 0 )
+{}
+
+/* position of the highest set bit */
+static unsigned int msb( const uint64_t value )
+{
+    return 63 - __builtin_clzll( value );
+}
+
+/* above the exact range, each power of two is split into 512 buckets */
+size_t QuantileSketch::bucket( const uint64_t value )
+{
+    if ( value < EXACT_LIMIT ) {
+        return value;
+    }
+
+    const unsigned int exponent = msb( value );
+    const unsigned int shift = exponent - (EXACT_BITS - 1);
+    return EXACT_LIMIT + (exponent - EXACT_BITS) * HALF_LIMIT + ((value >> shift) - HALF_LIMIT);
+}
+
+uint64_t QuantileSketch::lowest_value( const size_t bucket )
+{
+    if ( bucket < EXACT_LIMIT ) {
+        return bucket;
+    }
+
+    const unsigned int exponent = EXACT_BITS + (bucket - EXACT_LIMIT) / HALF_LIMIT;
+    const uint64_t top = HALF_LIMIT + (bucket - EXACT_LIMIT) % HALF_LIMIT;
+    return top << (exponent - (EXACT_BITS - 1));
+}
+
+void QuantileSketch::add( const uint64_t value, const uint64_t count )
+{
+    const size_t index = bucket( value );
+    if ( index >= counts_.size() ) {
+        counts_.resize( index + 1 );
+    }
+
+    counts_[ index ] += count;
+    samples_ += count;
+}
+
+uint64_t QuantileSketch::quantile( const double q ) const
+{
+    if ( samples_ == 0 ) {
+        throw runtime_error( "QuantileSketch: no samples" );
+    }
+
+    const uint64_t rank = min( uint64_t( q * samples_ ), samples_ - 1 );
+
+    uint64_t seen = 0;
+    for ( size_t i = 0; i < counts_.size(); i++ ) {
+        seen += counts_[ i ];
+        if ( seen > rank ) {
+            return lowest_value( i );
+        }
+    }
+
+    throw runtime_error( "QuantileSketch: counts do not add up" );
+}
@@ -0,0 +1,35 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef QUANTILE_SKETCH_HH
+#define QUANTILE_SKETCH_HH
+
+#include <vector>
+#include <cstdint>
+
+/* counts of nonnegative integers in log-linear buckets: values below
+   1024 are counted exactly, larger ones in buckets no wider than 1/512
+   of their value. Memory is bounded (under 256 KiB) however many
+   values are added or how large they are. */
+
+class QuantileSketch
+{
+private:
+    std::vector<uint64_t> counts_; /* grown as larger values arrive */
+    uint64_t samples_;
+
+    static size_t bucket( const uint64_t value );
+    static uint64_t lowest_value( const size_t bucket );
+
+public:
+    QuantileSketch();
+
+    void add( const uint64_t value, const uint64_t count = 1 );
+
+    uint64_t samples( void ) const { return samples_; }
+
+    /* the value at index floor(q * samples) of the sorted values (q from 0 to 1),
+       or the lowest value that shares its bucket */
+    uint64_t quantile( const double q ) const;
+};
+
+#endif /* QUANTILE_SKETCH_HH */
@@ -0,0 +1,121 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef SPSC_RING_HH
+#define SPSC_RING_HH
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <utility>
+
+/* a bounded queue between exactly one producer thread and one consumer
+   thread, without locks. Each side only writes its own index, and keeps
+   a stale copy of the other side's so it only has to look across when
+   the ring seems full (or empty). */
+
+template <typename T>
+class SPSCRing
+{
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    /* producer's and consumer's indices, padded onto separate cache lines
+       (alignas would need an aligned operator new, which is C++17) */
+    char padding_before_producer_[ 64 ];
+    std::atomic<size_t> tail_; /* next slot to push */
+    size_t head_seen_by_producer_;
+    char padding_before_consumer_[ 64 ];
+    std::atomic<size_t> head_; /* next slot to pop */
+    mutable size_t tail_seen_by_consumer_; /* a cache, so a const peek may refresh it */
+    char padding_after_consumer_[ 64 ];
+
+    template <typename Item>
+    bool push_item( Item && item )
+    {
+        const size_t tail = tail_.load( std::memory_order_relaxed );
+        if ( tail - head_seen_by_producer_ == slots_.size() ) {
+            head_seen_by_producer_ = head_.load( std::memory_order_acquire );
+            if ( tail - head_seen_by_producer_ == slots_.size() ) {
+                return false;
+            }
+        }
+
+        slots_[ tail & mask_ ] = std::forward<Item>( item );
+        tail_.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+public:
+    /* capacity must be a power of two */
+    SPSCRing( const size_t capacity )
+        : slots_( capacity ),
+          mask_( capacity - 1 ),
+          padding_before_producer_(),
+          tail_( 0 ),
+          head_seen_by_producer_( 0 ),
+          padding_before_consumer_(),
+          head_( 0 ),
+          tail_seen_by_consumer_( 0 ),
+          padding_after_consumer_()
+    {
+        if ( capacity == 0 or (capacity & mask_) ) {
+            throw std::runtime_error( "SPSCRing: capacity must be a power of two" );
+        }
+    }
+
+    /* producer: false if the ring is full (leaving the item untouched) */
+    bool push( const T & item ) { return push_item( item ); }
+    bool push( T && item ) { return push_item( std::move( item ) ); }
+
+    /* consumer: the oldest item, in place (nullptr if the ring is empty) */
+    const T * front( void ) const
+    {
+        const size_t head = head_.load( std::memory_order_relaxed );
+        if ( tail_seen_by_consumer_ == head ) {
+            tail_seen_by_consumer_ = tail_.load( std::memory_order_acquire );
+            if ( tail_seen_by_consumer_ == head ) {
+                return nullptr;
+            }
+        }
+
+        return &slots_[ head & mask_ ];
+    }
+
+    T * front( void ) { return const_cast<T *>( static_cast<const SPSCRing &>( *this ).front() ); }
+
+    /* consumer: drop the oldest item (which front() must have returned),
+       leaving its slot empty so that it holds on to nothing */
+    void pop( void )
+    {
+        const size_t head = head_.load( std::memory_order_relaxed );
+        slots_[ head & mask_ ] = T();
+        head_.store( head + 1, std::memory_order_release );
+    }
+
+    /* consumer: is there nothing to pop? */
+    bool empty( void ) const { return front() == nullptr; }
+
+    /* consumer: copy out up to max_count items, returning how many */
+    size_t pop( T * output, const size_t max_count )
+    {
+        const size_t head = head_.load( std::memory_order_relaxed );
+        if ( tail_seen_by_consumer_ == head ) {
+            tail_seen_by_consumer_ = tail_.load( std::memory_order_acquire );
+        }
+
+        const size_t count = std::min( max_count, tail_seen_by_consumer_ - head );
+        for ( size_t i = 0; i < count; i++ ) {
+            output[ i ] = slots_[ (head + i) & mask_ ];
+        }
+
+        head_.store( head + count, std::memory_order_release );
+        return count;
+    }
+
+    size_t capacity( void ) const { return slots_.size(); }
+};
+
+#endif /* SPSC_RING_HH */
@@ -0,0 +1,52 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+
+#include <sys/timerfd.h>
+
+#include "timerfd.hh"
+#include "timestamp.hh"
+#include "exception.hh"
+
+using namespace std;
+
+TimerFD::TimerFD()
+    : fd_( SystemCall( "timerfd_create", timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC ) ) )
+{
+}
+
+void TimerFD::arm_at( const uint64_t deadline_us )
+{
+    const uint64_t deadline_ns = timestamp_origin_ns() + deadline_us * 1000;
+
+    itimerspec setting;
+    setting.it_interval = { 0, 0 };
+    setting.it_value.tv_sec = deadline_ns / 1000000000;
+    setting.it_value.tv_nsec = deadline_ns % 1000000000;
+
+    SystemCall( "timerfd_settime", timerfd_settime( fd_.fd_num(), TFD_TIMER_ABSTIME, &setting, nullptr ) );
+}
+
+void TimerFD::disarm( void )
+{
+    itimerspec setting;
+    setting.it_interval = setting.it_value = { 0, 0 };
+
+    SystemCall( "timerfd_settime", timerfd_settime( fd_.fd_num(), 0, &setting, nullptr ) );
+}
+
+/* read the expiration count */
+uint64_t TimerFD::read_expirations( void )
+{
+    uint64_t expirations;
+
+    const string expirations_str = fd_.read( sizeof( expirations ) );
+
+    if ( expirations_str.size() != sizeof( expirations ) ) {
+        throw runtime_error( "timerfd read size mismatch" );
+    }
+
+    memcpy( &expirations, expirations_str.data(), sizeof( expirations ) );
+
+    return expirations;
+}
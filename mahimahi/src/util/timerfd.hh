@@ -0,0 +1,29 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef TIMERFD_HH
+#define TIMERFD_HH
+
+#include <cstdint>
+
+#include "file_descriptor.hh"
+
+/* wrapper class for a CLOCK_MONOTONIC timer file descriptor,
+   armed with absolute deadlines on the timestamp_us() clock */
+
+class TimerFD
+{
+private:
+    FileDescriptor fd_;
+
+public:
+    TimerFD();
+
+    FileDescriptor & fd( void ) { return fd_; }
+
+    void arm_at( const uint64_t deadline_us );
+    void disarm( void );
+
+    uint64_t read_expirations( void ); /* number of expirations since last read */
+};
+
+#endif /* TIMERFD_HH */
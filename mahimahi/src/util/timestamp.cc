@@ -5,24 +5,81 @@
 #include "timestamp.hh"
 #include "exception.hh"
 
-uint64_t raw_timestamp( void )
+using namespace std;
+
+static uint64_t raw_timestamp_ns( const clockid_t clock )
 {
     timespec ts;
-    SystemCall( "clock_gettime", clock_gettime( CLOCK_REALTIME, &ts ) );
+    SystemCall( "clock_gettime", clock_gettime( clock, &ts ) );
+
+    return uint64_t( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+}
+
+struct Origin
+{
+    uint64_t wall_ms, monotonic_ns;
+
+    Origin() : wall_ms( raw_timestamp_ns( CLOCK_REALTIME ) / 1000000 ),
+               monotonic_ns( raw_timestamp_ns( CLOCK_MONOTONIC ) ) {}
+};
+
+static const Origin & origin( void )
+{
+    static const Origin initial_value;
+    return initial_value;
+}
+
+static Timebase current_timebase = Timebase::Microseconds;
+
+Timebase timebase( void )
+{
+    return current_timebase;
+}
+
+void set_timebase( const Timebase s_timebase )
+{
+    current_timebase = s_timebase;
+}
 
-    uint64_t millis = ts.tv_nsec / 1000000;
-    millis += uint64_t( ts.tv_sec ) * 1000;
+Timebase parse_timebase( const string & name )
+{
+    if ( name == "ms" ) {
+        return Timebase::Milliseconds;
+    } else if ( name == "us" ) {
+        return Timebase::Microseconds;
+    }
 
-    return millis;
+    throw runtime_error( "unknown timebase \"" + name + "\" (expected ms or us)" );
 }
 
 uint64_t initial_timestamp( void )
 {
-    static uint64_t initial_value = raw_timestamp();
-    return initial_value;
+    return origin().wall_ms;
+}
+
+uint64_t timestamp_origin_ns( void )
+{
+    return origin().monotonic_ns;
+}
+
+uint64_t timestamp_ns( void )
+{
+    const uint64_t origin_ns = origin().monotonic_ns; /* first, in case this sets it */
+    return raw_timestamp_ns( CLOCK_MONOTONIC ) - origin_ns;
+}
+
+uint64_t timestamp_us( void )
+{
+    const uint64_t micros = timestamp_ns() / 1000;
+
+    if ( current_timebase == Timebase::Milliseconds ) {
+        return micros - micros % 1000;
+    }
+
+    return micros;
 }
 
 uint64_t timestamp( void )
 {
-    return raw_timestamp() - initial_timestamp();
+    return timestamp_ns() / 1000000;
 }
@@ -4,8 +4,25 @@
 #define TIMESTAMP_HH
 
 #include <cstdint>
+#include <string>
 
-uint64_t timestamp( void );
+/* the resolution the emulators schedule at (by default, Microseconds);
+   Milliseconds reproduces mahimahi's original whole-ms behavior */
+enum class Timebase { Milliseconds, Microseconds };
+
+Timebase timebase( void );
+void set_timebase( const Timebase s_timebase );
+Timebase parse_timebase( const std::string & name ); /* "ms" or "us" */
+
+/* all relative to the same monotonic origin, taken by initial_timestamp() */
+uint64_t timestamp( void );    /* milliseconds */
+uint64_t timestamp_us( void ); /* microseconds, rounded down to the timebase */
+uint64_t timestamp_ns( void ); /* nanoseconds, unrounded */
+
+/* wall-clock milliseconds at the origin */
 uint64_t initial_timestamp( void );
 
+/* CLOCK_MONOTONIC nanoseconds at the origin (for absolute timers) */
+uint64_t timestamp_origin_ns( void );
+
 #endif /* TIMESTAMP_HH */
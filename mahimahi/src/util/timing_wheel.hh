@@ -0,0 +1,286 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef TIMING_WHEEL_HH
+#define TIMING_WHEEL_HH
+
+#include <vector>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <utility>
+
+/* Items released at their deadlines (in microseconds), for any number
+   of deadlines in any order, in a bounded number of steps per item: a
+   hierarchical timing wheel. Level 0 has a slot for each of the next
+   256 us; level 1 a slot for each 256 us of the next 65 ms; and so on,
+   to four levels (71 minutes), with anything later kept aside until it
+   is in range. An item goes straight into the slot its deadline falls
+   in, and when time reaches a slot above level 0, the slot's items are
+   spread into the levels below. A bitmap per level finds the next
+   occupied slot without looking at the empty ones. Items with the same
+   deadline come out in no particular order. Items live in one pool of
+   nodes, linked into their slots, so a steady state allocates nothing.
+   An item is filed once per level it passes through, and once the pool
+   outgrows the cache each filing is a cache miss: with many items far
+   ahead, a heap can be as fast (see timing-wheel-benchmark). */
+
+template <typename T>
+class TimingWheel
+{
+private:
+    const static unsigned int LEVELS = 4;
+    const static unsigned int SLOT_BITS = 8;
+    const static unsigned int SLOTS = 1 << SLOT_BITS;
+    const static unsigned int WORDS = SLOTS / 64; /* of bitmap */
+
+    const static uint32_t NIL = std::numeric_limits<uint32_t>::max();
+
+    struct Node
+    {
+        uint64_t deadline;
+        uint32_t next;
+        T item;
+    };
+
+    struct Slot
+    {
+        uint32_t head, tail;
+    };
+
+    struct Level
+    {
+        std::array<Slot, SLOTS> slots;
+        std::array<uint64_t, WORDS> occupied;
+    };
+
+    std::vector<Node> nodes_;
+    uint32_t free_list_;
+
+    std::array<Level, LEVELS> levels_;
+    std::vector<uint32_t> beyond_; /* past the top level's reach */
+    uint64_t earliest_beyond_;
+
+    uint64_t now_; /* everything due before now_ has been released */
+    size_t size_;
+
+    static unsigned int digit( const uint64_t time, const unsigned int level )
+    {
+        return ( time >> ( SLOT_BITS * level ) ) & ( SLOTS - 1 );
+    }
+
+    /* the first occupied slot at a level from index on, or SLOTS if none */
+    unsigned int first_occupied( const unsigned int level, const unsigned int index ) const
+    {
+        const auto & occupied = levels_[ level ].occupied;
+        unsigned int word = index / 64;
+        uint64_t bits = occupied[ word ] & ( ~uint64_t( 0 ) << ( index % 64 ) );
+        while ( not bits ) {
+            if ( ++word == WORDS ) {
+                return SLOTS;
+            }
+            bits = occupied[ word ];
+        }
+        return word * 64 + __builtin_ctzll( bits );
+    }
+
+    /* file a node under its deadline, relative to now_ */
+    void place( const uint32_t index )
+    {
+        const uint64_t deadline = nodes_[ index ].deadline;
+        const uint64_t difference = deadline ^ now_;
+        const unsigned int level = difference < SLOTS
+            ? 0 : ( 63 - __builtin_clzll( difference ) ) / SLOT_BITS;
+
+        if ( level >= LEVELS ) {
+            beyond_.push_back( index );
+            earliest_beyond_ = std::min( earliest_beyond_, deadline );
+            return;
+        }
+
+        const unsigned int slot_index = digit( deadline, level );
+        Slot & slot = levels_[ level ].slots[ slot_index ];
+        nodes_[ index ].next = NIL;
+        if ( slot.head == NIL ) {
+            slot.head = index;
+            levels_[ level ].occupied[ slot_index / 64 ] |= uint64_t( 1 ) << ( slot_index % 64 );
+        } else {
+            nodes_[ slot.tail ].next = index;
+        }
+        slot.tail = index;
+    }
+
+    /* empty a slot, returning its list */
+    uint32_t take_slot( const unsigned int level, const unsigned int slot_index )
+    {
+        Slot & slot = levels_[ level ].slots[ slot_index ];
+        const uint32_t ret = slot.head;
+        slot.head = slot.tail = NIL;
+        levels_[ level ].occupied[ slot_index / 64 ] &= ~( uint64_t( 1 ) << ( slot_index % 64 ) );
+        return ret;
+    }
+
+    /* the start of the earliest occupied slot, and where it is
+       (level LEVELS for the items beyond); false if there are no items */
+    bool earliest_slot( uint64_t & start, unsigned int & level, unsigned int & slot_index ) const
+    {
+        for ( level = 0; level < LEVELS; level++ ) {
+            slot_index = first_occupied( level, digit( now_, level ) );
+            if ( slot_index < SLOTS ) {
+                const unsigned int shift = SLOT_BITS * level;
+                const uint64_t above = now_ >> ( shift + SLOT_BITS ) << ( shift + SLOT_BITS );
+                start = above | ( uint64_t( slot_index ) << shift );
+                return true;
+            }
+        }
+
+        if ( not beyond_.empty() ) {
+            const unsigned int reach = SLOT_BITS * LEVELS;
+            start = earliest_beyond_ >> reach << reach;
+            return true;
+        }
+
+        return false;
+    }
+
+    /* time has reached a slot above level 0: file its items again, lower down */
+    void spread( const unsigned int level, const unsigned int slot_index )
+    {
+        if ( level == LEVELS ) {
+            std::vector<uint32_t> beyond;
+            beyond.swap( beyond_ );
+            earliest_beyond_ = std::numeric_limits<uint64_t>::max();
+            for ( const auto index : beyond ) {
+                place( index );
+            }
+            return;
+        }
+
+        for ( uint32_t index = take_slot( level, slot_index ); index != NIL; ) {
+            const uint32_t next = nodes_[ index ].next;
+            place( index );
+            index = next;
+        }
+    }
+
+    void free_node( const uint32_t index )
+    {
+        nodes_[ index ].next = free_list_;
+        free_list_ = index;
+    }
+
+public:
+    TimingWheel( const uint64_t now )
+        : nodes_(), free_list_( NIL ), levels_(), beyond_(),
+          earliest_beyond_( std::numeric_limits<uint64_t>::max() ), now_( now ), size_( 0 )
+    {
+        for ( auto & level : levels_ ) {
+            level.slots.fill( { NIL, NIL } );
+            level.occupied.fill( 0 );
+        }
+    }
+
+    /* an item to release at the deadline (at once if that has passed) */
+    void insert( const uint64_t deadline, T && item )
+    {
+        uint32_t index = free_list_;
+        if ( index == NIL ) {
+            if ( nodes_.size() == NIL ) {
+                throw std::runtime_error( "TimingWheel: too many items" );
+            }
+            index = nodes_.size();
+            nodes_.push_back( Node { 0, NIL, T() } );
+        } else {
+            free_list_ = nodes_[ index ].next;
+        }
+
+        nodes_[ index ].deadline = std::max( deadline, now_ );
+        nodes_[ index ].item = std::move( item );
+        place( index );
+        size_++;
+    }
+
+    /* release every item due by the given time, earliest deadline first,
+       to release( deadline, T && item ) */
+    template <typename Release>
+    void advance( const uint64_t now, Release && release )
+    {
+        if ( now < now_ ) {
+            return;
+        }
+
+        uint64_t start;
+        unsigned int level, slot_index;
+        while ( earliest_slot( start, level, slot_index ) and start <= now ) {
+            now_ = start;
+
+            if ( level > 0 ) {
+                spread( level, slot_index );
+                continue;
+            }
+
+            /* due (every item in a level-0 slot has the same deadline) */
+            for ( uint32_t index = take_slot( level, slot_index ); index != NIL; ) {
+                Node & node = nodes_[ index ];
+                const uint32_t next = node.next;
+                release( node.deadline, std::move( node.item ) );
+                node.item = T();
+                free_node( index );
+                size_--;
+                index = next;
+            }
+            now_ = start + 1;
+        }
+
+        now_ = now + 1;
+
+        /* a higher slot that starts exactly at now_ is spread now, so that
+           every item left above level 0 is in a slot after now_'s */
+        while ( earliest_slot( start, level, slot_index ) and start == now_ and level > 0 ) {
+            spread( level, slot_index );
+        }
+    }
+
+    /* spread every slot above level 0 that the given time has reached,
+       until the earliest item is either in level 0 or in a slot that
+       starts later, so that due() sees every item due by then */
+    void cascade( const uint64_t now )
+    {
+        uint64_t start;
+        unsigned int level, slot_index;
+        while ( earliest_slot( start, level, slot_index ) and level > 0 and start <= now ) {
+            now_ = start;
+            spread( level, slot_index );
+        }
+    }
+
+    /* whether an item in level 0 is due by the given time (an item still
+       above level 0 is not seen until a cascade or advance reaches it) */
+    bool due( const uint64_t now ) const
+    {
+        uint64_t start;
+        unsigned int level, slot_index;
+        return earliest_slot( start, level, slot_index ) and level == 0 and start <= now;
+    }
+
+    /* when to look at the wheel next: when the next item is due, or
+       before that, the start of the earliest occupied slot above level 0
+       (which a cascade will spread, releasing nothing); max() if there
+       are no items. A hint for a timer, not a promise that anything is
+       due then. */
+    uint64_t next_deadline( void ) const
+    {
+        uint64_t start;
+        unsigned int level, slot_index;
+        if ( earliest_slot( start, level, slot_index ) ) {
+            return start;
+        }
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    size_t size( void ) const { return size_; }
+    bool empty( void ) const { return size_ == 0; }
+};
+
+#endif /* TIMING_WHEEL_HH */
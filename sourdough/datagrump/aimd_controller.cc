@@ -0,0 +1,162 @@
+#include <iostream> 
+#include <math.h>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "aimd_controller.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+/* defaults of the tunables, and their names */
+const unsigned int DEFAULT_WIN = 32;		// default cwnd size (default_window)
+const uint64_t MAX_DELAY = 100;		// maximum desired latency (max_delay)
+const int PREDICTION_SIZE = 4;			// number of recent ACKs to track for prediction of next RTT (prediction_size)
+const double ADDITIVE_INCREASE = 1.5;		// window growth per window of acks (additive_increase)
+const double TREND_SCALE = 2.0;		// extra growth while the RTT is falling (trend_scale)
+const double PREDICTED_DECREASE = 2.0;		// window divisor when a predicted RTT is too high (predicted_decrease)
+const double PACING_GAIN = 1.25;		// pace a little faster than window/RTT so the window stays the limit (pacing_gain)
+const bool ONE_WAY = false;			// see only the forward queue, by the receiver's timestamps (one_way)
+
+/* A tunable that has to be at least some minimum */
+static double at_least( const ControllerParameters & parameters, const string & name,
+			const double default_value, const double minimum )
+{
+  const double value = parameters.get( name, default_value );
+  if ( value < minimum ) {
+    throw runtime_error( "aimd: " + name + " must be at least " + to_string( int( minimum ) ) );
+  }
+  return value;
+}
+
+/* Default constructor */
+AIMDController::AIMDController( const bool debug, const ControllerParameters & parameters )
+  : Controller( debug ),
+    default_window_( at_least( parameters, "default_window", DEFAULT_WIN, 1 ) ),
+    max_delay_( at_least( parameters, "max_delay", MAX_DELAY, 1 ) ),
+    prediction_size_( at_least( parameters, "prediction_size", PREDICTION_SIZE, 2 ) ),
+    additive_increase_( parameters.get( "additive_increase", ADDITIVE_INCREASE ) ),
+    trend_scale_( parameters.get( "trend_scale", TREND_SCALE ) ),
+    predicted_decrease_( parameters.get( "predicted_decrease", PREDICTED_DECREASE ) ),
+    pacing_gain_( parameters.get( "pacing_gain", PACING_GAIN ) ),
+    one_way_( parameters.get( "one_way", ONE_WAY ) ),
+    window_size_( default_window_ ), silly_window_( default_window_ ),
+    rtt_min_( max_delay_ ), prev_rtt_( 0 ), last_seq_sent_( 0 ), flight_counter_( 0 ),
+    timestamp_prev_ack_received_( 0 ), recent_RTTs_( prediction_size_ )
+{}
+
+/* Get current window size, in datagrams */
+unsigned int AIMDController::current_window( void )
+{
+  return window_size_;
+}
+
+/* A datagram was sent */
+void AIMDController::record_sent( const uint64_t sequence_number,
+				  /* of the sent datagram */
+				  const uint64_t )
+{
+  last_seq_sent_ = sequence_number;
+}
+
+/* An ack was received */
+void AIMDController::record_ack( const uint64_t sequence_number_acked,
+				 /* what sequence number was acknowledged */
+				 const uint64_t send_timestamp_acked,
+				 /* when the acknowledged datagram was sent (sender's clock) */
+				 const uint64_t,
+				 const uint64_t timestamp_ack_received )
+				 /* when the ack was received (by sender) */
+{ 
+  uint64_t rtt = timestamp_ack_received - send_timestamp_acked;
+  
+  // update rtt_min_ 
+  if (rtt < rtt_min_) {
+    rtt_min_ = rtt;
+  }
+  if ( debug() ) {
+    cerr << "RTTmin is " << rtt_min_ << endl;
+  }
+
+  /* the propagation RTT, and only the queueing on the way to the receiver */
+  if ( one_way_ ) {
+    rtt = min( rtt, rtt_min_ + one_way_delay().queueing_delay() );
+  }
+  
+  bool predicted = false;
+  /* do not double count acks received at the same time */
+  if (recent_RTTs_.size() == 0 or timestamp_ack_received != timestamp_prev_ack_received_) {
+    recent_RTTs_.add(timestamp_ack_received, rtt);
+    if (recent_RTTs_.full()) {
+      rtt = predicted_RTT(timestamp_ack_received);
+      predicted = true;
+    }
+  }
+  timestamp_prev_ack_received_ = timestamp_ack_received; 
+  update_window (rtt, sequence_number_acked, predicted);
+  prev_rtt_ = rtt;
+}
+
+/* Update window size based on new RTT sample */
+void AIMDController::update_window( uint64_t rtt, uint64_t sequence_number_acked, bool predicted) 
+{
+  if (rtt > timeout_ms()) {
+    if ( flight_counter_ == 0 ) { /*  only decrease window size once per group of datagrams */
+      float resize_factor = (rtt-(timeout_ms()/2.0))/(timeout_ms()/2.0);
+      if (predicted) {
+	/* decrease window less aggressively if using a prediction */
+	window_size_ = ceil(window_size_/predicted_decrease_);
+      } else {
+	window_size_ = ceil(window_size_/(resize_factor));
+      }
+      silly_window_ = window_size_;
+      flight_counter_ = last_seq_sent_ - sequence_number_acked; 
+    } else { flight_counter_--; }
+  } else {
+    float scale_factor = 1.0;
+    if (rtt < prev_rtt_) {
+      /* increase window more aggressively if RTT is trending downwards */
+      scale_factor = trend_scale_*((prev_rtt_ - rtt)/float(prev_rtt_) + 1);
+    } 
+    silly_window_ = silly_window_ + (scale_factor*additive_increase_)/(float(window_size_));
+    window_size_ = floor(silly_window_);
+  }
+}
+
+/* Extrapolate the regression line of the most recent ACK time+rtt
+   pairs to the next ACK, expected as long after this one as this one
+   was after the last */
+uint64_t AIMDController::predicted_RTT(uint64_t time)
+{
+  uint64_t predicted_time_to_next_ack = time - timestamp_prev_ack_received_;
+  
+  double pred_rtt = ceil(recent_RTTs_.predict(time + predicted_time_to_next_ack));
+  
+  /* we don't want to predict something more optimistic than what's possible */
+  if(pred_rtt >= rtt_min_) {
+    return uint64_t(pred_rtt);
+  } else {
+    return rtt_min_;
+  }
+}
+
+/* How long to wait (in milliseconds) if there are no acks
+   before sending one more datagram */
+unsigned int AIMDController::timeout_ms( void )
+{
+  return min(2*rtt_min_, max_delay_);
+}
+
+/* Target sending rate, in datagrams per second */
+double AIMDController::send_rate( void )
+{
+  /* spread one window over the most recent RTT (predicted or measured) */
+  const uint64_t rtt = max( prev_rtt_, rtt_min_ );
+  if ( rtt == 0 ) {
+    return 0;
+  }
+
+  return pacing_gain_ * window_size_ * 1000.0 / rtt;
+}
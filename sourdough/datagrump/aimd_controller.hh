@@ -0,0 +1,65 @@
+#ifndef AIMD_CONTROLLER_HH
+#define AIMD_CONTROLLER_HH
+
+#include <cstdint>
+
+#include "controller.hh"
+#include "sliding_regression.hh"
+
+/* Delay-threshold AIMD: grow the window additively while the RTT
+   stays under the timeout, and cut it when it goes over. Once a few
+   acks are in, the RTT compared is a linear-regression prediction
+   from the most recent ones. With one_way=1, the RTT of each ack is
+   taken as the least RTT plus the datagram's one-way queueing delay,
+   leaving out whatever queued up on the ack's way back. */
+
+class AIMDController : public Controller
+{
+private:
+  /* Tunables, settable as NAME=VALUE (see the defaults in aimd_controller.cc) */
+  unsigned int default_window_;
+  uint64_t max_delay_;
+  unsigned int prediction_size_;
+  double additive_increase_;
+  double trend_scale_;
+  double predicted_decrease_;
+  double pacing_gain_;
+  bool one_way_;
+
+  /* Involved in window adjustment */
+  unsigned int window_size_;
+  float silly_window_;
+  uint64_t rtt_min_;
+  uint64_t prev_rtt_;
+
+  /* Involved in tracking data in flight */
+  uint64_t last_seq_sent_;
+  uint64_t flight_counter_;
+  uint64_t timestamp_prev_ack_received_;
+  
+  /* Involved in predicting next RTT: the RTTs of the most recent
+     acks, against when they were received */
+  SlidingRegression recent_RTTs_;
+
+  unsigned int current_window( void ) override;
+  void record_sent( const uint64_t sequence_number,
+		    const uint64_t send_timestamp ) override;
+  void record_ack( const uint64_t sequence_number_acked,
+		   const uint64_t send_timestamp_acked,
+		   const uint64_t recv_timestamp_acked,
+		   const uint64_t timestamp_ack_received ) override;
+
+  /* Predict the upcoming RTT based on recent ACKs */
+  uint64_t predicted_RTT(uint64_t time);
+
+  /* Update window size based on new RTT sample */
+  void update_window( uint64_t rtt, uint64_t sequence_number_acked, bool predicted);
+
+public:
+  AIMDController( const bool debug, const ControllerParameters & parameters );
+
+  unsigned int timeout_ms( void ) override;
+  double send_rate( void ) override;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "bbr_controller.hh"
+
+using namespace std;
+
+const unsigned int INITIAL_WIN = 10;		// window before the first bandwidth sample
+const unsigned int MIN_WIN = 4;			// window while probing for the min RTT
+const double STARTUP_GAIN = 2.885;		// 2/ln(2): double the delivery rate each round trip
+const double CWND_GAIN = 2.0;			// window, in bandwidth-delay products
+const double PROBE_BW_GAINS[] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+const unsigned int PROBE_BW_PHASES = sizeof( PROBE_BW_GAINS ) / sizeof( PROBE_BW_GAINS[ 0 ] );
+const unsigned int BANDWIDTH_ROUNDS = 10;	// round trips the bandwidth max is taken over
+const double FULL_BANDWIDTH_GROWTH = 1.25;	// startup continues while bandwidth grows this much...
+const unsigned int FULL_BANDWIDTH_ROUNDS = 3;	// ...within this many round trips
+const uint64_t MIN_RTT_WINDOW = 10000;		// ms a min RTT sample stays valid
+const uint64_t PROBE_RTT_DURATION = 200;	// ms spent at the minimum window
+const uint64_t MIN_TIMEOUT = 100;		// ms
+const size_t SEND_RECORDS = 4096;		// datagrams in flight the delivery rate can be sampled over
+
+/* Default constructor */
+BBRController::BBRController( const bool debug, const ControllerParameters & )
+  : Controller( debug ), mode_( Mode::Startup ),
+    sent_( SEND_RECORDS ), next_sequence_number_( 0 ), acked_through_( 0 ),
+    delivered_( 0 ), delivered_time_( 0 ), first_send_time_( 0 ),
+    round_count_( 0 ), next_round_delivered_( 0 ),
+    round_max_bandwidth_( BANDWIDTH_ROUNDS ), bottleneck_bandwidth_( 0 ),
+    min_rtt_( 0 ), min_rtt_stamp_( 0 ),
+    full_bandwidth_( 0 ), full_bandwidth_rounds_( 0 ), filled_pipe_( false ),
+    cycle_index_( 0 ), cycle_stamp_( 0 ), probe_rtt_done_stamp_( 0 )
+{}
+
+/* Datagrams sent but not yet acked (or passed over by a later ack) */
+uint64_t BBRController::in_flight( void ) const
+{
+  return next_sequence_number_ - min( acked_through_, next_sequence_number_ );
+}
+
+/* Estimated bandwidth-delay product, in datagrams */
+double BBRController::bdp( void ) const
+{
+  return bottleneck_bandwidth_ * min_rtt_;
+}
+
+double BBRController::pacing_gain( void ) const
+{
+  switch ( mode_ ) {
+  case Mode::Startup: return STARTUP_GAIN;
+  case Mode::Drain: return 1 / STARTUP_GAIN;
+  case Mode::ProbeBW: return PROBE_BW_GAINS[ cycle_index_ ];
+  case Mode::ProbeRTT: return 1;
+  }
+
+  return 1;
+}
+
+/* Get current window size, in datagrams */
+unsigned int BBRController::current_window( void )
+{
+  if ( mode_ == Mode::ProbeRTT ) {
+    return MIN_WIN;
+  }
+
+  if ( bottleneck_bandwidth_ == 0 or min_rtt_ == 0 ) {
+    return INITIAL_WIN;
+  }
+
+  /* startup and drain keep the startup window, so draining is done by pacing */
+  const double gain = ( mode_ == Mode::Startup or mode_ == Mode::Drain ) ? STARTUP_GAIN : CWND_GAIN;
+  return max( MIN_WIN, static_cast<unsigned int>( ceil( gain * bdp() ) ) );
+}
+
+/* A datagram was sent */
+void BBRController::record_sent( const uint64_t sequence_number,
+				 const uint64_t send_timestamp )
+{
+  /* after an idle spell, delivery rates are measured from the restart */
+  if ( in_flight() == 0 ) {
+    delivered_time_ = send_timestamp;
+    first_send_time_ = send_timestamp;
+  }
+
+  sent_[ sequence_number % sent_.size() ] = { sequence_number, send_timestamp, first_send_time_,
+					      delivered_, delivered_time_ };
+  next_sequence_number_ = max( next_sequence_number_, sequence_number + 1 );
+}
+
+/* An ack was received */
+void BBRController::record_ack( const uint64_t sequence_number_acked,
+				const uint64_t send_timestamp_acked,
+				const uint64_t,
+				const uint64_t timestamp_ack_received )
+{
+  acked_through_ = max( acked_through_, sequence_number_acked + 1 );
+  delivered_++;
+  delivered_time_ = timestamp_ack_received;
+
+  update_min_rtt( timestamp_ack_received - send_timestamp_acked, timestamp_ack_received );
+
+  bool round_start = false;
+  const SendRecord & record = sent_[ sequence_number_acked % sent_.size() ];
+  if ( record.sequence_number == sequence_number_acked ) {
+    /* a round trip ends with the first datagram sent after it began */
+    if ( record.delivered >= next_round_delivered_ ) {
+      next_round_delivered_ = delivered_;
+      round_count_++;
+      round_max_bandwidth_[ round_count_ % round_max_bandwidth_.size() ] = 0;
+      round_start = true;
+    }
+
+    update_bandwidth( record, timestamp_ack_received );
+    first_send_time_ = record.send_time;
+  }
+
+  update_mode( round_start, timestamp_ack_received );
+}
+
+/* Delivery rate since the acked datagram was sent, into the windowed max.
+   The datagrams delivered meanwhile were sent over one interval and
+   acked over another, and they can go no faster than the slower of
+   the two (acks that bunch up on the way back would, on their own,
+   overstate it) */
+void BBRController::update_bandwidth( const SendRecord & record, const uint64_t now )
+{
+  const uint64_t send_interval = record.send_time - min( record.first_send_time, record.send_time );
+  const uint64_t ack_interval = now - record.delivered_time;
+  const uint64_t interval = max( send_interval, ack_interval );
+  if ( interval == 0 ) {
+    return;
+  }
+
+  const double bandwidth = double( delivered_ - record.delivered ) / interval;
+
+  double & round_max = round_max_bandwidth_[ round_count_ % round_max_bandwidth_.size() ];
+  round_max = max( round_max, bandwidth );
+
+  bottleneck_bandwidth_ = *max_element( round_max_bandwidth_.begin(), round_max_bandwidth_.end() );
+}
+
+/* Keep the least RTT, until it is too old to trust */
+void BBRController::update_min_rtt( const uint64_t rtt, const uint64_t now )
+{
+  const bool expired = min_rtt_ and now > min_rtt_stamp_ + MIN_RTT_WINDOW;
+
+  if ( min_rtt_ == 0 or rtt <= min_rtt_ or expired ) {
+    min_rtt_ = max( rtt, uint64_t( 1 ) );
+    min_rtt_stamp_ = now;
+  }
+
+  /* drain the queue to see the propagation delay again */
+  if ( expired and mode_ != Mode::ProbeRTT ) {
+    enter( Mode::ProbeRTT, now );
+  }
+}
+
+void BBRController::update_mode( const bool round_start, const uint64_t now )
+{
+  switch ( mode_ ) {
+  case Mode::Startup:
+    if ( round_start and bottleneck_bandwidth_ > 0 ) {
+      if ( bottleneck_bandwidth_ >= full_bandwidth_ * FULL_BANDWIDTH_GROWTH ) {
+	full_bandwidth_ = bottleneck_bandwidth_;
+	full_bandwidth_rounds_ = 0;
+      } else if ( ++full_bandwidth_rounds_ >= FULL_BANDWIDTH_ROUNDS ) {
+	filled_pipe_ = true;
+	enter( Mode::Drain, now );
+      }
+    }
+    break;
+
+  case Mode::Drain:
+    if ( in_flight() <= bdp() ) {
+      enter( Mode::ProbeBW, now );
+    }
+    break;
+
+  case Mode::ProbeBW:
+    if ( now - cycle_stamp_ > min_rtt_ ) {
+      cycle_index_ = ( cycle_index_ + 1 ) % PROBE_BW_PHASES;
+      cycle_stamp_ = now;
+    }
+    break;
+
+  case Mode::ProbeRTT:
+    if ( probe_rtt_done_stamp_ == 0 ) {
+      if ( in_flight() <= MIN_WIN ) {
+	probe_rtt_done_stamp_ = now + PROBE_RTT_DURATION;
+      }
+    } else if ( now >= probe_rtt_done_stamp_ ) {
+      min_rtt_stamp_ = now;
+      enter( filled_pipe_ ? Mode::ProbeBW : Mode::Startup, now );
+    }
+    break;
+  }
+}
+
+void BBRController::enter( const Mode mode, const uint64_t now )
+{
+  mode_ = mode;
+
+  if ( mode == Mode::ProbeBW ) {
+    /* start cruising; the probe for more bandwidth comes around in a few round trips */
+    cycle_index_ = 2;
+    cycle_stamp_ = now;
+  } else if ( mode == Mode::ProbeRTT ) {
+    probe_rtt_done_stamp_ = 0;
+  }
+
+  if ( debug() ) {
+    const char * const names[] = { "startup", "drain", "probe bandwidth", "probe RTT" };
+    cerr << "At time " << now << " entering " << names[ static_cast<int>( mode ) ]
+	 << " (bandwidth " << bottleneck_bandwidth_ * 1000 << " datagrams/s, min RTT "
+	 << min_rtt_ << " ms)" << endl;
+  }
+}
+
+/* How long to wait (in milliseconds) if there are no acks
+   before sending one more datagram */
+unsigned int BBRController::timeout_ms( void )
+{
+  return max( 2 * min_rtt_, MIN_TIMEOUT );
+}
+
+/* Target sending rate, in datagrams per second */
+double BBRController::send_rate( void )
+{
+  return pacing_gain() * bottleneck_bandwidth_ * 1000;
+}
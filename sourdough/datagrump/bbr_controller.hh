@@ -0,0 +1,90 @@
+#ifndef BBR_CONTROLLER_HH
+#define BBR_CONTROLLER_HH
+
+#include <cstdint>
+#include <vector>
+
+#include "controller.hh"
+
+/* BBR-style model-based control: estimate the bottleneck bandwidth
+   (the most datagrams per millisecond delivered in any of the last
+   few round trips) and the propagation RTT (the least RTT in the last
+   ten seconds), and keep about twice their product in flight, pacing
+   at the bandwidth scaled by a gain that now and then probes for
+   more. Startup, drain, bandwidth probing and min-RTT probing follow
+   BBR's state machine, simplified to a datagram-counting sender. */
+
+class BBRController : public Controller
+{
+private:
+  enum class Mode { Startup, Drain, ProbeBW, ProbeRTT };
+
+  /* what was known when each datagram was sent, for its delivery rate */
+  struct SendRecord
+  {
+    uint64_t sequence_number;
+    uint64_t send_time;
+    uint64_t first_send_time; /* when the datagram whose ack came latest was sent */
+    uint64_t delivered;       /* datagrams delivered so far */
+    uint64_t delivered_time;  /* when the latest of them was acked */
+  };
+
+  Mode mode_;
+
+  std::vector<SendRecord> sent_; /* indexed by sequence number, modulo its size */
+  uint64_t next_sequence_number_; /* one past the latest sent */
+  uint64_t acked_through_;        /* one past the largest acked */
+
+  uint64_t delivered_;
+  uint64_t delivered_time_;
+  uint64_t first_send_time_; /* when the latest acked datagram was sent */
+
+  /* round trips, counted by the delivery of a datagram sent after the last one began */
+  uint64_t round_count_;
+  uint64_t next_round_delivered_;
+
+  /* bottleneck bandwidth in datagrams/ms: the max per round, over recent rounds */
+  std::vector<double> round_max_bandwidth_;
+  double bottleneck_bandwidth_;
+
+  /* propagation RTT in ms (0 before the first ack) */
+  uint64_t min_rtt_;
+  uint64_t min_rtt_stamp_;
+
+  /* startup ends when the bandwidth stops growing */
+  double full_bandwidth_;
+  unsigned int full_bandwidth_rounds_;
+  bool filled_pipe_;
+
+  /* position in the ProbeBW gain cycle */
+  unsigned int cycle_index_;
+  uint64_t cycle_stamp_;
+
+  /* when ProbeRTT may end (0 until the window has drained down) */
+  uint64_t probe_rtt_done_stamp_;
+
+  unsigned int current_window( void ) override;
+  void record_sent( const uint64_t sequence_number,
+		    const uint64_t send_timestamp ) override;
+  void record_ack( const uint64_t sequence_number_acked,
+		   const uint64_t send_timestamp_acked,
+		   const uint64_t recv_timestamp_acked,
+		   const uint64_t timestamp_ack_received ) override;
+
+  uint64_t in_flight( void ) const;
+  double bdp( void ) const;
+  double pacing_gain( void ) const;
+
+  void update_bandwidth( const SendRecord & record, const uint64_t now );
+  void update_min_rtt( const uint64_t rtt, const uint64_t now );
+  void update_mode( const bool round_start, const uint64_t now );
+  void enter( const Mode mode, const uint64_t now );
+
+public:
+  BBRController( const bool debug, const ControllerParameters & parameters );
+
+  unsigned int timeout_ms( void ) override;
+  double send_rate( void ) override;
+};
+
+#endif
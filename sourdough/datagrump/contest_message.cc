@@ -1,4 +1,6 @@
 #include <stdexcept>
+#include <cstring>
+#include <limits>
 
 #include "contest_message.hh"
 #include "timestamp.hh"
@@ -6,32 +8,39 @@
 using namespace std;
 
 /* helper to get the nth uint64_t field (in network byte order) */
-uint64_t get_header_field( const size_t n, const string & str )
+uint64_t get_header_field( const size_t n, const char * const data, const size_t length )
 {
-  if ( str.size() < (n + 1) * sizeof( uint64_t ) ) {
+  if ( length < (n + 1) * sizeof( uint64_t ) ) {
     throw runtime_error( "contest message too small to contain header" );
   }
 
-  const uint64_t * const data_ptr
-    = reinterpret_cast<const uint64_t *>( str.data() ) + n;
+  uint64_t network_order;
+  memcpy( &network_order, data + n * sizeof( uint64_t ), sizeof( network_order ) );
 
-  return be64toh( *data_ptr );
+  return be64toh( network_order );
 }
 
+const size_t ContestMessage::Header::wire_length;
+
 /* Parse header from wire */
 ContestMessage::Header::Header( const string & str )
-  : sequence_number( get_header_field( 0, str ) ),
-    send_timestamp( get_header_field( 1, str ) ),
-    ack_sequence_number( get_header_field( 2, str ) ),
-    ack_send_timestamp( get_header_field( 3, str ) ),
-    ack_recv_timestamp( get_header_field( 4, str ) ),
-    ack_payload_length( get_header_field( 5, str ) )
+  : Header( str.data(), str.size() )
+{}
+
+/* Parse header from wire, reading in place */
+ContestMessage::Header::Header( const char * const data, const size_t length )
+  : sequence_number( get_header_field( 0, data, length ) ),
+    send_timestamp( get_header_field( 1, data, length ) ),
+    ack_sequence_number( get_header_field( 2, data, length ) ),
+    ack_send_timestamp( get_header_field( 3, data, length ) ),
+    ack_recv_timestamp( get_header_field( 4, data, length ) ),
+    ack_payload_length( get_header_field( 5, data, length ) )
 {}
 
 /* Parse incoming message from wire */
 ContestMessage::ContestMessage( const string & str )
   : header( str ),
-    payload( str.begin() + sizeof( header ), str.end() )
+    payload( str.begin() + Header::wire_length, str.end() )
 {}
 
 /* Fill in the send_timestamp for an outgoing message */
@@ -40,48 +49,65 @@ void ContestMessage::set_send_timestamp( void )
   header.send_timestamp = timestamp_ms();
 }
 
-/* helper to put a uint64_t field (in network byte order) */
-string put_header_field( const uint64_t n )
+/* helper to put the nth uint64_t field (in network byte order) */
+void put_header_field( const size_t n, const uint64_t value, char * const dest )
+{
+  const uint64_t network_order = htobe64( value );
+  memcpy( dest + n * sizeof( uint64_t ), &network_order, sizeof( network_order ) );
+}
+
+/* Write wire representation of header */
+void ContestMessage::Header::serialize( char * const dest ) const
 {
-  const uint64_t network_order = htobe64( n );
-  return string( reinterpret_cast<const char *>( &network_order ),
-		 sizeof( network_order ) );
+  put_header_field( 0, sequence_number, dest );
+  put_header_field( 1, send_timestamp, dest );
+  put_header_field( 2, ack_sequence_number, dest );
+  put_header_field( 3, ack_send_timestamp, dest );
+  put_header_field( 4, ack_recv_timestamp, dest );
+  put_header_field( 5, ack_payload_length, dest );
 }
 
 /* Make wire representation of header */
 string ContestMessage::Header::to_string( void ) const
 {
-  return put_header_field( sequence_number )
-    + put_header_field( send_timestamp )
-    + put_header_field( ack_sequence_number )
-    + put_header_field( ack_send_timestamp )
-    + put_header_field( ack_recv_timestamp )
-    + put_header_field( ack_payload_length );
+  string ret( wire_length, 0 );
+  serialize( &ret[ 0 ] );
+  return ret;
 }
 
 /* Make wire representation of message */
 string ContestMessage::to_string( void ) const
 {
-  return header.to_string() + payload;
+  string ret( Header::wire_length, 0 );
+  header.serialize( &ret[ 0 ] );
+  return ret + payload;
 }
 
 /* Transform into an ack of the ContestMessage */
 void ContestMessage::transform_into_ack( const uint64_t sequence_number,
 					 const uint64_t recv_timestamp )
+{
+  header.transform_into_ack( sequence_number, recv_timestamp, payload.length() );
+
+  /* delete the payload */
+  payload.clear();
+}
+
+/* Turn into the header of an ack of this message */
+void ContestMessage::Header::transform_into_ack( const uint64_t s_sequence_number,
+						 const uint64_t recv_timestamp,
+						 const uint64_t payload_length )
 {
   /* ack the old sequence number */
-  header.ack_sequence_number = header.sequence_number;
+  ack_sequence_number = sequence_number;
 
   /* now assign a new sequence number for the outgoing ack */
-  header.sequence_number = sequence_number;
+  sequence_number = s_sequence_number;
 
   /* ack the other fields */
-  header.ack_send_timestamp = header.send_timestamp;
-  header.ack_recv_timestamp = recv_timestamp;
-  header.ack_payload_length = payload.length();
-
-  /* delete the payload */
-  payload.clear();
+  ack_send_timestamp = send_timestamp;
+  ack_recv_timestamp = recv_timestamp;
+  ack_payload_length = payload_length;
 }
 
 /* New message */
@@ -106,3 +132,122 @@ bool ContestMessage::is_ack( void ) const
 {
   return header.ack_sequence_number != uint64_t( -1 );
 }
+
+/* Parse incoming datagram in place */
+ContestMessageView::ContestMessageView( const string & str )
+  : ContestMessageView( str.data(), str.size() )
+{}
+
+ContestMessageView::ContestMessageView( const char * const data, const size_t length )
+  : header( data, length ),
+    payload( data + ContestMessage::Header::wire_length ),
+    payload_length( length - ContestMessage::Header::wire_length )
+{}
+
+/* Is this message an ack? */
+bool ContestMessageView::is_ack( void ) const
+{
+  return header.ack_sequence_number != uint64_t( -1 );
+}
+
+/* helpers to get and put the nth 32-bit field of an ack block (in network byte order) */
+static uint32_t get_block_field( const size_t n, const char * const data, const size_t length )
+{
+  if ( length < (n + 1) * sizeof( uint32_t ) ) {
+    throw runtime_error( "ack block truncated" );
+  }
+
+  uint32_t network_order;
+  memcpy( &network_order, data + n * sizeof( uint32_t ), sizeof( network_order ) );
+
+  return be32toh( network_order );
+}
+
+static void put_block_field( const size_t n, const uint32_t value, char * const dest )
+{
+  const uint32_t network_order = htobe32( value );
+  memcpy( dest + n * sizeof( uint32_t ), &network_order, sizeof( network_order ) );
+}
+
+/* How many datagrams the ack acknowledges */
+size_t ContestMessageView::acked_count( void ) const
+{
+  if ( payload_length == 0 ) {
+    return 1;
+  }
+
+  const size_t earlier = get_block_field( 0, payload, payload_length );
+  if ( payload_length != ContestMessageBuffer::ack_block_count_length
+       + earlier * ContestMessageBuffer::ack_block_entry_length ) {
+    throw runtime_error( "ack block length does not match its count" );
+  }
+  return 1 + earlier;
+}
+
+/* The ith datagram acknowledged */
+AckedDatagram ContestMessageView::acked( const size_t i ) const
+{
+  const size_t earlier = acked_count() - 1;
+  if ( i > earlier ) {
+    throw runtime_error( "ack block has no entry " + to_string( i ) );
+  }
+
+  AckedDatagram ret { header.ack_sequence_number, header.ack_send_timestamp, header.ack_recv_timestamp };
+  if ( i < earlier ) {
+    const size_t field = 1 + 3 * i;
+    ret.sequence_number += int32_t( get_block_field( field, payload, payload_length ) );
+    ret.send_timestamp += int32_t( get_block_field( field + 1, payload, payload_length ) );
+    ret.recv_timestamp += int32_t( get_block_field( field + 2, payload, payload_length ) );
+  }
+  return ret;
+}
+
+const size_t ContestMessageBuffer::ack_block_count_length;
+const size_t ContestMessageBuffer::ack_block_entry_length;
+
+/* an ack block's offset of value from the header's */
+static uint32_t block_offset( const uint64_t value, const uint64_t base )
+{
+  const int64_t offset = value - base;
+  if ( offset < numeric_limits<int32_t>::min() or offset > numeric_limits<int32_t>::max() ) {
+    throw runtime_error( "ack block offset out of range" );
+  }
+  return uint32_t( int32_t( offset ) );
+}
+
+/* Datagram with the given (unchanging) payload */
+ContestMessageBuffer::ContestMessageBuffer( const string & payload )
+  : datagram_( string( ContestMessage::Header::wire_length, 0 ) + payload )
+{}
+
+/* Write the header in place and return the whole datagram */
+const string & ContestMessageBuffer::serialize( const ContestMessage::Header & header )
+{
+  header.serialize( &datagram_[ 0 ] );
+  return datagram_;
+}
+
+/* Write an aggregated ack in place and return it */
+const string & ContestMessageBuffer::serialize( const ContestMessage::Header & header,
+						const vector<AckedDatagram> & earlier )
+{
+  if ( earlier.empty() ) {
+    datagram_.resize( ContestMessage::Header::wire_length );
+    return serialize( header );
+  }
+
+  datagram_.resize( ContestMessage::Header::wire_length + ack_block_count_length
+		    + earlier.size() * ack_block_entry_length );
+  header.serialize( &datagram_[ 0 ] );
+
+  char * const block = &datagram_[ ContestMessage::Header::wire_length ];
+  put_block_field( 0, earlier.size(), block );
+  for ( size_t i = 0; i < earlier.size(); i++ ) {
+    const size_t field = 1 + 3 * i;
+    put_block_field( field, block_offset( earlier[ i ].sequence_number, header.ack_sequence_number ), block );
+    put_block_field( field + 1, block_offset( earlier[ i ].send_timestamp, header.ack_send_timestamp ), block );
+    put_block_field( field + 2, block_offset( earlier[ i ].recv_timestamp, header.ack_recv_timestamp ), block );
+  }
+
+  return datagram_;
+}
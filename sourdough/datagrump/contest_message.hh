@@ -2,8 +2,17 @@
 #define CONTEST_MESSAGE_HH
 
 #include <string>
+#include <vector>
 #include <cstdint>
 
+/* What an ack says about one datagram */
+struct AckedDatagram
+{
+  uint64_t sequence_number;
+  uint64_t send_timestamp; /* sender's clock */
+  uint64_t recv_timestamp; /* receiver's clock */
+};
+
 struct ContestMessage
 {
   struct Header {
@@ -21,8 +30,22 @@ struct ContestMessage
     /* Parse header from wire */
     Header( const std::string & str );
 
+    /* Parse header from wire, reading in place */
+    Header( const char * const data, const size_t length );
+
     /* Make wire representation of header */
     std::string to_string( void ) const;
+
+    /* Length of the wire representation */
+    static const size_t wire_length = 6 * sizeof( uint64_t );
+
+    /* Write wire representation into dest (wire_length bytes) */
+    void serialize( char * const dest ) const;
+
+    /* Turn into the header of an ack of this message */
+    void transform_into_ack( const uint64_t sequence_number,
+			     const uint64_t recv_timestamp,
+			     const uint64_t payload_length );
   } header;
 
   std::string payload;
@@ -48,4 +71,55 @@ struct ContestMessage
   bool is_ack( void ) const;
 };
 
+/* Incoming datagram, read in place: the header is parsed,
+   but the payload is only pointed to, not copied */
+struct ContestMessageView
+{
+  ContestMessage::Header header;
+
+  const char * payload;
+  size_t payload_length;
+
+  /* Parse incoming datagram (which must outlive the view) */
+  ContestMessageView( const std::string & str );
+  ContestMessageView( const char * const data, const size_t length );
+
+  /* Is this message an ack? */
+  bool is_ack( void ) const;
+
+  /* How many datagrams an ack acknowledges: the one in its header,
+     and any more in an ack block after it (see ContestMessageBuffer) */
+  size_t acked_count( void ) const;
+
+  /* Each of them, in the order the receiver got them (the header's last) */
+  AckedDatagram acked( const size_t i ) const;
+};
+
+/* Reusable outgoing datagram: the payload is written once, and
+   each message only rewrites the header in front of it */
+class ContestMessageBuffer
+{
+private:
+  std::string datagram_;
+
+public:
+  /* Datagram with the given (unchanging) payload */
+  ContestMessageBuffer( const std::string & payload );
+
+  /* Write the header in place and return the whole datagram */
+  const std::string & serialize( const ContestMessage::Header & header );
+
+  /* An aggregated ack: the header (acking the newest datagram) and,
+     in place of the payload, an ack block for the earlier ones: their
+     count (a uint32_t), then for each, its sequence number, send
+     timestamp and receive timestamp as int32_t offsets from the
+     header's. Offsets out of range throw. */
+  const std::string & serialize( const ContestMessage::Header & header,
+				 const std::vector<AckedDatagram> & earlier );
+
+  /* The wire lengths of an ack block's count and of each entry in it */
+  static const size_t ack_block_count_length = sizeof( uint32_t );
+  static const size_t ack_block_entry_length = 3 * sizeof( int32_t );
+};
+
 #endif /* CONTEST_MESSAGE_HH */
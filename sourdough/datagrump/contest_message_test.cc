@@ -0,0 +1,174 @@
+/* checks aggregated acks: that ContestMessageBuffer's ack block (with
+   0, 1 and 32 entries, and offsets either side of the header's) reads
+   back the same through ContestMessageView, that a truncated block or
+   one whose length doesn't match its count is rejected, and that
+   offsets too large for the block, or entries past its end, throw */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <limits>
+#include <stdexcept>
+#include <functional>
+
+#include "contest_message.hh"
+#include "util.hh"
+
+using namespace std;
+
+static void check( const bool condition, const string & problem )
+{
+  if ( not condition ) {
+    throw runtime_error( "contest-message-test: " + problem );
+  }
+}
+
+/* does the action throw? */
+static bool throws( const function<void( void )> & action )
+{
+  try {
+    action();
+  } catch ( const runtime_error & ) {
+    return true;
+  }
+  return false;
+}
+
+static bool operator==( const AckedDatagram & a, const AckedDatagram & b )
+{
+  return a.sequence_number == b.sequence_number and a.send_timestamp == b.send_timestamp
+    and a.recv_timestamp == b.recv_timestamp;
+}
+
+/* the header of an ack of a datagram far enough from zero for any offset */
+static ContestMessage::Header ack_header( void )
+{
+  ContestMessage::Header header( 10000000000 );
+  header.send_timestamp = 50000000000;
+  header.transform_into_ack( 17, 70000000000, 1424 );
+  header.send_timestamp = 70000000001;
+  return header;
+}
+
+/* earlier datagrams, some before the header's and some after (the
+   receiver got them in any order), out to the edges of an int32_t */
+static vector<AckedDatagram> earlier_datagrams( const size_t count )
+{
+  const ContestMessage::Header header = ack_header();
+  const int64_t edge[] = { numeric_limits<int32_t>::min(), numeric_limits<int32_t>::max() };
+
+  vector<AckedDatagram> ret;
+  for ( size_t i = 0; i < count; i++ ) {
+    int64_t offset = ( i % 2 ? 1 : -1 ) * int64_t( i + 1 );
+    if ( i == 2 or i == 3 ) {
+      offset = edge[ i - 2 ];
+    }
+    ret.push_back( { header.ack_sequence_number + offset,
+		     header.ack_send_timestamp - offset / 2,
+		     header.ack_recv_timestamp + offset } );
+  }
+  return ret;
+}
+
+static void check_round_trip( const size_t count )
+{
+  const ContestMessage::Header header = ack_header();
+  const vector<AckedDatagram> earlier = earlier_datagrams( count );
+
+  ContestMessageBuffer buffer( "" );
+  const string datagram = buffer.serialize( header, earlier );
+  check( datagram.size() == ContestMessage::Header::wire_length
+	 + ( count ? ContestMessageBuffer::ack_block_count_length
+	     + count * ContestMessageBuffer::ack_block_entry_length : 0 ),
+	 to_string( count ) + " entries: wrong datagram length" );
+
+  const ContestMessageView view( datagram );
+  check( view.is_ack(), to_string( count ) + " entries: not an ack" );
+  check( view.header.sequence_number == header.sequence_number
+	 and view.header.send_timestamp == header.send_timestamp,
+	 to_string( count ) + " entries: header changed" );
+  check( view.acked_count() == count + 1, to_string( count ) + " entries: wrong acked_count()" );
+
+  for ( size_t i = 0; i < count; i++ ) {
+    check( view.acked( i ) == earlier[ i ], to_string( count ) + " entries: entry " + to_string( i ) + " changed" );
+  }
+
+  /* the header's datagram comes last */
+  const AckedDatagram newest { header.ack_sequence_number, header.ack_send_timestamp, header.ack_recv_timestamp };
+  check( view.acked( count ) == newest, to_string( count ) + " entries: header's datagram changed" );
+
+  check( throws( [&] () { view.acked( count + 1 ); } ),
+	 to_string( count ) + " entries: an entry past the end was read" );
+
+  cout << "contest-message-test: round trip of " << count << " entries OK" << endl;
+}
+
+/* a datagram the view must reject */
+static void check_rejected( const string & name, const string & datagram )
+{
+  check( throws( [&] () {
+	const ContestMessageView view( datagram );
+	for ( size_t i = 0; i < view.acked_count(); i++ ) {
+	  view.acked( i );
+	}
+      } ), name + " was accepted" );
+
+  cout << "contest-message-test: " << name << " rejected OK" << endl;
+}
+
+int main( void )
+{
+  try {
+    for ( const size_t count : { 0, 1, 32 } ) {
+      check_round_trip( count );
+    }
+
+    /* a reused buffer drops the entries a shorter ack doesn't have */
+    ContestMessageBuffer buffer( "" );
+    buffer.serialize( ack_header(), earlier_datagrams( 32 ) );
+    check( ContestMessageView( buffer.serialize( ack_header(), earlier_datagrams( 1 ) ) ).acked_count() == 2,
+	   "a shorter ack kept the longer one's block" );
+    check( ContestMessageView( buffer.serialize( ack_header(), {} ) ).acked_count() == 1,
+	   "an ack of one datagram kept an ack block" );
+
+    const string good = ContestMessageBuffer( "" ).serialize( ack_header(), earlier_datagrams( 3 ) );
+
+    check_rejected( "a datagram shorter than a header", good.substr( 0, ContestMessage::Header::wire_length - 1 ) );
+    check_rejected( "a block too short for its count",
+		    good.substr( 0, ContestMessage::Header::wire_length + ContestMessageBuffer::ack_block_count_length - 1 ) );
+    check_rejected( "a block missing an entry", good.substr( 0, good.size() - ContestMessageBuffer::ack_block_entry_length ) );
+    check_rejected( "a block missing part of an entry", good.substr( 0, good.size() - 1 ) );
+    check_rejected( "a block with an extra entry", good + string( ContestMessageBuffer::ack_block_entry_length, 0 ) );
+
+    /* a count that would run past the end (and far past, if it wrapped) */
+    string huge_count = good;
+    huge_count.replace( ContestMessage::Header::wire_length, ContestMessageBuffer::ack_block_count_length,
+			string( ContestMessageBuffer::ack_block_count_length, char( 0xff ) ) );
+    check_rejected( "a block with a count of 2^32 - 1", huge_count );
+
+    /* offsets one past the range of an int32_t, in each field and either direction */
+    const ContestMessage::Header header = ack_header();
+    const int64_t too_far[] = { int64_t( numeric_limits<int32_t>::min() ) - 1,
+				int64_t( numeric_limits<int32_t>::max() ) + 1 };
+    for ( const int64_t offset : too_far ) {
+      for ( unsigned int field = 0; field < 3; field++ ) {
+	vector<AckedDatagram> earlier = earlier_datagrams( 2 );
+	uint64_t & value = field == 0 ? earlier[ 1 ].sequence_number
+	  : field == 1 ? earlier[ 1 ].send_timestamp : earlier[ 1 ].recv_timestamp;
+	const uint64_t base = field == 0 ? header.ack_sequence_number
+	  : field == 1 ? header.ack_send_timestamp : header.ack_recv_timestamp;
+	value = base + offset;
+
+	check( throws( [&] () { ContestMessageBuffer( "" ).serialize( header, earlier ); } ),
+	       "offset " + to_string( offset ) + " in field " + to_string( field ) + " was accepted" );
+      }
+    }
+    cout << "contest-message-test: out-of-range offsets rejected OK" << endl;
+  } catch ( const exception & e ) {
+    print_exception( e );
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
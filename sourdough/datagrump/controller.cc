@@ -1,52 +1,125 @@
-#include <iostream> 
-#include <math.h>
-#include <vector>
-#include <cmath>
-#include <algorithm>
 #include <iostream>
-#include <numeric>
+#include <sstream>
+#include <stdexcept>
 
 #include "controller.hh"
+#include "aimd_controller.hh"
+#include "bbr_controller.hh"
+#include "copa_controller.hh"
+#include "sprout_controller.hh"
 #include "timestamp.hh"
 
 using namespace std;
 
-const unsigned int DEFAULT_WIN = 32;		// default cwnd size
-const uint64_t MAX_DELAY = 100;		// maximum desired latency
-const int PREDICTION_SIZE = 4;			// number of recent ACKs to track for prediction of next RTT
+/* Parse and set "NAME=VALUE" (throws if it is not one) */
+void ControllerParameters::set( const string & assignment )
+{
+  const size_t equals = assignment.find( '=' );
+  if ( equals == string::npos or equals == 0 ) {
+    throw runtime_error( "parameter \"" + assignment + "\" is not NAME=VALUE" );
+  }
+
+  const string value = assignment.substr( equals + 1 );
+  size_t end = 0;
+  double number = 0;
+  try {
+    number = stod( value, &end );
+  } catch ( const exception & ) {
+    end = 0;
+  }
+  if ( value.empty() or end != value.size() ) {
+    throw runtime_error( "parameter \"" + assignment + "\" does not have a numeric value" );
+  }
+
+  values_[ assignment.substr( 0, equals ) ] = number;
+}
+
+double ControllerParameters::get( const string & name, const double default_value ) const
+{
+  read_.insert( name );
+
+  const auto value = values_.find( name );
+  return value == values_.end() ? default_value : value->second;
+}
+
+/* Names that were set but never read */
+vector<string> ControllerParameters::unread( void ) const
+{
+  vector<string> names;
+  for ( const auto & value : values_ ) {
+    if ( not read_.count( value.first ) ) {
+      names.push_back( value.first );
+    }
+  }
+  return names;
+}
+
+/* "NAME=VALUE ..." (or "-" if none) */
+string ControllerParameters::to_string( void ) const
+{
+  if ( values_.empty() ) {
+    return "-";
+  }
+
+  ostringstream output;
+  for ( const auto & value : values_ ) {
+    output << ( output.tellp() ? " " : "" ) << value.first << "=" << value.second;
+  }
+  return output.str();
+}
+
+/* how long a minimum of the one-way delay holds */
+const uint64_t ONE_WAY_DELAY_WINDOW = 10000;	// ms
+
+OneWayDelay::OneWayDelay( const uint64_t window_ms )
+  : window_( window_ms ), minima_(), latest_( 0 )
+{}
+
+/* A datagram's send and receive times, by each end's clock */
+void OneWayDelay::add( const uint64_t send_timestamp, const uint64_t recv_timestamp, const uint64_t now )
+{
+  latest_ = recv_timestamp - send_timestamp;
+
+  while ( not minima_.empty() and minima_.back().delay >= latest_ ) {
+    minima_.pop_back();
+  }
+  minima_.push_back( { now, latest_ } );
+
+  while ( minima_.front().time + window_ < now ) {
+    minima_.pop_front();
+  }
+}
 
 /* Default constructor */
 Controller::Controller( const bool debug )
-  : debug_( debug ), window_size_( DEFAULT_WIN ), silly_window_( DEFAULT_WIN ),
-    rtt_min_( MAX_DELAY ), prev_rtt_( 0 ), last_seq_sent_( 0 ), flight_counter_( 0 ),
-    timestamp_prev_ack_received_( 0 ), ack_counter_( 0 ), ACK_times_(PREDICTION_SIZE), 
-    ACK_RTTs_(PREDICTION_SIZE)
+  : debug_( debug ), one_way_delay_( ONE_WAY_DELAY_WINDOW )
 {}
 
 /* Get current window size, in datagrams */
 unsigned int Controller::window_size( void )
 {
+  const unsigned int window = current_window();
+
   if ( debug_ ) {
     cerr << "At time " << timestamp_ms()
-	 << " window size is " << window_size_ << endl;
+	 << " window size is " << window << endl;
   }
 
-  return window_size_;
+  return window;
 }
 
 /* A datagram was sent */
 void Controller::datagram_was_sent( const uint64_t sequence_number,
 				    /* of the sent datagram */
 				    const uint64_t send_timestamp )
-                                    /* in milliseconds */
+				    /* in milliseconds */
 {
-  /* Default: take no action */
-  last_seq_sent_ = sequence_number;
-
   if ( debug_ ) {
     cerr << "At time " << send_timestamp
 	 << " sent datagram " << sequence_number << endl;
   }
+
+  record_sent( sequence_number, send_timestamp );
 }
 
 /* An ack was received */
@@ -57,96 +130,62 @@ void Controller::ack_received( const uint64_t sequence_number_acked,
 			       const uint64_t recv_timestamp_acked,
 			       /* when the acknowledged datagram was received (receiver's clock)*/
 			       const uint64_t timestamp_ack_received )
-                               /* when the ack was received (by sender) */
-{ 
-  uint64_t rtt = timestamp_ack_received - send_timestamp_acked;
-  timestamp_prev_ack_received_ = timestamp_ack_received; 
-  ack_counter_++;
-  
-  // update rtt_min_ 
-  if (rtt < rtt_min_) {
-    rtt_min_ = rtt;
-  }
+			       /* when the ack was received (by sender) */
+{
+  one_way_delay_.add( send_timestamp_acked, recv_timestamp_acked, timestamp_ack_received );
+
   if ( debug_ ) {
     cerr << "At time " << timestamp_ack_received
-   << " received ack for datagram " << sequence_number_acked
-   << " (send @ time " << send_timestamp_acked
-   << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
-   << "RTT is " << rtt << " RTTmin is " << rtt_min_
-   << endl;
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << " RTT is " << timestamp_ack_received - send_timestamp_acked
+	 << ", one-way queueing delay " << one_way_delay_.queueing_delay()
+	 << endl;
   }
-  
-  ACK_times_[ack_counter_ % PREDICTION_SIZE] = timestamp_ack_received;
-  ACK_RTTs_[ack_counter_ % PREDICTION_SIZE] = rtt;
-  
-  bool predicted = false;
-  if(ack_counter_ > PREDICTION_SIZE){ 
-    /* do not double count acks received at the same time */
-    if(timestamp_ack_received == timestamp_prev_ack_received_){
-      ack_counter_--;
-    } else {
-      rtt = predicted_RTT(timestamp_ack_received);
-      predicted = true;
-    }
-  }
-  update_window (rtt, sequence_number_acked, predicted);
-  prev_rtt_ = rtt;
+
+  record_ack( sequence_number_acked, send_timestamp_acked,
+	      recv_timestamp_acked, timestamp_ack_received );
 }
 
-/* Update window size based on new RTT sample */
-void Controller::update_window( uint64_t rtt, uint64_t sequence_number_acked, bool predicted) 
+/* The registry of algorithms, the first being the default */
+const vector<Controller::Algorithm> & Controller::algorithms( void )
 {
-  if (rtt > timeout_ms()) {
-    if ( flight_counter_ == 0 ) { /*  only decrease window size once per group of datagrams */
-      float resize_factor = (rtt-(timeout_ms()/2.0))/(timeout_ms()/2.0);
-      if (predicted) {
-        /* decrease window less aggressively if using a prediction */
-        window_size_ = ceil(window_size_/2.0);
-      } else {
-        window_size_ = ceil(window_size_/(resize_factor));
-      }
-      silly_window_ = window_size_;
-      flight_counter_ = last_seq_sent_ - sequence_number_acked; 
-    } else { flight_counter_--; }
-  } else {
-    float scale_factor = 1.0;
-    if (rtt < prev_rtt_) {
-      /* increase window more aggressively if RTT is trending downwards */
-      scale_factor = 2*((prev_rtt_ - rtt)/float(prev_rtt_) + 1);
-    } 
-    silly_window_ = silly_window_ + (scale_factor*1.5)/(float(window_size_));
-    window_size_ = floor(silly_window_);
-  }
+  static const vector<Algorithm> registry = {
+    { "aimd", "delay-threshold AIMD with a linear-regression RTT predictor",
+      [] ( const bool debug, const ControllerParameters & parameters ) {
+	return unique_ptr<Controller>( new AIMDController( debug, parameters ) ); } },
+    { "bbr", "BBR-style bottleneck bandwidth and min-RTT model",
+      [] ( const bool debug, const ControllerParameters & parameters ) {
+	return unique_ptr<Controller>( new BBRController( debug, parameters ) ); } },
+    { "copa", "Copa/Vegas-style delay-based control toward a target queueing delay",
+      [] ( const bool debug, const ControllerParameters & parameters ) {
+	return unique_ptr<Controller>( new CopaController( debug, parameters ) ); } },
+    { "sprout", "Sprout-style stochastic forecast of the link's delivery rate",
+      [] ( const bool debug, const ControllerParameters & parameters ) {
+	return unique_ptr<Controller>( new SproutController( debug, parameters ) ); } },
+  };
+
+  return registry;
 }
 
-/* Fit regression line of most recent ACK time+rtt pairs to predict next RTT 
-   credit for the finding the slope of the regression goes to the following post: 
-   http://stackoverflow.com/a/19039500 */
-uint64_t Controller::predicted_RTT(uint64_t time)
+/* Construct the named algorithm (throws if there is none,
+   or if it has no use for one of the parameters) */
+unique_ptr<Controller> Controller::make( const string & name, const bool debug,
+					 const ControllerParameters & parameters )
 {
-  int n = ACK_times_.size();
-  double s_x = accumulate(ACK_times_.begin(), ACK_times_.end(), 0.0);
-  double s_y = accumulate(ACK_RTTs_.begin(), ACK_RTTs_.end(), 0.0);
-  double s_xx = inner_product(ACK_times_.begin(), ACK_times_.end(), ACK_times_.begin(), 0.0);
-  double s_xy =  inner_product(ACK_times_.begin(), ACK_times_.end(), ACK_RTTs_.begin(), 0.0);
-  double slope = (n*s_xy - s_x*s_y)/(n*s_xx - s_x*s_x);
-
-  double intercept = double(s_y/n) - slope*double(s_x/n);
-  uint64_t predicted_time_to_next_ack = time - timestamp_prev_ack_received_;
-  
-  double pred_rtt = ceil(slope*(double(time) + double(predicted_time_to_next_ack)) + intercept);
-  
-  /* we don't want to predict something more optimistic than what's possible */
-  if(pred_rtt >= rtt_min_) {
-    return uint64_t(pred_rtt);
-  } else {
-    return rtt_min_;
+  for ( const auto & algorithm : algorithms() ) {
+    if ( algorithm.name == name ) {
+      auto controller = algorithm.make( debug, parameters );
+
+      const auto unread = parameters.unread();
+      if ( not unread.empty() ) {
+	throw runtime_error( name + " has no parameter named " + unread.front() );
+      }
+
+      return controller;
+    }
   }
-}
 
-/* How long to wait (in milliseconds) if there are no acks
-   before sending one more datagram */
-unsigned int Controller::timeout_ms( void )
-{
-  return min(2*rtt_min_, MAX_DELAY);
+  throw runtime_error( "unknown congestion-control algorithm: " + name );
 }
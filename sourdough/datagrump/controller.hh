@@ -2,40 +2,103 @@
 #define CONTROLLER_HH
 
 #include <cstdint>
+#include <string>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <map>
+#include <set>
+#include <deque>
+
+/* Tunables given at run time as NAME=VALUE; each algorithm
+   reads the ones it knows, falling back on its own defaults */
+
+class ControllerParameters
+{
+private:
+  std::map<std::string, double> values_;
+  mutable std::set<std::string> read_;
+
+public:
+  ControllerParameters() : values_(), read_() {}
+
+  /* Parse and set "NAME=VALUE" (throws if it is not one) */
+  void set( const std::string & assignment );
+
+  double get( const std::string & name, const double default_value ) const;
+
+  /* Names that were set but never read */
+  std::vector<std::string> unread( void ) const;
+
+  /* "NAME=VALUE ..." (or "-" if none) */
+  std::string to_string( void ) const;
+};
+
+/* One-way (forward) delay, from the receiver's timestamps. A sample,
+   receive time less send time, spans the two clocks and so includes
+   their offset; the least sample over a window is that offset plus
+   the propagation delay, and what a sample is above it is queueing on
+   the way to the receiver, however long the ack then took to return.
+   (The window lets the minimum follow a slow drift between clocks.) */
+
+class OneWayDelay
+{
+private:
+  struct Sample
+  {
+    uint64_t time; /* sender's clock */
+    int64_t delay;
+  };
+
+  uint64_t window_;
+  std::deque<Sample> minima_; /* increasing, the least at the front */
+  int64_t latest_;
+
+public:
+  OneWayDelay( const uint64_t window_ms );
+
+  void add( const uint64_t send_timestamp, const uint64_t recv_timestamp, const uint64_t now );
+
+  bool empty( void ) const { return minima_.empty(); }
+
+  /* ms the most recent datagram queued on the way (0 if none yet) */
+  uint64_t queueing_delay( void ) const { return empty() ? 0 : latest_ - minima_.front().delay; }
+};
 
 /* Congestion controller interface */
 
+/* Each algorithm derives from Controller and is listed in the registry
+   (Controller::algorithms(), in controller.cc) under the name the
+   sender's command line selects it by. */
+
 class Controller
 {
 private:
   bool debug_; /* Enables debugging output */
+  OneWayDelay one_way_delay_;
 
-  /* Add member variables here */
+  /* The algorithm's side of the interface below */
+  virtual unsigned int current_window( void ) = 0;
+  virtual void record_sent( const uint64_t sequence_number,
+			    const uint64_t send_timestamp ) = 0;
+  virtual void record_ack( const uint64_t sequence_number_acked,
+			   const uint64_t send_timestamp_acked,
+			   const uint64_t recv_timestamp_acked,
+			   const uint64_t timestamp_ack_received ) = 0;
 
-  /* Involved in window adjustment */
-  unsigned int window_size_;
-  float silly_window_;
-  uint64_t rtt_min_;
-  uint64_t prev_rtt_;
+protected:
+  bool debug( void ) const { return debug_; }
 
-  /* Involved in tracking data in flight */
-  uint64_t last_seq_sent_;
-  uint64_t flight_counter_;
-  uint64_t timestamp_prev_ack_received_;
-  
-  /* Involved in predicting next RTT */
-  int ack_counter_;
-  std::vector<double> ACK_times_; 
-  std::vector<double> ACK_RTTs_;
+  /* kept up to date before each record_ack() */
+  const OneWayDelay & one_way_delay( void ) const { return one_way_delay_; }
 
 public:
   /* Public interface for the congestion controller */
   /* You can change these if you prefer, but will need to change
      the call site as well (in sender.cc) */
 
-  /* Default constructor */
   Controller( const bool debug );
+  virtual ~Controller() {}
 
   /* Get current window size, in datagrams */
   unsigned int window_size( void );
@@ -50,16 +113,31 @@ public:
 		     const uint64_t recv_timestamp_acked,
 		     const uint64_t timestamp_ack_received );
 
-  /* Predict the upcoming RTT based on recent ACKs */
-  uint64_t predicted_RTT(uint64_t time);
-
   /* How long to wait (in milliseconds) if there are no acks
      before sending one more datagram */
-  unsigned int timeout_ms( void );
-  
-  /* Update window size based on new RTT sample */
-  void update_window( uint64_t rtt, uint64_t sequence_number_acked, bool predicted);
+  virtual unsigned int timeout_ms( void ) = 0;
+
+  /* Target sending rate, in datagrams per second, for a sender
+     that paces its datagrams (0: send whenever the window is open) */
+  virtual double send_rate( void ) = 0;
+
+  /* The registry of algorithms, the first being the default */
+  struct Algorithm
+  {
+    std::string name;
+    std::string description;
+    std::function<std::unique_ptr<Controller>( const bool debug,
+					       const ControllerParameters & parameters )> make;
+  };
+
+  static const std::vector<Algorithm> & algorithms( void );
 
+  /* Construct the named algorithm (throws if there is none,
+     or if it has no use for one of the parameters) */
+  static std::unique_ptr<Controller> make( const std::string & name,
+					   const bool debug,
+					   const ControllerParameters & parameters
+					   = ControllerParameters() );
 };
 
 #endif
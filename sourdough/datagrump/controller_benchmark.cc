@@ -0,0 +1,173 @@
+/* CPU time of each congestion-control algorithm's callbacks on the
+   sender's ack path, driven by a simulated link (a queue whose rate
+   swings between 0.2 and 2 datagrams/ms, behind a 40 ms round trip) */
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+
+#include "controller.hh"
+
+using namespace std;
+
+static const uint64_t SIMULATED_MS = 60000;
+static const uint64_t PROPAGATION_RTT = 40;
+static const size_t QUEUE_LIMIT = 1000; /* datagrams; the rest are dropped */
+
+/* sum of the results, so the calls can't be optimized away */
+static double checksum = 0;
+
+/* the duration of each call, in ns */
+class CallTimes
+{
+private:
+  vector<uint64_t> samples_;
+
+public:
+  CallTimes() : samples_() {}
+
+  void record( const chrono::steady_clock::time_point & start )
+  {
+    samples_.push_back( chrono::duration_cast<chrono::nanoseconds>(
+			  chrono::steady_clock::now() - start ).count() );
+  }
+
+  size_t calls( void ) const { return samples_.size(); }
+
+  /* the given quantile, less the timer's own cost */
+  double quantile( const double q, const double overhead )
+  {
+    if ( samples_.empty() ) {
+      return 0;
+    }
+    auto nth = samples_.begin() + min( samples_.size() - 1, size_t( q * samples_.size() ) );
+    nth_element( samples_.begin(), nth, samples_.end() );
+    return max( 0.0, *nth - overhead );
+  }
+
+  double mean( const double overhead ) const
+  {
+    if ( samples_.empty() ) {
+      return 0;
+    }
+    double total = 0;
+    for ( const auto sample : samples_ ) {
+      total += sample;
+    }
+    return max( 0.0, total / samples_.size() - overhead );
+  }
+};
+
+struct Callbacks
+{
+  CallTimes window_size, datagram_was_sent, ack_received, send_rate, timeout_ms;
+
+  Callbacks()
+    : window_size(), datagram_was_sent(), ack_received(), send_rate(), timeout_ms()
+  {}
+};
+
+static void simulate( Controller & controller, Callbacks & times )
+{
+  struct Datagram { uint64_t sequence_number, send_time, delivery_time; };
+  deque<Datagram> queue, acks;
+
+  uint64_t sequence_number = 0, next_ack_expected = 0;
+  double link_credit = 0;
+
+  for ( uint64_t now = 1; now <= SIMULATED_MS; now++ ) {
+    /* the link drains the queue; acks come back a round trip later */
+    link_credit += 1.1 + 0.9 * sin( 2 * M_PI * now / 5000.0 );
+    while ( link_credit >= 1 and not queue.empty() ) {
+      link_credit -= 1;
+      queue.front().delivery_time = now;
+      acks.push_back( queue.front() );
+      queue.pop_front();
+    }
+    link_credit = queue.empty() ? min( link_credit, 1.0 ) : link_credit;
+
+    while ( not acks.empty() and acks.front().delivery_time + PROPAGATION_RTT <= now ) {
+      const Datagram & ack = acks.front();
+      next_ack_expected = max( next_ack_expected, ack.sequence_number + 1 );
+
+      auto start = chrono::steady_clock::now();
+      controller.ack_received( ack.sequence_number, ack.send_time, ack.delivery_time, now );
+      times.ack_received.record( start );
+
+      acks.pop_front();
+    }
+
+    /* the sender fills the window */
+    while ( true ) {
+      auto start = chrono::steady_clock::now();
+      const unsigned int window = controller.window_size();
+      times.window_size.record( start );
+
+      if ( sequence_number - next_ack_expected >= window ) {
+	break;
+      }
+
+      start = chrono::steady_clock::now();
+      controller.datagram_was_sent( sequence_number, now );
+      times.datagram_was_sent.record( start );
+
+      start = chrono::steady_clock::now();
+      checksum += controller.send_rate();
+      times.send_rate.record( start );
+
+      if ( queue.size() < QUEUE_LIMIT ) {
+	queue.push_back( { sequence_number, now, 0 } );
+      }
+      sequence_number++;
+    }
+
+    auto start = chrono::steady_clock::now();
+    checksum += controller.timeout_ms();
+    times.timeout_ms.record( start );
+  }
+}
+
+static void report_line( const string & name, CallTimes & times, const double overhead )
+{
+  cout << "  " << left << setw( 20 ) << name << right << fixed << setprecision( 0 )
+       << setw( 10 ) << times.calls()
+       << setw( 10 ) << times.mean( overhead )
+       << setw( 10 ) << times.quantile( 0.5, overhead )
+       << setw( 10 ) << times.quantile( 0.99, overhead )
+       << setw( 10 ) << times.quantile( 1, overhead ) << endl;
+}
+
+int main( void )
+{
+  /* what timing an empty call costs */
+  CallTimes empty;
+  for ( unsigned int i = 0; i < 1000000; i++ ) {
+    empty.record( chrono::steady_clock::now() );
+  }
+  const double overhead = empty.quantile( 0.5, 0 );
+
+  cout << "ns per call, less " << overhead << " ns of timer overhead" << endl;
+
+  for ( const auto & algorithm : Controller::algorithms() ) {
+    const auto controller = algorithm.make( false, ControllerParameters() );
+    Callbacks times;
+    simulate( *controller, times );
+
+    cout << endl << algorithm.name << ": " << algorithm.description << endl;
+    cout << "  " << left << setw( 20 ) << "callback" << right << setw( 10 ) << "calls"
+	 << setw( 10 ) << "mean" << setw( 10 ) << "median" << setw( 10 ) << "p99"
+	 << setw( 10 ) << "max" << endl;
+    report_line( "ack_received", times.ack_received, overhead );
+    report_line( "window_size", times.window_size, overhead );
+    report_line( "datagram_was_sent", times.datagram_was_sent, overhead );
+    report_line( "send_rate", times.send_rate, overhead );
+    report_line( "timeout_ms", times.timeout_ms, overhead );
+  }
+
+  return checksum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
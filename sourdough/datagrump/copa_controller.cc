@@ -0,0 +1,134 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "copa_controller.hh"
+
+using namespace std;
+
+const double INITIAL_WIN = 10;			// default cwnd size
+const double MIN_WIN = 2;
+const double DELTA = 0.5;			// weight of delay against throughput (smaller: more throughput)
+const double RTT_GAIN = 1.0 / 8;		// weight of a new sample in the smoothed RTT
+const unsigned int VELOCITY_ROUNDS = 3;		// round trips in one direction before the velocity doubles
+const double MAX_VELOCITY = 1 << 10;
+const double PACING_GAIN = 2.0;			// pace at twice window/RTT, as Copa does
+const uint64_t MIN_RTT_WINDOW = 10000;		// ms a min RTT sample stays valid
+const uint64_t MIN_TIMEOUT = 100;		// ms
+
+/* Default constructor */
+CopaController::CopaController( const bool debug, const ControllerParameters & )
+  : Controller( debug ), window_( INITIAL_WIN ), slow_start_( true ),
+    smoothed_rtt_( 0 ), min_rtt_( 0 ), min_rtt_stamp_( 0 ), recent_rtts_(),
+    velocity_( 1 ), direction_( 1 ), direction_rounds_( 0 ),
+    round_start_window_( INITIAL_WIN ), round_start_time_( 0 )
+{}
+
+/* Get current window size, in datagrams */
+unsigned int CopaController::current_window( void )
+{
+  return static_cast<unsigned int>( window_ );
+}
+
+/* A datagram was sent */
+void CopaController::record_sent( const uint64_t, const uint64_t )
+{}
+
+/* The least RTT over the last half smoothed RTT, after adding this sample */
+uint64_t CopaController::standing_rtt( const uint64_t rtt, const uint64_t now )
+{
+  while ( not recent_rtts_.empty() and recent_rtts_.back().rtt >= rtt ) {
+    recent_rtts_.pop_back();
+  }
+  recent_rtts_.push_back( { now, rtt } );
+
+  const double window = smoothed_rtt_ / 2;
+  while ( recent_rtts_.front().time + window < now ) {
+    recent_rtts_.pop_front();
+  }
+
+  return recent_rtts_.front().rtt;
+}
+
+/* An ack was received */
+void CopaController::record_ack( const uint64_t,
+				 const uint64_t send_timestamp_acked,
+				 const uint64_t,
+				 const uint64_t timestamp_ack_received )
+{
+  const uint64_t now = timestamp_ack_received;
+  const uint64_t rtt = max( now - send_timestamp_acked, uint64_t( 1 ) );
+
+  smoothed_rtt_ = smoothed_rtt_ == 0 ? rtt : ( 1 - RTT_GAIN ) * smoothed_rtt_ + RTT_GAIN * rtt;
+
+  if ( min_rtt_ == 0 or rtt <= min_rtt_ or now > min_rtt_stamp_ + MIN_RTT_WINDOW ) {
+    min_rtt_ = rtt;
+    min_rtt_stamp_ = now;
+  }
+
+  const uint64_t standing = standing_rtt( rtt, now );
+  const uint64_t queueing_delay = standing - min( standing, min_rtt_ );
+
+  /* datagrams per ms: the current rate against the target for this queueing delay */
+  const double current_rate = window_ / standing;
+  const bool below_target = queueing_delay == 0 or current_rate <= 1 / ( DELTA * queueing_delay );
+
+  if ( slow_start_ ) {
+    if ( below_target ) {
+      window_ += 1; /* doubles each round trip */
+      return;
+    }
+    slow_start_ = false;
+    round_start_time_ = now;
+    round_start_window_ = window_;
+  }
+
+  update_velocity( now );
+
+  const double step = velocity_ / ( DELTA * window_ );
+  window_ = max( MIN_WIN, below_target ? window_ + step : window_ - step );
+}
+
+/* Once a round trip, double the velocity if the window has kept going the same way */
+void CopaController::update_velocity( const uint64_t now )
+{
+  if ( now < round_start_time_ + smoothed_rtt_ ) {
+    return;
+  }
+
+  const int direction = window_ > round_start_window_ ? 1 : -1;
+  if ( direction == direction_ ) {
+    if ( ++direction_rounds_ >= VELOCITY_ROUNDS ) {
+      velocity_ = min( 2 * velocity_, MAX_VELOCITY );
+    }
+  } else {
+    direction_ = direction;
+    direction_rounds_ = 0;
+    velocity_ = 1;
+  }
+
+  if ( debug() ) {
+    cerr << "At time " << now << " window " << window_ << " velocity " << velocity_
+	 << " (RTT min " << min_rtt_ << " ms, smoothed " << smoothed_rtt_ << " ms)" << endl;
+  }
+
+  round_start_time_ = now;
+  round_start_window_ = window_;
+}
+
+/* How long to wait (in milliseconds) if there are no acks
+   before sending one more datagram */
+unsigned int CopaController::timeout_ms( void )
+{
+  return max( 2 * min_rtt_, MIN_TIMEOUT );
+}
+
+/* Target sending rate, in datagrams per second */
+double CopaController::send_rate( void )
+{
+  if ( smoothed_rtt_ == 0 ) {
+    return 0;
+  }
+
+  return PACING_GAIN * window_ * 1000 / smoothed_rtt_;
+}
@@ -0,0 +1,60 @@
+#ifndef COPA_CONTROLLER_HH
+#define COPA_CONTROLLER_HH
+
+#include <cstdint>
+#include <deque>
+
+#include "controller.hh"
+
+/* Copa-style delay-based control (a Vegas descendant): the queueing
+   delay is the "standing" RTT (the least over the last half smoothed
+   RTT) less the propagation RTT (the least over ten seconds), and the
+   target rate is 1 / (delta * queueing delay). Each ack nudges the
+   window toward the target, by a velocity that doubles while the
+   window keeps moving the same way. */
+
+class CopaController : public Controller
+{
+private:
+  double window_; /* datagrams */
+  bool slow_start_;
+
+  /* RTTs in ms (0 before the first ack) */
+  double smoothed_rtt_;
+  uint64_t min_rtt_;
+  uint64_t min_rtt_stamp_;
+
+  /* increasing RTT samples, oldest first, for the windowed min */
+  struct RTTSample
+  {
+    uint64_t time;
+    uint64_t rtt;
+  };
+  std::deque<RTTSample> recent_rtts_;
+
+  /* velocity, updated once a smoothed RTT */
+  double velocity_;
+  int direction_;          /* +1 growing, -1 shrinking */
+  unsigned int direction_rounds_;
+  double round_start_window_;
+  uint64_t round_start_time_;
+
+  unsigned int current_window( void ) override;
+  void record_sent( const uint64_t sequence_number,
+		    const uint64_t send_timestamp ) override;
+  void record_ack( const uint64_t sequence_number_acked,
+		   const uint64_t send_timestamp_acked,
+		   const uint64_t recv_timestamp_acked,
+		   const uint64_t timestamp_ack_received ) override;
+
+  uint64_t standing_rtt( const uint64_t rtt, const uint64_t now );
+  void update_velocity( const uint64_t now );
+
+public:
+  CopaController( const bool debug, const ControllerParameters & parameters );
+
+  unsigned int timeout_ms( void ) override;
+  double send_rate( void ) override;
+};
+
+#endif
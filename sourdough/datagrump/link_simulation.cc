@@ -0,0 +1,522 @@
+#include <fstream>
+#include <deque>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <memory>
+#include <cctype>
+
+#include "link_simulation.hh"
+#include "controller.hh"
+#include "contest_message.hh"
+#include "send_ledger.hh"
+
+using namespace std;
+
+const unsigned int OPPORTUNITY_BYTES = 1504;	// mm-link's PACKET_SIZE
+const size_t IP_UDP_HEADERS = 28;		// counted by mm-link on top of the datagram
+const size_t PAYLOAD_LENGTH = 1424;		// the sender's dummy payload
+const string BINARY_TRACE_MAGIC = string( "mmtrace\x01", 8 );
+
+/* Load a trace, as mm-link reads it */
+LinkTrace::LinkTrace( const string & filename )
+  : runs_()
+{
+  ifstream file( filename, ios::binary );
+  if ( not file.good() ) {
+    throw runtime_error( filename + ": error opening for reading" );
+  }
+
+  char magic[ 8 ] = {};
+  file.read( magic, sizeof( magic ) );
+  if ( file.gcount() == sizeof( magic ) and BINARY_TRACE_MAGIC == string( magic, sizeof( magic ) ) ) {
+    load_binary( file, filename );
+  } else {
+    file.clear();
+    file.seekg( 0 );
+    load_text( file, filename );
+  }
+
+  if ( runs_.empty() or runs_.back().first == 0 ) {
+    throw runtime_error( filename + ": trace must last for a nonzero amount of time" );
+  }
+}
+
+/* one more opportunity (timestamps are nondecreasing) */
+void LinkTrace::add( const uint64_t timestamp )
+{
+  if ( not runs_.empty() and timestamp == runs_.back().first ) {
+    runs_.back().second++;
+  } else {
+    runs_.emplace_back( timestamp, 1 );
+  }
+}
+
+/* one timestamp per line, in ms unless the first line says otherwise */
+void LinkTrace::load_text( istream & file, const string & filename )
+{
+  string line;
+
+  uint64_t ns_per_unit = 1000000;
+  if ( file.peek() == '#' ) {
+    getline( file, line );
+    if ( line == "# units: ms" ) {
+      ns_per_unit = 1000000;
+    } else if ( line == "# units: us" ) {
+      ns_per_unit = 1000;
+    } else if ( line == "# units: ns" ) {
+      ns_per_unit = 1;
+    } else {
+      throw runtime_error( filename + ": invalid header \"" + line + "\" (expected \"# units: ms|us|ns\")" );
+    }
+  }
+
+  while ( getline( file, line ) ) {
+    size_t end = 0;
+    const uint64_t timestamp = stoull( line, &end ) * ns_per_unit / 1000;
+    if ( end != line.size() ) {
+      throw runtime_error( filename + ": invalid timestamp \"" + line + "\"" );
+    }
+    if ( not runs_.empty() and timestamp < runs_.back().first ) {
+      throw runtime_error( filename + ": timestamps must be monotonically nondecreasing" );
+    }
+    add( timestamp );
+  }
+}
+
+/* after the magic: opportunity count and duration (little-endian
+   uint64s), then a LEB128 varint per opportunity of the us since the last */
+void LinkTrace::load_binary( istream & file, const string & filename )
+{
+  auto read_byte = [&] () {
+    const int byte = file.get();
+    if ( byte == EOF ) {
+      throw runtime_error( filename + ": truncated binary trace" );
+    }
+    return uint64_t( byte );
+  };
+
+  uint64_t count = 0, duration = 0;
+  for ( unsigned int i = 0; i < 8; i++ ) {
+    count |= read_byte() << ( 8 * i );
+  }
+  for ( unsigned int i = 0; i < 8; i++ ) {
+    duration |= read_byte() << ( 8 * i );
+  }
+
+  uint64_t timestamp = 0;
+  for ( uint64_t i = 0; i < count; i++ ) {
+    uint64_t delta = 0;
+    for ( unsigned int shift = 0; ; shift += 7 ) {
+      if ( shift >= 64 ) {
+	throw runtime_error( filename + ": varint too long" );
+      }
+      const uint64_t byte = read_byte();
+      delta |= ( byte & 0x7f ) << shift;
+      if ( not ( byte & 0x80 ) ) {
+	break;
+      }
+    }
+    timestamp += delta;
+    add( timestamp );
+  }
+
+  if ( timestamp != duration ) {
+    throw runtime_error( filename + ": opportunities do not add up to the stated duration" );
+  }
+}
+
+/* Parse "packets=N" and/or "bytes=N" */
+QueueLimits QueueLimits::parse( const string & args )
+{
+  auto get_arg = [&] ( const string & name ) {
+    const size_t offset = args.find( name + "=" );
+    if ( offset == string::npos ) {
+      return 0u;
+    }
+    const string digits = args.substr( offset + name.size() + 1 );
+    if ( digits.empty() or not isdigit( digits.front() ) ) {
+      throw runtime_error( "could not parse queue arguments: " + args );
+    }
+    return unsigned( stoul( digits ) );
+  };
+
+  const QueueLimits limits { get_arg( "packets" ), get_arg( "bytes" ) };
+  if ( limits.unlimited() ) {
+    throw runtime_error( "Dropping queue must have a byte or packet limit." );
+  }
+  return limits;
+}
+
+/* a datagram or an ack, on its way through the network (times in us) */
+struct Datagram
+{
+  uint64_t sequence_number;
+  uint64_t send_timestamp; /* ms, sender's clock */
+  uint64_t recv_timestamp; /* ms, receiver's clock (acks only) */
+  size_t size;             /* bytes, as mm-link counts them */
+  uint64_t queue_arrival;  /* when it joined the link's queue */
+};
+
+/* mm-link's LinkQueue: a FIFO (unlimited, or droptail) drained by a
+   trace's delivery opportunities, each good for 1504 bytes (a packet
+   may take several) */
+class TraceLink
+{
+private:
+  const vector<pair<uint64_t, unsigned int>> & runs_;
+  size_t next_run_;
+
+  deque<Datagram> queue_;
+  size_t in_transit_bytes_left_; /* of queue_.front(), if it has started */
+
+  /* as mm-link counts them, without the packet in transit */
+  QueueLimits limits_;
+  size_t queued_bytes_;
+  uint64_t dropped_;
+
+  size_t queued_packets( void ) const { return queue_.size() - ( in_transit_bytes_left_ > 0 ); }
+
+public:
+  TraceLink( const LinkTrace & trace, const QueueLimits & limits = QueueLimits() )
+    : runs_( trace.runs() ), next_run_( 0 ), queue_(), in_transit_bytes_left_( 0 ),
+      limits_( limits ), queued_bytes_( 0 ), dropped_( 0 )
+  {}
+
+  uint64_t dropped( void ) const { return dropped_; }
+
+  bool finished( void ) const { return next_run_ == runs_.size(); }
+
+  uint64_t next_opportunity( void ) const
+  {
+    return finished() ? numeric_limits<uint64_t>::max() : runs_[ next_run_ ].first;
+  }
+
+  void enqueue( const Datagram & datagram, const uint64_t now )
+  {
+    /* a droptail queue turns away what would take it over a limit */
+    if ( ( limits_.packets and queued_packets() + 1 > limits_.packets )
+	 or ( limits_.bytes and queued_bytes_ + datagram.size > limits_.bytes ) ) {
+      dropped_++;
+      return;
+    }
+
+    queue_.push_back( datagram );
+    queue_.back().queue_arrival = now;
+    queued_bytes_ += datagram.size;
+  }
+
+  /* use the opportunities due by now (on packets that arrived before
+     them), handing each departure and run of opportunities to the caller */
+  template <typename DepartureHandler, typename OpportunityHandler>
+  void advance( const uint64_t now, DepartureHandler && departed, OpportunityHandler && offered )
+  {
+    while ( next_opportunity() <= now ) {
+      const uint64_t this_delivery_time = runs_[ next_run_ ].first;
+      uint64_t bytes_left = uint64_t( OPPORTUNITY_BYTES ) * runs_[ next_run_ ].second;
+      offered( this_delivery_time, bytes_left );
+      next_run_++;
+
+      while ( bytes_left > 0 and not queue_.empty()
+	      and queue_.front().queue_arrival < this_delivery_time ) {
+	if ( in_transit_bytes_left_ == 0 ) {
+	  in_transit_bytes_left_ = queue_.front().size;
+	  queued_bytes_ -= queue_.front().size;
+	}
+
+	const uint64_t amount = min( bytes_left, uint64_t( in_transit_bytes_left_ ) );
+	in_transit_bytes_left_ -= amount;
+	bytes_left -= amount;
+
+	if ( in_transit_bytes_left_ == 0 ) {
+	  departed( queue_.front(), this_delivery_time );
+	  queue_.pop_front();
+	}
+      }
+    }
+  }
+};
+
+/* mm-delay: everything comes out a fixed time after it goes in */
+class DelayLine
+{
+private:
+  uint64_t delay_;
+  deque<pair<uint64_t, Datagram>> queue_; /* release time, datagram */
+
+public:
+  DelayLine( const uint64_t delay ) : delay_( delay ), queue_() {}
+
+  void push( const Datagram & datagram, const uint64_t now ) { queue_.emplace_back( now + delay_, datagram ); }
+
+  uint64_t next_release( void ) const
+  {
+    return queue_.empty() ? numeric_limits<uint64_t>::max() : queue_.front().first;
+  }
+
+  template <typename Handler>
+  void release( const uint64_t now, Handler && handler )
+  {
+    while ( next_release() <= now ) {
+      handler( queue_.front().second );
+      queue_.pop_front();
+    }
+  }
+};
+
+/* DatagrumpSender's accounting, driven by the simulation's clock */
+class SimulatedSender
+{
+private:
+  unique_ptr<Controller> controller_;
+  bool pace_;
+
+  uint64_t sequence_number_;
+  SendLedger ledger_;
+
+  uint64_t last_wakeup_;       /* us; the poller's timeout counts from here */
+  double next_send_time_;      /* us, when pacing */
+
+  uint64_t to_ms( const uint64_t us ) const { return us / 1000; }
+
+  bool window_is_open( void )
+  {
+    return ledger_.in_flight() < controller_->window_size();
+  }
+
+  bool pacing_allows_send( const uint64_t now ) const
+  {
+    return not pace_ or now >= next_send_time_;
+  }
+
+public:
+  SimulatedSender( unique_ptr<Controller> && controller, const bool pace )
+    : controller_( move( controller ) ), pace_( pace ),
+      sequence_number_( 0 ), ledger_(),
+      last_wakeup_( 0 ), next_send_time_( 0 )
+  {}
+
+  uint64_t datagrams_sent( void ) const { return sequence_number_; }
+
+  /* when the poller times out (a zero timeout would spin the real
+     sender; here it would stop the clock, so it is taken as 1 ms) */
+  uint64_t timeout_deadline( void )
+  {
+    return last_wakeup_ + 1000 * max( uint64_t( controller_->timeout_ms() ), uint64_t( 1 ) );
+  }
+
+  /* the poller's timeout, or the next paced datagram */
+  uint64_t next_wakeup( void )
+  {
+    uint64_t wakeup = timeout_deadline();
+    if ( pace_ and window_is_open() ) {
+      wakeup = min( wakeup, uint64_t( next_send_time_ ) + 1 );
+    }
+    return wakeup;
+  }
+
+  void ack_received( const Datagram & ack, const uint64_t now )
+  {
+    ledger_.acked( ack.sequence_number );
+    controller_->ack_received( ack.sequence_number, ack.send_timestamp,
+			       ack.recv_timestamp, to_ms( now ) );
+    last_wakeup_ = now;
+  }
+
+  template <typename Output>
+  void send_datagram( const uint64_t now, Output && output )
+  {
+    output( Datagram { sequence_number_, to_ms( now ), 0,
+	  PAYLOAD_LENGTH + ContestMessage::Header::wire_length + IP_UDP_HEADERS, 0 } );
+    ledger_.sent( sequence_number_ );
+    controller_->datagram_was_sent( sequence_number_++, to_ms( now ) );
+
+    if ( pace_ ) {
+      const double rate = controller_->send_rate();
+      const double interval = rate > 0 ? 1.0e6 / rate : 0;
+      next_send_time_ = max( next_send_time_, now - min( double( now ), interval ) ) + interval;
+    }
+  }
+
+  /* what the sender's event loop does when the poller returns at this time */
+  template <typename Output>
+  void wake_up( const uint64_t now, const bool had_acks, Output && output )
+  {
+    if ( not had_acks and now >= timeout_deadline() ) {
+      /* timeout: send one datagram anyway */
+      send_datagram( now, output );
+      last_wakeup_ = now;
+    }
+
+    if ( window_is_open() and pacing_allows_send( now ) ) {
+      while ( window_is_open() and pacing_allows_send( now ) ) {
+	send_datagram( now, output );
+      }
+      last_wakeup_ = now;
+    }
+  }
+};
+
+/* the statistics mm-throughput-graph computes from the uplink's log */
+class UplinkStatistics
+{
+private:
+  bool have_events_;
+  uint64_t first_ms_, last_ms_;
+  uint64_t capacity_bits_, departure_bits_;
+  vector<uint64_t> delays_, signal_delays_;
+
+  /* signal delay, settled for each send time once a later one shows up */
+  bool have_send_time_;
+  uint64_t send_time_, send_time_delay_, last_settled_send_time_;
+
+  void event( const uint64_t time_ms )
+  {
+    if ( not have_events_ ) {
+      first_ms_ = time_ms;
+      have_events_ = true;
+    }
+    last_ms_ = max( last_ms_, time_ms );
+  }
+
+  void settle_send_time( void )
+  {
+    if ( last_settled_send_time_ < send_time_ and not signal_delays_.empty() ) {
+      for ( uint64_t gap = send_time_ - last_settled_send_time_ - 1; gap > 0; gap-- ) {
+	signal_delays_.push_back( send_time_delay_ + gap );
+      }
+    }
+
+    signal_delays_.push_back( send_time_delay_ );
+    last_settled_send_time_ = send_time_;
+  }
+
+  static uint64_t percentile_95( vector<uint64_t> & values )
+  {
+    if ( values.empty() ) {
+      return 0;
+    }
+    auto nth = values.begin() + size_t( 0.95 * values.size() );
+    nth_element( values.begin(), nth, values.end() );
+    return *nth;
+  }
+
+public:
+  UplinkStatistics()
+    : have_events_( false ), first_ms_( 0 ), last_ms_( 0 ),
+      capacity_bits_( 0 ), departure_bits_( 0 ), delays_(), signal_delays_(),
+      have_send_time_( false ), send_time_( 0 ), send_time_delay_( 0 ),
+      last_settled_send_time_( 0 )
+  {}
+
+  void arrival( const uint64_t now ) { event( now / 1000 ); }
+
+  void opportunities( const uint64_t now, const uint64_t bytes )
+  {
+    event( now / 1000 );
+    capacity_bits_ += bytes * 8;
+  }
+
+  void departure( const Datagram & datagram, const uint64_t now )
+  {
+    /* the log is in whole milliseconds */
+    const uint64_t departure_ms = now / 1000;
+    const uint64_t delay = departure_ms - datagram.queue_arrival / 1000;
+    event( departure_ms );
+    departure_bits_ += datagram.size * 8;
+    delays_.push_back( delay );
+
+    const uint64_t send_time = departure_ms - delay;
+    if ( have_send_time_ and send_time == send_time_ ) {
+      send_time_delay_ = min( send_time_delay_, delay );
+      return;
+    }
+
+    if ( have_send_time_ ) {
+      settle_send_time();
+    }
+
+    have_send_time_ = true;
+    send_time_ = send_time;
+    send_time_delay_ = delay;
+  }
+
+  SimulationResult result( const uint64_t datagrams_sent, const uint64_t datagrams_dropped )
+  {
+    if ( have_send_time_ ) {
+      settle_send_time();
+      have_send_time_ = false;
+    }
+
+    SimulationResult result;
+    result.duration_s = ( last_ms_ - first_ms_ ) / 1000.0;
+    result.capacity_mbps = result.duration_s > 0 ? capacity_bits_ / result.duration_s / 1.0e6 : 0;
+    result.throughput_mbps = result.duration_s > 0 ? departure_bits_ / result.duration_s / 1.0e6 : 0;
+    result.queueing_delay_p95_ms = percentile_95( delays_ );
+    result.signal_delay_p95_ms = percentile_95( signal_delays_ );
+    result.power = result.signal_delay_p95_ms
+      ? result.throughput_mbps / ( result.signal_delay_p95_ms / 1000.0 ) : 0;
+    result.datagrams_sent = datagrams_sent;
+    result.datagrams_dropped = datagrams_dropped;
+    return result;
+  }
+};
+
+/* Run one contest over the traces, until the uplink trace ends (as with --once) */
+SimulationResult simulate( const LinkTrace & uplink_trace, const LinkTrace & downlink_trace,
+			   const Scenario & scenario )
+{
+  TraceLink uplink( uplink_trace, scenario.uplink_queue ), downlink( downlink_trace );
+  DelayLine uplink_delay( scenario.one_way_delay_ms * 1000 ), downlink_delay( scenario.one_way_delay_ms * 1000 );
+  SimulatedSender sender( Controller::make( scenario.algorithm, false, scenario.parameters ),
+			  scenario.pace );
+  UplinkStatistics statistics;
+
+  uint64_t now = 0;
+  vector<Datagram> acks;
+
+  auto send_on_uplink = [&] ( const Datagram & datagram ) {
+    statistics.arrival( now );
+    uplink.enqueue( datagram, now );
+  };
+
+  /* the sender starts with a window's worth */
+  sender.wake_up( now, false, send_on_uplink );
+
+  while ( not uplink.finished() ) {
+    now = min( { uplink.next_opportunity(), downlink.next_opportunity(),
+	  uplink_delay.next_release(), downlink_delay.next_release(),
+	  sender.next_wakeup() } );
+
+    /* the links deliver first, so what is sent now waits for a later opportunity */
+    uplink.advance( now,
+		    [&] ( const Datagram & datagram, const uint64_t time ) {
+		      statistics.departure( datagram, time );
+		      uplink_delay.push( datagram, time ); },
+		    [&] ( const uint64_t time, const uint64_t bytes ) {
+		      statistics.opportunities( time, bytes ); } );
+
+    downlink.advance( now,
+		      [&] ( const Datagram & ack, const uint64_t ) { acks.push_back( ack ); },
+		      [] ( const uint64_t, const uint64_t ) {} );
+
+    /* the receiver acks each datagram as it arrives */
+    uplink_delay.release( now, [&] ( const Datagram & datagram ) {
+	downlink_delay.push( Datagram { datagram.sequence_number, datagram.send_timestamp,
+	      now / 1000, ContestMessage::Header::wire_length + IP_UDP_HEADERS, 0 }, now );
+      } );
+
+    downlink_delay.release( now, [&] ( const Datagram & ack ) { downlink.enqueue( ack, now ); } );
+
+    for ( const auto & ack : acks ) {
+      sender.ack_received( ack, now );
+    }
+
+    if ( not acks.empty() or now >= sender.next_wakeup() ) {
+      sender.wake_up( now, not acks.empty(), send_on_uplink );
+    }
+    acks.clear();
+  }
+
+  return statistics.result( sender.datagrams_sent(), uplink.dropped() );
+}
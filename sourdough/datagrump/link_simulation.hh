@@ -0,0 +1,75 @@
+#ifndef LINK_SIMULATION_HH
+#define LINK_SIMULATION_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "controller.hh"
+
+/* The datagrump sender and receiver, run in virtual time over a model
+   of run-contest's network: "mm-delay DELAY mm-link UPLINK DOWNLINK
+   --once", with the sender inside. Each direction has mm-link's queue,
+   which spends 1504 bytes per delivery opportunity in the trace, and
+   mm-delay's fixed delay. The uplink's queue can be a droptail one,
+   as with mm-link's --uplink-queue=droptail. The Controller is linked in directly, so
+   a run takes as long as its computation, not as long as the trace. */
+
+/* the delivery opportunities of an mm-link trace (text, in ms unless
+   the first line is "# units: us" or "ns", or binary), in microseconds */
+class LinkTrace
+{
+private:
+  std::vector<std::pair<uint64_t, unsigned int>> runs_; /* timestamp, count */
+
+  void load_text( std::istream & file, const std::string & filename );
+  void load_binary( std::istream & file, const std::string & filename );
+  void add( const uint64_t timestamp );
+
+public:
+  LinkTrace( const std::string & filename );
+
+  /* opportunities that share a timestamp, in order */
+  const std::vector<std::pair<uint64_t, unsigned int>> & runs( void ) const { return runs_; }
+};
+
+/* mm-link's --uplink-queue-args for a droptail queue (0 for no limit) */
+struct QueueLimits
+{
+  unsigned int packets;
+  unsigned int bytes;
+
+  bool unlimited( void ) const { return packets == 0 and bytes == 0; }
+
+  /* parse "packets=N" and/or "bytes=N", as mm-link does */
+  static QueueLimits parse( const std::string & args );
+};
+
+/* what the contest varies from run to run */
+struct Scenario
+{
+  std::string algorithm;
+  ControllerParameters parameters;
+  bool pace;
+  uint64_t one_way_delay_ms;
+  QueueLimits uplink_queue; /* unlimited for mm-link's default, infinite queue */
+};
+
+/* what mm-throughput-graph reports for the uplink, and the power score */
+struct SimulationResult
+{
+  double duration_s;
+  double capacity_mbps;
+  double throughput_mbps;
+  uint64_t queueing_delay_p95_ms;
+  uint64_t signal_delay_p95_ms;
+  double power; /* throughput (Mbits/s) / 95th percentile signal delay (s) */
+  uint64_t datagrams_sent;
+  uint64_t datagrams_dropped; /* by the uplink's queue */
+};
+
+SimulationResult simulate( const LinkTrace & uplink, const LinkTrace & downlink,
+			   const Scenario & scenario );
+
+#endif /* LINK_SIMULATION_HH */
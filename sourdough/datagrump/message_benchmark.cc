@@ -0,0 +1,71 @@
+/* datagrams per second through the sender's and receiver's message
+   handling (serializing a datagram; parsing it and serializing the
+   ack), with the copying ContestMessage path and the in-place one */
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+
+#include "contest_message.hh"
+
+using namespace std;
+
+static const unsigned int DATAGRAMS = 2000000;
+
+/* sum of the bytes produced, so the work can't be optimized away */
+static uint64_t checksum = 0;
+
+static void report( const string & name, const function<void( uint64_t )> & handle_datagram )
+{
+  const auto start = chrono::steady_clock::now();
+
+  for ( uint64_t i = 0; i < DATAGRAMS; i++ ) {
+    handle_datagram( i );
+  }
+
+  const double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+  cout << left << setw( 32 ) << name << right << fixed << setprecision( 2 )
+       << setw( 8 ) << DATAGRAMS / seconds / 1.0e6 << " M datagrams/s" << endl;
+}
+
+int main( void )
+{
+  const string payload( 1424, 'x' );
+
+  /* sender: one datagram per sequence number */
+  report( "sender (ContestMessage)", [&] ( const uint64_t i ) {
+      ContestMessage cm( i, payload );
+      cm.header.send_timestamp = i;
+      checksum += cm.to_string().size();
+    } );
+
+  ContestMessageBuffer datagram( payload );
+  report( "sender (ContestMessageBuffer)", [&] ( const uint64_t i ) {
+      ContestMessage::Header header( i );
+      header.send_timestamp = i;
+      checksum += datagram.serialize( header ).size();
+    } );
+
+  /* receiver: parse a datagram, and serialize the ack */
+  const string incoming = ContestMessage( 42, payload ).to_string();
+
+  report( "receiver (ContestMessage)", [&] ( const uint64_t i ) {
+      ContestMessage message = incoming;
+      message.transform_into_ack( i, 2 );
+      message.header.send_timestamp = 3;
+      checksum += message.to_string().size();
+    } );
+
+  ContestMessageBuffer ack( "" );
+  report( "receiver (ContestMessageView)", [&] ( const uint64_t i ) {
+      ContestMessageView message( incoming );
+      message.header.transform_into_ack( i, 2, message.payload_length );
+      message.header.send_timestamp = 3;
+      checksum += ack.serialize( message.header ).size();
+    } );
+
+  return checksum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
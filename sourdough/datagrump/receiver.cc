@@ -1,12 +1,134 @@
-/* simple UDP receiver that acknowledges every datagram */
+/* simple UDP receiver that acknowledges every datagram
+   (each with its own ack, or several to an ack with delayed acks) */
 
 #include <cstdlib>
 #include <iostream>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <string>
 
 #include "socket.hh"
 #include "contest_message.hh"
+#include "poller.hh"
+#include "timestamp.hh"
 
 using namespace std;
+using namespace PollerShortNames;
+
+/* most datagrams received (and acks sent) per system call */
+static const size_t BATCH_SIZE = 64;
+
+/* with delayed acks, the most datagrams one ack acknowledges */
+static const size_t MAX_ACKED = 32;
+
+/* Acks waiting to go out: for delayed acks, the datagrams that one
+   ack will acknowledge (the newest in its header, the rest in its ack
+   block), held until the delay is up or the ack is full */
+class PendingAck
+{
+private:
+  size_t max_acked_;
+  uint64_t ack_delay_;
+
+  bool empty_;
+  Address source_;
+  ContestMessage::Header newest_; /* already turned into an ack */
+  vector<AckedDatagram> earlier_;
+  uint64_t deadline_;
+
+  ContestMessageBuffer buffer_;
+  uint64_t sequence_number_;
+
+  /* can an ack block carry a with offsets from b? */
+  static bool near( const AckedDatagram & a, const AckedDatagram & b )
+  {
+    auto fits = [] ( const uint64_t x, const uint64_t y ) {
+      const int64_t offset = x - y;
+      return offset >= numeric_limits<int32_t>::min() and offset <= numeric_limits<int32_t>::max();
+    };
+    return fits( a.sequence_number, b.sequence_number ) and fits( a.send_timestamp, b.send_timestamp )
+      and fits( a.recv_timestamp, b.recv_timestamp );
+  }
+
+  AckedDatagram newest_acked( void ) const
+  {
+    return { newest_.ack_sequence_number, newest_.ack_send_timestamp, newest_.ack_recv_timestamp };
+  }
+
+public:
+  PendingAck( const size_t max_acked, const uint64_t ack_delay )
+    : max_acked_( max_acked ), ack_delay_( ack_delay ),
+      empty_( true ), source_(), newest_( 0 ), earlier_(), deadline_( 0 ),
+      buffer_( "" ), sequence_number_( 0 )
+  {}
+
+  /* when the held ack is due (the poller's timeout) */
+  int timeout_ms( void ) const
+  {
+    if ( empty_ ) {
+      return -1;
+    }
+    const uint64_t now = timestamp_ms();
+    return deadline_ > now ? deadline_ - now : 0;
+  }
+
+  /* queue the held ack, if there is one */
+  void flush( UDPSocket::SendBatch & acks )
+  {
+    if ( empty_ ) {
+      return;
+    }
+
+    newest_.sequence_number = sequence_number_++;
+
+    /* timestamp the ack just before sending */
+    newest_.send_timestamp = timestamp_ms();
+
+    /* copied whole: the buffer is rewritten (and resized) for the next ack */
+    acks.push( source_, buffer_.serialize( newest_, earlier_ ) );
+    earlier_.clear();
+    empty_ = true;
+  }
+
+  /* a datagram arrived: add it to the held ack (sending that first if
+     the datagram can't join it) */
+  void add( const Address & source, const ContestMessageView & message,
+	    const uint64_t recv_timestamp, UDPSocket::SendBatch & acks )
+  {
+    ContestMessage::Header ack = message.header;
+    ack.transform_into_ack( 0, recv_timestamp, message.payload_length );
+    const AckedDatagram acked { ack.ack_sequence_number, ack.ack_send_timestamp, ack.ack_recv_timestamp };
+
+    if ( not empty_ and ( not ( source == source_ ) or 1 + earlier_.size() == max_acked_
+			  or not near( newest_acked(), acked )
+			  or any_of( earlier_.begin(), earlier_.end(),
+				     [&] ( const AckedDatagram & a ) { return not near( a, acked ); } ) ) ) {
+      flush( acks );
+    }
+
+    if ( empty_ ) {
+      empty_ = false;
+      source_ = source;
+      deadline_ = timestamp_ms() + ack_delay_;
+    } else {
+      earlier_.push_back( newest_acked() );
+    }
+    newest_ = ack;
+
+    if ( 1 + earlier_.size() == max_acked_ ) {
+      flush( acks );
+    }
+  }
+
+  /* send the held ack if its time is up */
+  void flush_if_due( UDPSocket::SendBatch & acks )
+  {
+    if ( not empty_ and timestamp_ms() >= deadline_ ) {
+      flush( acks );
+    }
+  }
+};
 
 int main( int argc, char *argv[] )
 {
@@ -15,11 +137,29 @@ int main( int argc, char *argv[] )
     abort();
   }
 
-  if ( argc != 2 ) {
-    cerr << "Usage: " << argv[ 0 ] << " PORT" << endl;
+  /* without delayed acks, every datagram gets an ack of its own, right away */
+  const bool delayed_acks = argc == 3;
+  uint64_t ack_delay = 0;
+  bool usage_error = argc != 2 and argc != 3;
+  if ( delayed_acks ) {
+    try {
+      size_t end = 0;
+      ack_delay = stoull( argv[ 2 ], &end );
+      usage_error = end != string( argv[ 2 ] ).size();
+    } catch ( const exception & ) {
+      usage_error = true;
+    }
+  }
+
+  if ( usage_error ) {
+    cerr << "Usage: " << argv[ 0 ] << " PORT [ACK-DELAY-MS]" << endl
+	 << endl << "(With ACK-DELAY-MS, delayed acks: each ack acknowledges up to " << MAX_ACKED
+	 << " datagrams, sent within ACK-DELAY-MS of the first; with 0, those received together.)" << endl;
     return EXIT_FAILURE;
   }
 
+  PendingAck pending( delayed_acks ? MAX_ACKED : 1, ack_delay );
+
   /* create UDP socket for incoming datagrams */
   UDPSocket socket;
 
@@ -31,21 +171,36 @@ int main( int argc, char *argv[] )
 
   cerr << "Listening on " << socket.local_address().to_string() << endl;
 
-  uint64_t sequence_number = 0;
+  /* take in (and answer) whatever has arrived, up to a batch at a time */
+  UDPSocket::ReceivedBatch datagrams( BATCH_SIZE );
+  UDPSocket::SendBatch acks( BATCH_SIZE + 1 ); /* and one held from before */
 
-  /* Loop and acknowledge every incoming datagram back to its source */
-  while ( true ) {
-    const UDPSocket::received_datagram recd = socket.recv();
-    ContestMessage message = recd.payload;
+  Poller poller;
+  poller.add_action( Action( socket, Direction::In, [&] () {
+	socket.recv( datagrams );
 
-    /* assemble the acknowledgment */
-    message.transform_into_ack( sequence_number++, recd.timestamp );
+	for ( size_t i = 0; i < datagrams.size(); i++ ) {
+	  const ContestMessageView message( datagrams.payload( i ), datagrams.payload_length( i ) );
+	  pending.add( datagrams.source_address( i ), message, datagrams.timestamp( i ), acks );
+	}
 
-    /* timestamp the ack just before sending */
-    message.set_send_timestamp();
+	/* with no delay, the ack covers what was received together */
+	if ( ack_delay == 0 ) {
+	  pending.flush( acks );
+	}
+	return ResultType::Continue;
+      } ) );
+
+  /* Loop and acknowledge every incoming datagram back to its source */
+  while ( true ) {
+    const auto ret = poller.poll( pending.timeout_ms() );
+    if ( ret.result == PollResult::Exit ) {
+      return ret.exit_status;
+    }
 
-    /* send the ack */
-    socket.sendto( recd.source_address, message.to_string() );
+    /* send the acks */
+    pending.flush_if_due( acks );
+    socket.send( acks );
   }
 
   return EXIT_SUCCESS;
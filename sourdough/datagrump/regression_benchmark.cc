@@ -0,0 +1,171 @@
+/* the cost per ack of AIMD's RTT prediction, recomputing the sums
+   over the window (as it used to) and keeping them with
+   SlidingRegression, and the precision of each over an hour-long run
+   against a two-pass fit in long double; fails if SlidingRegression's
+   prediction is ever off by more than MAX_ERROR */
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <numeric>
+#include <random>
+#include <cmath>
+
+#include "sliding_regression.hh"
+
+using namespace std;
+
+static const uint64_t ACKS = 2000000;
+static const uint64_t RUN_MS = 3600 * 1000; /* for the precision check */
+static const uint64_t CHECK_INTERVAL = 997; /* acks between comparisons */
+static const double MAX_ERROR = 1e-6; /* ms of predicted RTT */
+
+static const vector<size_t> WINDOWS = { 4, 16, 64, 256, 1024 };
+
+/* sum of the predictions, so the work can't be optimized away */
+static double checksum = 0;
+
+/* acks arriving 0 to 4 ms apart, with RTTs wandering between 40 and 400 ms */
+class AckStream
+{
+private:
+  minstd_rand prng_;
+  uniform_int_distribution<uint64_t> gap_;
+  normal_distribution<double> step_;
+  uint64_t time_;
+  double rtt_;
+
+public:
+  AckStream() : prng_( 1 ), gap_( 0, 4 ), step_( 0, 3 ), time_( 0 ), rtt_( 100 ) {}
+
+  void next( void )
+  {
+    time_ += gap_( prng_ );
+    rtt_ = min( 400.0, max( 40.0, rtt_ + step_( prng_ ) ) );
+  }
+
+  uint64_t time( void ) const { return time_; }
+  int64_t rtt( void ) const { return llround( rtt_ ); }
+};
+
+/* the old predicted_RTT: the window's sums, recomputed on every ack */
+class RecomputedRegression
+{
+private:
+  vector<double> times_, RTTs_;
+  uint64_t count_;
+
+public:
+  RecomputedRegression( const size_t capacity ) : times_( capacity ), RTTs_( capacity ), count_( 0 ) {}
+
+  void add( const uint64_t x, const int64_t y )
+  {
+    times_[ count_ % times_.size() ] = x;
+    RTTs_[ count_ % RTTs_.size() ] = y;
+    count_++;
+  }
+
+  double predict( const uint64_t x ) const
+  {
+    const double n = times_.size();
+    const double s_x = accumulate( times_.begin(), times_.end(), 0.0 );
+    const double s_y = accumulate( RTTs_.begin(), RTTs_.end(), 0.0 );
+    const double s_xx = inner_product( times_.begin(), times_.end(), times_.begin(), 0.0 );
+    const double s_xy = inner_product( times_.begin(), times_.end(), RTTs_.begin(), 0.0 );
+    const double slope = ( n * s_xy - s_x * s_y ) / ( n * s_xx - s_x * s_x );
+    return slope * x + ( s_y / n - slope * s_x / n );
+  }
+};
+
+/* the reference: two passes, centred, in long double */
+static long double reference_prediction( const deque<pair<uint64_t, int64_t>> & samples,
+					 const uint64_t x )
+{
+  long double mean_x = 0, mean_y = 0;
+  for ( const auto & sample : samples ) {
+    mean_x += sample.first;
+    mean_y += sample.second;
+  }
+  mean_x /= samples.size();
+  mean_y /= samples.size();
+
+  long double centred_xx = 0, centred_xy = 0;
+  for ( const auto & sample : samples ) {
+    centred_xx += ( sample.first - mean_x ) * ( sample.first - mean_x );
+    centred_xy += ( sample.first - mean_x ) * ( sample.second - mean_y );
+  }
+
+  const long double slope = centred_xx > 0 ? centred_xy / centred_xx : 0;
+  return mean_y + slope * ( x - mean_x );
+}
+
+template <class Regression>
+static double ns_per_ack( const size_t window )
+{
+  Regression regression( window );
+  AckStream acks;
+
+  const auto start = chrono::steady_clock::now();
+  for ( uint64_t i = 0; i < ACKS; i++ ) {
+    acks.next();
+    regression.add( acks.time(), acks.rtt() );
+    checksum += regression.predict( acks.time() + 1 );
+  }
+  return chrono::duration<double, nano>( chrono::steady_clock::now() - start ).count() / ACKS;
+}
+
+int main( void )
+{
+  cout << "ns per ack (add a sample and predict)" << endl
+       << right << setw( 8 ) << "window" << setw( 14 ) << "recomputed" << setw( 14 ) << "incremental" << endl;
+  for ( const auto window : WINDOWS ) {
+    cout << setw( 8 ) << window << fixed << setprecision( 1 )
+	 << setw( 14 ) << ns_per_ack<RecomputedRegression>( window )
+	 << setw( 14 ) << ns_per_ack<SlidingRegression>( window ) << endl;
+  }
+
+  cout << endl << "largest error in the predicted RTT (ms) over " << RUN_MS / 1000 << " s of acks" << endl
+       << right << setw( 8 ) << "window" << setw( 14 ) << "recomputed" << setw( 14 ) << "incremental" << endl;
+
+  bool passed = true;
+  for ( const auto window : WINDOWS ) {
+    RecomputedRegression recomputed( window );
+    SlidingRegression incremental( window );
+    deque<pair<uint64_t, int64_t>> samples;
+    double recomputed_error = 0, incremental_error = 0;
+
+    AckStream acks;
+    for ( uint64_t i = 0; acks.time() < RUN_MS; i++ ) {
+      acks.next();
+      recomputed.add( acks.time(), acks.rtt() );
+      incremental.add( acks.time(), acks.rtt() );
+      samples.emplace_back( acks.time(), acks.rtt() );
+      if ( samples.size() > window ) {
+	samples.pop_front();
+      }
+
+      /* the samples' times can all be the same, which the recomputed fit can't handle */
+      if ( samples.size() < window or i % CHECK_INTERVAL or samples.front().first == samples.back().first ) {
+	continue;
+      }
+
+      const uint64_t x = acks.time() + 1;
+      const long double expected = reference_prediction( samples, x );
+      recomputed_error = max( recomputed_error, double( fabsl( recomputed.predict( x ) - expected ) ) );
+      incremental_error = max( incremental_error, double( fabsl( incremental.predict( x ) - expected ) ) );
+    }
+
+    cout << setw( 8 ) << window << scientific << setprecision( 2 )
+	 << setw( 14 ) << recomputed_error << setw( 14 ) << incremental_error << endl;
+    passed = passed and incremental_error <= MAX_ERROR;
+  }
+
+  if ( not passed ) {
+    cout << endl << "FAIL: SlidingRegression's prediction was off by more than " << MAX_ERROR << " ms" << endl;
+  }
+
+  return ( passed and checksum ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,100 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "send_ledger.hh"
+
+using namespace std;
+
+/* the smallest power of two that is at least n */
+static size_t power_of_two_at_least( const size_t n )
+{
+  size_t size = 1;
+  while ( size < n ) {
+    size *= 2;
+  }
+  return size;
+}
+
+SendLedger::SendLedger( const size_t initial_capacity )
+  : ring_( power_of_two_at_least( initial_capacity ), State::Acked ),
+    mask_( ring_.size() - 1 ),
+    first_( 0 ), next_( 0 ), loss_scan_( 0 ), in_flight_( 0 ),
+    acked_( 0 ), lost_( 0 ), late_( 0 )
+{}
+
+/* Double the ring, keeping the entries from first_ on */
+void SendLedger::grow( void )
+{
+  vector<State> bigger( 2 * ring_.size(), State::Acked );
+  const uint64_t bigger_mask = bigger.size() - 1;
+  for ( uint64_t s = first_; s < next_; s++ ) {
+    bigger[ s & bigger_mask ] = state( s );
+  }
+  ring_.swap( bigger );
+  mask_ = bigger_mask;
+}
+
+/* A datagram was sent */
+void SendLedger::sent( const uint64_t sequence_number )
+{
+  if ( sequence_number != next_ ) {
+    throw runtime_error( "SendLedger: datagrams must be sent in sequence" );
+  }
+
+  if ( next_ - first_ == ring_.size() ) {
+    grow();
+  }
+
+  state( next_++ ) = State::InFlight;
+  in_flight_++;
+}
+
+/* Everything still in flight that an ack has overtaken by the threshold is lost */
+void SendLedger::detect_losses( const uint64_t highest_acked )
+{
+  if ( highest_acked < REORDER_THRESHOLD ) {
+    return;
+  }
+
+  const uint64_t end = highest_acked - REORDER_THRESHOLD + 1;
+  for ( loss_scan_ = max( loss_scan_, first_ ); loss_scan_ < end; loss_scan_++ ) {
+    if ( state( loss_scan_ ) == State::InFlight ) {
+      state( loss_scan_ ) = State::Lost;
+      in_flight_--;
+      lost_++;
+    }
+  }
+}
+
+/* An ack came back */
+bool SendLedger::acked( const uint64_t sequence_number )
+{
+  if ( sequence_number >= next_ ) {
+    throw runtime_error( "SendLedger: ack for a datagram that was never sent" );
+  }
+
+  /* long since taken as lost (or a duplicate) */
+  if ( sequence_number < first_ ) {
+    late_++;
+    return false;
+  }
+
+  State & entry = state( sequence_number );
+  if ( entry != State::InFlight ) {
+    late_ += entry == State::Lost;
+    return false;
+  }
+
+  entry = State::Acked;
+  in_flight_--;
+  acked_++;
+
+  detect_losses( sequence_number );
+
+  /* forget what has been accounted for */
+  while ( first_ < next_ and state( first_ ) != State::InFlight ) {
+    first_++;
+  }
+
+  return true;
+}
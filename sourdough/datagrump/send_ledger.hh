@@ -0,0 +1,56 @@
+#ifndef SEND_LEDGER_HH
+#define SEND_LEDGER_HH
+
+#include <cstdint>
+#include <vector>
+
+/* The sender's record of the datagrams it has sent and not yet
+   accounted for, in a ring indexed by sequence number. The receiver
+   acks each datagram by itself, so every ack is selective, as with
+   TCP's SACK: a datagram is taken as lost once REORDER_THRESHOLD
+   datagrams sent after it have been acked, and until then as merely
+   reordered. Lost datagrams leave the flight, so the window reopens
+   as soon as a loss is detected. */
+
+class SendLedger
+{
+private:
+  enum class State : uint8_t { InFlight, Acked, Lost };
+
+  std::vector<State> ring_; /* a power of two long; sequence number s at s & mask_ */
+  uint64_t mask_;
+
+  uint64_t first_;        /* everything before this has been acked or lost */
+  uint64_t next_;         /* the next sequence number to be sent */
+  uint64_t loss_scan_;    /* everything before this that is not acked is lost */
+  uint64_t in_flight_;
+
+  uint64_t acked_, lost_, late_;
+
+  State & state( const uint64_t sequence_number ) { return ring_[ sequence_number & mask_ ]; }
+  void grow( void );
+  void detect_losses( const uint64_t highest_acked );
+
+public:
+  /* acks that can overtake a datagram before it counts as lost */
+  static const uint64_t REORDER_THRESHOLD = 3;
+
+  SendLedger( const size_t initial_capacity = 1024 );
+
+  /* a datagram went out (sequence numbers start at 0 and go up by 1) */
+  void sent( const uint64_t sequence_number );
+
+  /* an ack came back; returns false if the datagram was already
+     accounted for (acked, or taken as lost and now arriving late) */
+  bool acked( const uint64_t sequence_number );
+
+  /* datagrams sent but neither acked nor taken as lost */
+  uint64_t in_flight( void ) const { return in_flight_; }
+
+  /* totals, since the start */
+  uint64_t acked_count( void ) const { return acked_; }
+  uint64_t lost_count( void ) const { return lost_; }
+  uint64_t late_count( void ) const { return late_; } /* acks for datagrams taken as lost */
+};
+
+#endif /* SEND_LEDGER_HH */
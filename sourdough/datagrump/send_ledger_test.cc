@@ -0,0 +1,227 @@
+/* checks SendLedger: that reordering under REORDER_THRESHOLD loses
+   nothing, that a datagram overtaken by exactly the threshold is lost,
+   that an ack for a datagram already taken as lost is counted as late
+   and leaves the flight alone, and that the ring keeps its entries
+   (and its loss-scan cursor its place) when it grows with holes in
+   it. Then it runs a long random mix of sends and acks, from a ring
+   of one entry, against a plain record of every datagram. */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <stdexcept>
+#include <functional>
+#include <algorithm>
+
+#include "send_ledger.hh"
+#include "util.hh"
+
+using namespace std;
+
+static const uint64_t T = SendLedger::REORDER_THRESHOLD;
+
+static void check( const bool condition, const string & problem )
+{
+  if ( not condition ) {
+    throw runtime_error( "send-ledger-test: " + problem );
+  }
+}
+
+/* does the action throw? */
+static bool throws( const function<void( void )> & action )
+{
+  try {
+    action();
+  } catch ( const runtime_error & ) {
+    return true;
+  }
+  return false;
+}
+
+static void check_counts( const SendLedger & ledger, const uint64_t in_flight, const uint64_t acked,
+			  const uint64_t lost, const uint64_t late, const string & when )
+{
+  check( ledger.in_flight() == in_flight and ledger.acked_count() == acked
+	 and ledger.lost_count() == lost and ledger.late_count() == late,
+	 when + ": " + to_string( ledger.in_flight() ) + " in flight, " + to_string( ledger.acked_count() )
+	 + " acked, " + to_string( ledger.lost_count() ) + " lost, " + to_string( ledger.late_count() )
+	 + " late; expected " + to_string( in_flight ) + ", " + to_string( acked ) + ", "
+	 + to_string( lost ) + ", " + to_string( late ) );
+}
+
+static void send( SendLedger & ledger, const uint64_t from, const uint64_t to )
+{
+  for ( uint64_t s = from; s < to; s++ ) {
+    ledger.sent( s );
+  }
+}
+
+/* every datagram acked, each overtaken by up to T - 1 later ones */
+static void reordering_under_threshold( void )
+{
+  SendLedger ledger;
+  send( ledger, 0, 3 * T );
+
+  for ( uint64_t base = 0; base < 3 * T; base += T ) {
+    for ( uint64_t i = T; i > 0; i-- ) {
+      check( ledger.acked( base + i - 1 ), "a reordered datagram was not in flight" );
+    }
+  }
+
+  check_counts( ledger, 0, 3 * T, 0, 0, "reordering under the threshold" );
+  cout << "send-ledger-test: reordering under the threshold OK" << endl;
+}
+
+/* datagram 0 is overtaken by T - 1 acks, then by T */
+static void loss_at_threshold( void )
+{
+  SendLedger ledger;
+  send( ledger, 0, T + 2 );
+
+  check( ledger.acked( T - 1 ), "ack " + to_string( T - 1 ) + " refused" );
+  check_counts( ledger, T + 1, 1, 0, 0, "overtaken by T - 1" );
+
+  check( ledger.acked( T ), "ack " + to_string( T ) + " refused" );
+  check_counts( ledger, T - 1, 2, 1, 0, "overtaken by T" );
+
+  /* 1 is now only T - 1 behind: still in flight */
+  check( ledger.acked( 1 ), "a datagram under the threshold was taken as lost" );
+  check_counts( ledger, T - 2, 3, 1, 0, "after acking 1" );
+
+  cout << "send-ledger-test: loss at exactly the threshold OK" << endl;
+}
+
+/* the acks for lost datagrams arrive after all */
+static void ack_after_loss( void )
+{
+  SendLedger ledger;
+  send( ledger, 0, T + 2 );
+
+  check( ledger.acked( T + 1 ), "ack " + to_string( T + 1 ) + " refused" );
+  check_counts( ledger, T - 1, 1, 2, 0, "two lost" );
+
+  check( not ledger.acked( 0 ), "an ack for a lost datagram was taken" );
+  check_counts( ledger, T - 1, 1, 2, 1, "a late ack" );
+
+  for ( uint64_t s = 2; s <= T; s++ ) {
+    check( ledger.acked( s ), "ack " + to_string( s ) + " refused" );
+  }
+  check_counts( ledger, 0, T, 2, 1, "everything acked or lost" );
+
+  check( not ledger.acked( 1 ), "an ack for a lost datagram was taken, with nothing in flight" );
+  check_counts( ledger, 0, T, 2, 2, "another late ack" );
+
+  check( throws( [&] () { ledger.acked( T + 2 ); } ), "an ack for a datagram never sent was taken" );
+  check( throws( [&] () { ledger.sent( T + 3 ); } ), "a datagram out of sequence was taken" );
+
+  cout << "send-ledger-test: acks after a loss OK" << endl;
+}
+
+/* the ring grows while its oldest entries are still in flight, with
+   acked and lost entries among them, and with the loss scan partway */
+static void growth_with_holes( void )
+{
+  SendLedger ledger( 4 );
+  send( ledger, 0, 4 );
+
+  /* 0 in flight, 1 acked, 2 in flight, 3 acked: 0 is lost, 2 not yet */
+  check( ledger.acked( 1 ) and ledger.acked( 3 ), "an ack in flight was refused" );
+  check_counts( ledger, 1, 2, 1, 0, "before growing" );
+
+  /* 2 holds the ring's start, so this grows it (twice) */
+  send( ledger, 4, 14 );
+  check_counts( ledger, 11, 2, 1, 0, "after growing" );
+
+  /* the entries came across: 0 lost, 1 and 3 acked, 2 and 4 still in flight */
+  check( not ledger.acked( 0 ), "a lost entry came back in flight" );
+  check( not ledger.acked( 3 ), "an acked entry came back in flight" );
+  check( ledger.acked( 4 ), "an entry in flight was lost" );
+  check_counts( ledger, 10, 3, 1, 1, "after acking 4" );
+
+  /* the scan picks up where it stopped: 2, 5 and 6 are lost by 9, not 0 or 1 again */
+  check( ledger.acked( 9 ), "ack 9 refused" );
+  check_counts( ledger, 6, 4, 4, 1, "after acking 9" );
+  check( ledger.acked( 7 ) and ledger.acked( 8 ), "an entry in flight was lost" );
+  check( not ledger.acked( 2 ), "the loss scan skipped 2" );
+
+  /* and it goes on from the start, which has moved past it, to 10 */
+  check( ledger.acked( 13 ), "ack 13 refused" );
+  check_counts( ledger, 2, 7, 5, 2, "after acking 13" );
+  check( ledger.acked( 11 ) and ledger.acked( 12 ), "an entry in flight was lost" );
+  check( not ledger.acked( 10 ), "the loss scan skipped 10" );
+
+  cout << "send-ledger-test: growth with holes OK" << endl;
+}
+
+/* a long random mix of sends and acks, from a ring of one entry,
+   against a plain record of every datagram */
+static void random_against_record( void )
+{
+  enum class State { InFlight, Acked, Lost, LateAcked };
+
+  default_random_engine prng( 1 );
+  SendLedger ledger( 1 );
+  vector<State> record;
+  vector<uint64_t> unacked; /* in flight or lost, and not yet acked */
+  uint64_t in_flight = 0, acked = 0, lost = 0, late = 0;
+  uint64_t lost_below = 0; /* anything before this still in flight is lost */
+
+  for ( unsigned int step = 0; step < 200000; step++ ) {
+    /* send in bursts, so the flight grows and shrinks */
+    if ( unacked.empty() or uniform_int_distribution<unsigned int>( 0, 99 )( prng ) < 45 + 10 * ( step / 10000 % 2 ) ) {
+      ledger.sent( record.size() );
+      unacked.push_back( record.size() );
+      record.push_back( State::InFlight );
+      in_flight++;
+      continue;
+    }
+
+    /* ack one of the last few sent, so reordering is mostly short */
+    const size_t window = min( unacked.size(), size_t( 2 * T + 2 ) );
+    const size_t pick = unacked.size() - 1 - uniform_int_distribution<size_t>( 0, window - 1 )( prng );
+    const uint64_t s = unacked[ pick ];
+    unacked.erase( unacked.begin() + pick );
+
+    const bool was_in_flight = record[ s ] == State::InFlight;
+    check( ledger.acked( s ) == was_in_flight, "ack " + to_string( s ) + " taken wrongly" );
+
+    if ( was_in_flight ) {
+      record[ s ] = State::Acked;
+      in_flight--;
+      acked++;
+      for ( ; lost_below + T <= s; lost_below++ ) {
+	if ( record[ lost_below ] == State::InFlight ) {
+	  record[ lost_below ] = State::Lost;
+	  in_flight--;
+	  lost++;
+	}
+      }
+    } else {
+      record[ s ] = State::LateAcked;
+      late++;
+    }
+
+    check_counts( ledger, in_flight, acked, lost, late, "step " + to_string( step ) );
+  }
+
+  check( lost > 1000 and late > 1000 and in_flight > 0, "too few losses to mean anything" );
+  cout << "send-ledger-test: " << record.size() << " datagrams against a record OK" << endl;
+}
+
+int main( void )
+{
+  try {
+    reordering_under_threshold();
+    loss_at_threshold();
+    ack_after_loss();
+    growth_with_holes();
+    random_against_record();
+  } catch ( const exception & e ) {
+    print_exception( e );
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
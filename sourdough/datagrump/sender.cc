@@ -2,36 +2,65 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <algorithm>
 
 #include "socket.hh"
 #include "contest_message.hh"
 #include "controller.hh"
+#include "send_ledger.hh"
 #include "poller.hh"
+#include "timestamp.hh"
+#include "timerfd.hh"
+#include "util.hh"
 
 using namespace std;
 using namespace PollerShortNames;
 
+/* most datagrams sent (and acks received) per system call */
+static const size_t BATCH_SIZE = 64;
+
 /* simple sender class to handle the accounting */
 class DatagrumpSender
 {
 private:
   UDPSocket socket_;
-  Controller controller_; /* your class */
+  unique_ptr<Controller> controller_; /* your class */
+
+  /* All messages use the same dummy payload */
+  ContestMessageBuffer datagram_;
+
+  /* datagrams waiting to go out in one system call,
+     and acks taken in with one */
+  UDPSocket::SendBatch outgoing_;
+  UDPSocket::ReceivedBatch acks_;
+
+  /* in pacing mode, datagrams are spaced at the controller's
+     send_rate() instead of filling the window back to back */
+  bool pace_;
+  TimerFD pacing_timer_;
+  uint64_t next_send_time_ns_; /* monotonic clock */
+  uint64_t pacing_timer_deadline_ns_; /* 0 if not armed */
 
   uint64_t sequence_number_; /* next outgoing sequence number */
 
-  /* if network does not reorder or lose datagrams,
-     this is the sequence number that the sender
-     next expects will be acknowledged by the receiver */
-  uint64_t next_ack_expected_;
+  /* the datagrams in flight, so that one lost (say, to a
+     full droptail queue) stops counting against the window
+     as soon as later ones are acked */
+  SendLedger ledger_;
 
   void send_datagram( void );
-  void got_ack( const uint64_t timestamp, const ContestMessage & msg );
+  void send_queued_datagrams( void );
+  void got_ack( const uint64_t timestamp, const ContestMessageView & msg );
   bool window_is_open( void );
 
+  bool pacing_allows_send( void );
+  void schedule_next_send( void );
+  void arm_pacing_timer( void );
+
 public:
   DatagrumpSender( const char * const host, const char * const port,
-		   const bool debug );
+		   unique_ptr<Controller> && controller, const bool pace );
   int loop( void );
 };
 
@@ -42,29 +71,70 @@ int main( int argc, char *argv[] )
     abort();
   }
 
-  bool debug = false;
-  if ( argc == 4 and string( argv[ 3 ] ) == "debug" ) {
-    debug = true;
-  } else if ( argc == 3 ) {
-    /* do nothing */
-  } else {
-    cerr << "Usage: " << argv[ 0 ] << " HOST PORT [debug]" << endl;
+  bool debug = false, pace = false, usage_error = argc < 3;
+  string algorithm = Controller::algorithms().front().name;
+  ControllerParameters parameters;
+  for ( int i = 3; i < argc; i++ ) {
+    const string arg = argv[ i ];
+    if ( arg == "debug" ) {
+      debug = true;
+    } else if ( arg == "pace" ) {
+      pace = true;
+    } else if ( arg.find( '=' ) != string::npos ) {
+      try {
+	parameters.set( arg );
+      } catch ( const exception & e ) {
+	print_exception( e );
+	usage_error = true;
+      }
+    } else if ( any_of( Controller::algorithms().begin(), Controller::algorithms().end(),
+			[&] ( const Controller::Algorithm & a ) { return a.name == arg; } ) ) {
+      algorithm = arg;
+    } else {
+      usage_error = true;
+    }
+  }
+
+  if ( usage_error ) {
+    cerr << "Usage: " << argv[ 0 ] << " HOST PORT [debug] [pace] [ALGORITHM] [NAME=VALUE...]" << endl
+	 << endl << "Congestion-control algorithms:" << endl;
+    for ( const auto & a : Controller::algorithms() ) {
+      cerr << "  " << a.name << string( 8 - min( a.name.size(), size_t( 7 ) ), ' ' )
+	   << a.description << ( &a == &Controller::algorithms().front() ? " (default)" : "" ) << endl;
+    }
+    return EXIT_FAILURE;
+  }
+
+  /* the algorithm, with any tunables it was given */
+  unique_ptr<Controller> controller;
+  try {
+    controller = Controller::make( algorithm, debug, parameters );
+  } catch ( const exception & e ) {
+    print_exception( e );
     return EXIT_FAILURE;
   }
 
   /* create sender object to handle the accounting */
   /* all the interesting work is done by the Controller */
-  DatagrumpSender sender( argv[ 1 ], argv[ 2 ], debug );
+  DatagrumpSender sender( argv[ 1 ], argv[ 2 ], move( controller ), pace );
   return sender.loop();
 }
 
 DatagrumpSender::DatagrumpSender( const char * const host,
 				  const char * const port,
-				  const bool debug )
+				  unique_ptr<Controller> && controller,
+				  const bool pace )
   : socket_(),
-    controller_( debug ),
+    controller_( move( controller ) ),
+    datagram_( string( 1424, 'x' ) ),
+    outgoing_( BATCH_SIZE ),
+    acks_( BATCH_SIZE ),
+    pace_( pace ),
+    pacing_timer_(),
+    next_send_time_ns_( 0 ),
+    pacing_timer_deadline_ns_( 0 ),
     sequence_number_( 0 ),
-    next_ack_expected_( 0 )
+    ledger_()
 {
   /* turn on timestamps when socket receives a datagram */
   socket_.set_timestamps();
@@ -78,40 +148,90 @@ DatagrumpSender::DatagrumpSender( const char * const host,
 }
 
 void DatagrumpSender::got_ack( const uint64_t timestamp,
-			       const ContestMessage & ack )
+			       const ContestMessageView & ack )
 {
   if ( not ack.is_ack() ) {
     throw runtime_error( "sender got something other than an ack from the receiver" );
   }
 
-  /* Update sender's counter */
-  next_ack_expected_ = max( next_ack_expected_,
-			    ack.header.ack_sequence_number + 1 );
+  /* a delayed ack acknowledges several datagrams, each its own RTT sample */
+  const size_t acked_count = ack.acked_count();
+  for ( size_t i = 0; i < acked_count; i++ ) {
+    const AckedDatagram acked = ack.acked( i );
 
-  /* Inform congestion controller */
-  controller_.ack_received( ack.header.ack_sequence_number,
-			    ack.header.ack_send_timestamp,
-			    ack.header.ack_recv_timestamp,
-			    timestamp );
+    /* Update sender's ledger */
+    ledger_.acked( acked.sequence_number );
+
+    /* Inform congestion controller */
+    controller_->ack_received( acked.sequence_number,
+			      acked.send_timestamp,
+			      acked.recv_timestamp,
+			      timestamp );
+  }
 }
 
 void DatagrumpSender::send_datagram( void )
 {
-  /* All messages use the same dummy payload */
-  static const string dummy_payload( 1424, 'x' );
+  ContestMessage::Header header( sequence_number_++ );
+  header.send_timestamp = timestamp_ms();
+
+  /* write the header in front of the payload that is already in place;
+     the batch copies just the header, and points at the payload, which
+     never changes */
+  outgoing_.push( datagram_.serialize( header ), ContestMessage::Header::wire_length );
+  if ( outgoing_.full() ) {
+    send_queued_datagrams();
+  }
 
-  ContestMessage cm( sequence_number_++, dummy_payload );
-  cm.set_send_timestamp();
-  socket_.send( cm.to_string() );
+  ledger_.sent( header.sequence_number );
+  schedule_next_send();
 
   /* Inform congestion controller */
-  controller_.datagram_was_sent( cm.header.sequence_number,
-				 cm.header.send_timestamp );
+  controller_->datagram_was_sent( header.sequence_number,
+				 header.send_timestamp );
+}
+
+void DatagrumpSender::send_queued_datagrams( void )
+{
+  socket_.send( outgoing_ );
 }
 
 bool DatagrumpSender::window_is_open( void )
 {
-  return sequence_number_ - next_ack_expected_ < controller_.window_size();
+  return ledger_.in_flight() < controller_->window_size();
+}
+
+/* Has the pacing interval since the last datagram gone by? */
+bool DatagrumpSender::pacing_allows_send( void )
+{
+  return not pace_ or timestamp_ns() >= next_send_time_ns_;
+}
+
+/* Space the next datagram one interval (at the current rate) after this one */
+void DatagrumpSender::schedule_next_send( void )
+{
+  if ( not pace_ ) {
+    return;
+  }
+
+  const double rate = controller_->send_rate();
+  const uint64_t interval_ns = rate > 0 ? 1.0e9 / rate : 0;
+  const uint64_t now = timestamp_ns();
+
+  /* a sender that fell behind may catch up by one datagram, but not burst */
+  next_send_time_ns_ = max( next_send_time_ns_, now - min( now, interval_ns ) ) + interval_ns;
+}
+
+/* Wake up when the next paced datagram is due, if the window allows it */
+void DatagrumpSender::arm_pacing_timer( void )
+{
+  if ( not pace_ or not window_is_open() or pacing_allows_send()
+       or pacing_timer_deadline_ns_ == next_send_time_ns_ ) {
+    return;
+  }
+
+  pacing_timer_.arm_at( next_send_time_ns_ );
+  pacing_timer_deadline_ns_ = next_send_time_ns_;
 }
 
 int DatagrumpSender::loop( void )
@@ -120,35 +240,50 @@ int DatagrumpSender::loop( void )
   Poller poller;
 
   /* first rule: if the window is open, close it by
-     sending more datagrams */
+     sending more datagrams (when pacing, only those that are due) */
   poller.add_action( Action( socket_, Direction::Out, [&] () {
-	/* Close the window */
-	while ( window_is_open() ) {
+	/* Close the window, a batch of datagrams per system call */
+	while ( window_is_open() and pacing_allows_send() ) {
 	  send_datagram();
 	}
+	send_queued_datagrams();
 	return ResultType::Continue;
       },
-      /* We're only interested in this rule when the window is open */
-      [&] () { return window_is_open(); } ) );
+      /* We're only interested in this rule when the window is open
+	 (and, when pacing, the next datagram is due) */
+      [&] () { return window_is_open() and pacing_allows_send(); } ) );
 
   /* second rule: if sender receives an ack,
      process it and inform the controller
      (by using the sender's got_ack method) */
   poller.add_action( Action( socket_, Direction::In, [&] () {
-	const UDPSocket::received_datagram recd = socket_.recv();
-	const ContestMessage ack  = recd.payload;
-	got_ack( recd.timestamp, ack );
+	socket_.recv( acks_ );
+	for ( size_t i = 0; i < acks_.size(); i++ ) {
+	  const ContestMessageView ack( acks_.payload( i ), acks_.payload_length( i ) );
+	  got_ack( acks_.timestamp( i ), ack );
+	}
 	return ResultType::Continue;
       } ) );
 
-  /* Run these two rules forever */
+  /* third rule: when pacing, the timer says the next datagram is due
+     (and the first rule will then send it) */
+  poller.add_action( Action( pacing_timer_, Direction::In, [&] () {
+	pacing_timer_.read_expirations();
+	pacing_timer_deadline_ns_ = 0;
+	return ResultType::Continue;
+      } ) );
+
+  /* Run these rules forever */
   while ( true ) {
-    const auto ret = poller.poll( controller_.timeout_ms() );
+    arm_pacing_timer();
+
+    const auto ret = poller.poll( controller_->timeout_ms() );
     if ( ret.result == PollResult::Exit ) {
       return ret.exit_status;
     } else if ( ret.result == PollResult::Timeout ) {
       /* After a timeout, send one datagram to try to get things moving again */
       send_datagram();
+      send_queued_datagrams();
     }
   }
 }
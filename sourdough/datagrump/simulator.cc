@@ -0,0 +1,235 @@
+/* run the congestion-control contest in virtual time over a pair of
+   mahimahi traces, for every combination of the given algorithms,
+   tunables, delays and pacing modes, spread across the machine's cores */
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <getopt.h>
+
+#include "link_simulation.hh"
+#include "controller.hh"
+#include "util.hh"
+
+using namespace std;
+
+/* split a comma-separated list */
+static vector<string> split( const string & list )
+{
+  vector<string> items;
+  stringstream stream( list );
+  string item;
+  while ( getline( stream, item, ',' ) ) {
+    items.push_back( item );
+  }
+  return items;
+}
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " UPLINK-TRACE DOWNLINK-TRACE [--algorithm=NAME,...|all]"
+       << " [--parameter=NAME=VALUE,...]... [--delay=MS,...] [--pace=no,yes] [--jobs=N]" << endl
+       << "\t[--uplink-queue=infinite|droptail --uplink-queue-args=packets=N|bytes=N]" << endl
+       << endl << "(For run-contest's network, the uplink is Verizon-LTE-short.down"
+       << " and the downlink Verizon-LTE-short.up, with a delay of 20 ms.)" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  vector<string> algorithms = { Controller::algorithms().front().name };
+  vector<uint64_t> delays = { 20 };
+  vector<bool> pace_modes = { false };
+  vector<ControllerParameters> parameter_sets = { ControllerParameters() };
+  unsigned int jobs = max( thread::hardware_concurrency(), 1u );
+  string uplink_queue = "infinite", uplink_queue_args;
+
+  const option options[] = {
+    { "algorithm", required_argument, nullptr, 'a' },
+    { "parameter", required_argument, nullptr, 'P' },
+    { "delay",     required_argument, nullptr, 'd' },
+    { "pace",      required_argument, nullptr, 'p' },
+    { "jobs",      required_argument, nullptr, 'j' },
+    { "uplink-queue",      required_argument, nullptr, 'q' },
+    { "uplink-queue-args", required_argument, nullptr, 'Q' },
+    { 0,           0,                 nullptr, 0 }
+  };
+
+  try {
+    while ( true ) {
+      const int opt = getopt_long( argc, argv, "", options, nullptr );
+      if ( opt == -1 ) {
+	break;
+      }
+
+      switch ( opt ) {
+      case 'a':
+	algorithms.clear();
+	if ( string( optarg ) == "all" ) {
+	  for ( const auto & algorithm : Controller::algorithms() ) {
+	    algorithms.push_back( algorithm.name );
+	  }
+	} else {
+	  algorithms = split( optarg );
+	}
+	break;
+      case 'P':
+	{
+	  /* each value of this tunable with each set so far */
+	  const string argument = optarg;
+	  const size_t equals = argument.find( '=' );
+	  const string name = argument.substr( 0, equals == string::npos ? 0 : equals + 1 );
+	  vector<ControllerParameters> product;
+	  for ( const auto & value : split( argument.substr( name.size() ) ) ) {
+	    for ( auto parameters : parameter_sets ) {
+	      parameters.set( name + value );
+	      product.push_back( parameters );
+	    }
+	  }
+	  if ( product.empty() ) {
+	    throw runtime_error( "--parameter takes NAME=VALUE,..." );
+	  }
+	  parameter_sets = product;
+	}
+	break;
+      case 'd':
+	delays.clear();
+	for ( const auto & delay : split( optarg ) ) {
+	  delays.push_back( stoull( delay ) );
+	}
+	break;
+      case 'p':
+	pace_modes.clear();
+	for ( const auto & mode : split( optarg ) ) {
+	  if ( mode != "yes" and mode != "no" ) {
+	    throw runtime_error( "--pace takes yes, no or both" );
+	  }
+	  pace_modes.push_back( mode == "yes" );
+	}
+	break;
+      case 'j':
+	jobs = max( stoul( optarg ), 1ul );
+	break;
+      case 'q':
+	uplink_queue = optarg;
+	break;
+      case 'Q':
+	uplink_queue_args = optarg;
+	break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+
+    if ( argc - optind != 2 ) {
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+
+    /* as mm-link takes them */
+    QueueLimits uplink_queue_limits = QueueLimits();
+    if ( uplink_queue == "droptail" ) {
+      uplink_queue_limits = QueueLimits::parse( uplink_queue_args );
+    } else if ( uplink_queue != "infinite" or not uplink_queue_args.empty() ) {
+      throw runtime_error( "the simulated uplink's queue is infinite or droptail (with arguments)" );
+    }
+
+    /* catch misspelled algorithms and tunables before spending any time */
+    for ( const auto & algorithm : algorithms ) {
+      for ( const auto & parameters : parameter_sets ) {
+	Controller::make( algorithm, false, parameters );
+      }
+    }
+
+    const LinkTrace uplink( argv[ optind ] ), downlink( argv[ optind + 1 ] );
+
+    vector<Scenario> scenarios;
+    for ( const auto & algorithm : algorithms ) {
+      for ( const auto & parameters : parameter_sets ) {
+	for ( const auto delay : delays ) {
+	  for ( const auto pace : pace_modes ) {
+	    scenarios.push_back( { algorithm, parameters, pace, delay, uplink_queue_limits } );
+	  }
+	}
+      }
+    }
+
+    /* each worker takes the next scenario until there are none left */
+    vector<SimulationResult> results( scenarios.size() );
+    vector<double> wall_times( scenarios.size() );
+    vector<exception_ptr> errors( scenarios.size() );
+    atomic<size_t> next_scenario( 0 );
+
+    const auto start = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for ( unsigned int i = 0; i < min( size_t( jobs ), scenarios.size() ); i++ ) {
+      workers.emplace_back( [&] () {
+	  for ( size_t j = next_scenario++; j < scenarios.size(); j = next_scenario++ ) {
+	    const auto scenario_start = chrono::steady_clock::now();
+	    try {
+	      results[ j ] = simulate( uplink, downlink, scenarios[ j ] );
+	    } catch ( ... ) {
+	      errors[ j ] = current_exception();
+	    }
+	    wall_times[ j ] = chrono::duration<double>( chrono::steady_clock::now() - scenario_start ).count();
+	  } } );
+    }
+
+    for ( auto & worker : workers ) {
+      worker.join();
+    }
+
+    const double elapsed = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+    for ( const auto & error : errors ) {
+      if ( error ) {
+	rethrow_exception( error );
+      }
+    }
+
+    cout << left << setw( 10 ) << "algorithm" << right << setw( 6 ) << "pace" << setw( 7 ) << "delay"
+	 << setw( 10 ) << "capacity" << setw( 12 ) << "throughput" << setw( 8 ) << "util"
+	 << setw( 10 ) << "p95 queue" << setw( 11 ) << "p95 signal" << setw( 9 ) << "power"
+	 << setw( 9 ) << "dropped" << setw( 10 ) << "sim time" << "  parameters" << endl;
+    cout << left << setw( 10 ) << "" << right << setw( 6 ) << "" << setw( 7 ) << "(ms)"
+	 << setw( 10 ) << "(Mbit/s)" << setw( 12 ) << "(Mbit/s)" << setw( 8 ) << "(%)"
+	 << setw( 10 ) << "(ms)" << setw( 11 ) << "(ms)" << setw( 9 ) << ""
+	 << setw( 9 ) << "(%)" << setw( 10 ) << "(s)" << endl;
+
+    double virtual_seconds = 0;
+    for ( size_t i = 0; i < scenarios.size(); i++ ) {
+      const Scenario & s = scenarios[ i ];
+      const SimulationResult & r = results[ i ];
+      virtual_seconds += r.duration_s;
+
+      cout << left << setw( 10 ) << s.algorithm << right << setw( 6 ) << ( s.pace ? "yes" : "no" )
+	   << setw( 7 ) << s.one_way_delay_ms << fixed << setprecision( 2 )
+	   << setw( 10 ) << r.capacity_mbps << setw( 12 ) << r.throughput_mbps
+	   << setprecision( 1 ) << setw( 8 ) << 100 * r.throughput_mbps / r.capacity_mbps
+	   << setw( 10 ) << r.queueing_delay_p95_ms << setw( 11 ) << r.signal_delay_p95_ms
+	   << setprecision( 2 ) << setw( 9 ) << r.power
+	   << setw( 9 ) << 100.0 * r.datagrams_dropped / max( r.datagrams_sent, uint64_t( 1 ) )
+	   << setw( 10 ) << wall_times[ i ] << "  " << s.parameters.to_string() << endl;
+    }
+
+    cerr << endl << scenarios.size() << " runs (" << virtual_seconds << " s of traffic) in "
+	 << elapsed << " s on " << workers.size() << " threads" << endl;
+  } catch ( const exception & e ) {
+    print_exception( e );
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include <stdexcept>
+
+#include "sliding_regression.hh"
+
+using namespace std;
+
+SlidingRegression::SlidingRegression( const size_t capacity )
+  : samples_( capacity ), oldest_( 0 ), count_( 0 ),
+    s_x_( 0 ), s_y_( 0 ), s_xx_( 0 ), s_xy_( 0 )
+{
+  if ( capacity < 2 ) {
+    throw runtime_error( "SlidingRegression needs room for at least two samples" );
+  }
+}
+
+/* Drop the oldest sample, and move the origin of x to the next one */
+void SlidingRegression::remove_oldest( void )
+{
+  const Sample & removed = samples_[ oldest_ ];
+  /* at the origin, so its x is 0 and it adds nothing to s_x, s_xx or s_xy */
+  s_y_ -= removed.y;
+
+  oldest_ = ( oldest_ + 1 ) % samples_.size();
+  count_--;
+  if ( count_ == 0 ) {
+    return;
+  }
+
+  /* with d the new origin less the old, sum (x - d)^2 = s_xx - 2 d s_x + n d^2, and so on */
+  const int64_t d = samples_[ oldest_ ].x - removed.x;
+  const int64_t n = count_;
+  s_xx_ += d * ( n * d - 2 * s_x_ );
+  s_xy_ -= d * s_y_;
+  s_x_ -= n * d;
+}
+
+/* Add a sample */
+void SlidingRegression::add( const uint64_t x, const int64_t y )
+{
+  if ( full() ) {
+    remove_oldest();
+  }
+
+  Sample & sample = samples_[ ( oldest_ + count_ ) % samples_.size() ];
+  sample = { int64_t( x ), y };
+  count_++;
+
+  const int64_t dx = sample.x - samples_[ oldest_ ].x;
+  s_x_ += dx;
+  s_y_ += y;
+  s_xx_ += dx * dx;
+  s_xy_ += dx * y;
+}
+
+/* The fitted line's slope */
+double SlidingRegression::slope( void ) const
+{
+  if ( count_ < 2 ) {
+    return 0;
+  }
+
+  /* the centred sums, n S_xx = n s_xx - s_x^2 and n S_xy = n s_xy - s_x s_y */
+  const double n = count_;
+  const double centred_xx = n * s_xx_ - double( s_x_ ) * s_x_;
+  const double centred_xy = n * s_xy_ - double( s_x_ ) * s_y_;
+  return centred_xx > 0 ? centred_xy / centred_xx : 0;
+}
+
+/* The fitted line at x */
+double SlidingRegression::predict( const uint64_t x ) const
+{
+  if ( count_ == 0 ) {
+    return 0;
+  }
+
+  /* through (mean x, mean y), measured from the origin */
+  const double n = count_;
+  const double dx = double( int64_t( x ) - samples_[ oldest_ ].x ) - s_x_ / n;
+  return s_y_ / n + slope() * dx;
+}
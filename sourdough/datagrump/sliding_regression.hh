@@ -0,0 +1,47 @@
+#ifndef SLIDING_REGRESSION_HH
+#define SLIDING_REGRESSION_HH
+
+#include <cstdint>
+#include <vector>
+
+/* Least-squares line through the most recent (x, y) samples, kept as
+   running sums so that adding a sample costs the same however many
+   are kept. The sums are integers, taken with x relative to the
+   oldest sample's, so removing a sample undoes adding it exactly and
+   they don't lose precision as x grows over a long run. (That needs
+   capacity * span^2 of the samples' x to fit in 63 bits: about 26
+   hours of milliseconds for a thousand samples.) */
+
+class SlidingRegression
+{
+private:
+  struct Sample
+  {
+    int64_t x, y;
+  };
+
+  std::vector<Sample> samples_; /* a ring, oldest at oldest_ */
+  size_t oldest_, count_;
+
+  /* over the samples, with x less the oldest sample's */
+  int64_t s_x_, s_y_, s_xx_, s_xy_;
+
+  void remove_oldest( void );
+
+public:
+  SlidingRegression( const size_t capacity );
+
+  /* add a sample, replacing the oldest once there are capacity of them */
+  void add( const uint64_t x, const int64_t y );
+
+  size_t size( void ) const { return count_; }
+  bool full( void ) const { return count_ == samples_.size(); }
+
+  /* the fitted line at x (the mean y if the samples' x are all the same) */
+  double predict( const uint64_t x ) const;
+
+  /* the fitted line's slope */
+  double slope( void ) const;
+};
+
+#endif /* SLIDING_REGRESSION_HH */
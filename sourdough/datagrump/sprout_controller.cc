@@ -0,0 +1,213 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "sprout_controller.hh"
+
+using namespace std;
+
+const uint64_t TICK = 20;			// ms between belief updates
+const unsigned int RATE_BINS = 256;		// grid of possible link rates...
+const double MAX_RATE = 2000;			// ...up to this many datagrams/s
+const double VOLATILITY = 200;			// datagrams/s the rate wanders in a second (std. dev.)
+const uint64_t TARGET_DELAY = 100;		// ms a datagram should take to get through
+const double FORECAST_PERCENTILE = 0.05;	// how cautious the forecast is
+const unsigned int MIN_WIN = 1;
+const unsigned int MAX_CATCH_UP_TICKS = 50;	// after a long gap the belief is diffuse anyway
+const double NEGLIGIBLE = 1e-12;		// probability not worth diffusing
+
+/* Gaussian weights for a random walk of the given spread, in bins */
+static vector<double> gaussian_kernel( const double sigma )
+{
+  const int half_width = ceil( 4 * sigma );
+  vector<double> kernel( 2 * half_width + 1 );
+
+  double total = 0;
+  for ( int i = -half_width; i <= half_width; i++ ) {
+    kernel[ i + half_width ] = exp( -0.5 * i * i / ( sigma * sigma ) );
+    total += kernel[ i + half_width ];
+  }
+
+  for ( auto & weight : kernel ) {
+    weight /= total;
+  }
+
+  return kernel;
+}
+
+/* Default constructor */
+SproutController::SproutController( const bool debug, const ControllerParameters & )
+  : Controller( debug ),
+    belief_( RATE_BINS, 1.0 / RATE_BINS ), log_rate_( RATE_BINS ),
+    tick_kernel_(), forecast_kernel_(), scratch_( RATE_BINS ),
+    tick_end_( 0 ), tick_deliveries_( 0 ),
+    next_sequence_number_( 0 ), acked_through_( 0 ),
+    min_rtt_( 0 ), latest_rtt_( 0 ),
+    forecast_rate_( 0 ), window_size_( MIN_WIN )
+{
+  const double bin_width = MAX_RATE / RATE_BINS;
+  tick_kernel_ = gaussian_kernel( VOLATILITY * sqrt( TICK / 1000.0 ) / bin_width );
+  forecast_kernel_ = gaussian_kernel( VOLATILITY * sqrt( TARGET_DELAY / 1000.0 ) / bin_width );
+
+  for ( unsigned int i = 0; i < RATE_BINS; i++ ) {
+    log_rate_[ i ] = log( ( i + 0.5 ) * bin_width * TICK / 1000.0 );
+  }
+
+  forecast();
+}
+
+/* Get current window size, in datagrams */
+unsigned int SproutController::current_window( void )
+{
+  return window_size_;
+}
+
+/* A datagram was sent */
+void SproutController::record_sent( const uint64_t sequence_number,
+				    const uint64_t send_timestamp )
+{
+  advance_to( send_timestamp );
+  next_sequence_number_ = max( next_sequence_number_, sequence_number + 1 );
+}
+
+/* An ack was received */
+void SproutController::record_ack( const uint64_t sequence_number_acked,
+				   const uint64_t send_timestamp_acked,
+				   const uint64_t,
+				   const uint64_t timestamp_ack_received )
+{
+  advance_to( timestamp_ack_received );
+  tick_deliveries_++;
+  acked_through_ = max( acked_through_, sequence_number_acked + 1 );
+
+  latest_rtt_ = timestamp_ack_received - send_timestamp_acked;
+  if ( min_rtt_ == 0 or latest_rtt_ < min_rtt_ ) {
+    min_rtt_ = max( latest_rtt_, uint64_t( 1 ) );
+  }
+}
+
+/* Close out every tick that has ended by now */
+void SproutController::advance_to( const uint64_t now )
+{
+  if ( tick_end_ == 0 ) {
+    tick_end_ = now + TICK;
+    return;
+  }
+
+  for ( unsigned int ticks = 0; now >= tick_end_; ticks++ ) {
+    if ( ticks == MAX_CATCH_UP_TICKS ) {
+      tick_end_ = now + TICK;
+      break;
+    }
+
+    tick();
+    tick_deliveries_ = 0;
+    tick_end_ += TICK;
+  }
+}
+
+/* The rate may have moved; then, if the link had datagrams to deliver,
+   weigh each rate by how likely it made this tick's deliveries */
+void SproutController::tick( void )
+{
+  diffuse( tick_kernel_, scratch_ );
+  belief_.swap( scratch_ );
+
+  if ( next_sequence_number_ > acked_through_ ) {
+    /* a datagram that waited more than a tick in the queue means it never ran dry */
+    observe( latest_rtt_ > min_rtt_ + TICK );
+  }
+
+  forecast();
+}
+
+/* Bayes' rule with the Poisson likelihood of this tick's deliveries
+   (exactly that many if the link was busy, else at least that many) */
+void SproutController::observe( const bool link_was_busy )
+{
+  if ( not link_was_busy and tick_deliveries_ == 0 ) {
+    return; /* nothing learned */
+  }
+
+  for ( unsigned int i = 0; i < RATE_BINS; i++ ) {
+    const double expected = exp( log_rate_[ i ] );
+
+    if ( link_was_busy ) {
+      /* in logs, for range; normalized below */
+      scratch_[ i ] = tick_deliveries_ * log_rate_[ i ] - expected;
+    } else {
+      /* P(X >= k) = 1 - P(X < k) */
+      double term = exp( -expected ), cdf = 0;
+      for ( unsigned int j = 0; j < tick_deliveries_; j++ ) {
+	cdf += term;
+	term *= expected / ( j + 1 );
+      }
+      scratch_[ i ] = log( max( 1 - cdf, 1e-300 ) );
+    }
+  }
+
+  const double max_log_likelihood = *max_element( scratch_.begin(), scratch_.end() );
+
+  double total = 0;
+  for ( unsigned int i = 0; i < RATE_BINS; i++ ) {
+    belief_[ i ] *= exp( scratch_[ i ] - max_log_likelihood );
+    total += belief_[ i ];
+  }
+
+  if ( total > 0 ) {
+    for ( auto & probability : belief_ ) {
+      probability /= total;
+    }
+  } else {
+    fill( belief_.begin(), belief_.end(), 1.0 / RATE_BINS );
+  }
+}
+
+/* Spread the belief by a random walk (rates past the ends of the grid stay at the ends) */
+void SproutController::diffuse( const vector<double> & kernel, vector<double> & output )
+{
+  const int half_width = kernel.size() / 2;
+  const int last = RATE_BINS - 1;
+
+  fill( output.begin(), output.end(), 0.0 );
+  for ( int i = 0; i <= last; i++ ) {
+    if ( belief_[ i ] < NEGLIGIBLE ) {
+      continue;
+    }
+    for ( int j = -half_width; j <= half_width; j++ ) {
+      output[ min( max( i + j, 0 ), last ) ] += belief_[ i ] * kernel[ j + half_width ];
+    }
+  }
+}
+
+/* The rate the link will beat with 95% probability over the target
+   delay, and the datagrams it will deliver in that time */
+void SproutController::forecast( void )
+{
+  diffuse( forecast_kernel_, scratch_ );
+
+  unsigned int bin = 0;
+  for ( double cumulative = scratch_[ 0 ];
+	cumulative < FORECAST_PERCENTILE and bin + 1 < RATE_BINS;
+	cumulative += scratch_[ ++bin ] ) {}
+
+  forecast_rate_ = bin * MAX_RATE / RATE_BINS;
+  window_size_ = max( MIN_WIN, static_cast<unsigned int>( forecast_rate_ * TARGET_DELAY / 1000 ) );
+
+  if ( debug() ) {
+    cerr << "Forecast " << forecast_rate_ << " datagrams/s, window " << window_size_ << endl;
+  }
+}
+
+/* How long to wait (in milliseconds) if there are no acks
+   before sending one more datagram (a probe each tick, as Sprout sends) */
+unsigned int SproutController::timeout_ms( void )
+{
+  return TICK;
+}
+
+/* Target sending rate, in datagrams per second */
+double SproutController::send_rate( void )
+{
+  return forecast_rate_;
+}
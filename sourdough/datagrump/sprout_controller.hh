@@ -0,0 +1,66 @@
+#ifndef SPROUT_CONTROLLER_HH
+#define SPROUT_CONTROLLER_HH
+
+#include <cstdint>
+#include <vector>
+
+#include "controller.hh"
+
+/* Sprout-style stochastic forecasting: the link delivers datagrams as
+   a Poisson process whose rate wanders in Brownian motion. A belief
+   (a probability for each of a grid of rates) is diffused every tick
+   and updated with the number of datagrams acked in it. The window is
+   how many datagrams the link will deliver within the target delay
+   with 95% probability.
+
+   Deliveries only measure the link while there is a queue for it to
+   drain; while the RTT says there isn't, a tick's count is taken as
+   a lower bound on what the link could have delivered.
+
+   Unlike Sprout, which infers the rate at the receiver and sends the
+   forecast back, this runs at the sender on the acks, a round trip
+   later. */
+
+class SproutController : public Controller
+{
+private:
+  std::vector<double> belief_;           /* probability of each rate bin */
+  std::vector<double> log_rate_;         /* log of each bin's rate, per tick */
+  std::vector<double> tick_kernel_;      /* diffusion over one tick */
+  std::vector<double> forecast_kernel_;  /* diffusion over the target delay */
+  std::vector<double> scratch_;
+
+  uint64_t tick_end_;             /* ms; 0 before the first datagram */
+  unsigned int tick_deliveries_;  /* acks so far this tick */
+
+  uint64_t next_sequence_number_; /* one past the latest sent */
+  uint64_t acked_through_;        /* one past the largest acked */
+
+  uint64_t min_rtt_;              /* ms (0 before the first ack) */
+  uint64_t latest_rtt_;
+
+  double forecast_rate_;          /* datagrams/s, the cautious (5th percentile) rate */
+  unsigned int window_size_;
+
+  unsigned int current_window( void ) override;
+  void record_sent( const uint64_t sequence_number,
+		    const uint64_t send_timestamp ) override;
+  void record_ack( const uint64_t sequence_number_acked,
+		   const uint64_t send_timestamp_acked,
+		   const uint64_t recv_timestamp_acked,
+		   const uint64_t timestamp_ack_received ) override;
+
+  void advance_to( const uint64_t now );
+  void tick( void );
+  void observe( const bool link_was_busy );
+  void diffuse( const std::vector<double> & kernel, std::vector<double> & output );
+  void forecast( void );
+
+public:
+  SproutController( const bool debug, const ControllerParameters & parameters );
+
+  unsigned int timeout_ms( void ) override;
+  double send_rate( void ) override;
+};
+
+#endif
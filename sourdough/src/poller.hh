@@ -3,8 +3,12 @@
 
 #include <functional>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
 
 #include <poll.h>
+#include <sys/epoll.h>
 
 #include "file_descriptor.hh"
 
@@ -29,21 +33,39 @@ public:
     std::function<bool(void)> when_interested;
     bool active;
 
+    /* false if when_interested() is the default (always true), so
+       interest can only change when the action itself is serviced */
+    bool conditional;
+
+    Action( FileDescriptor & s_fd,
+	    const PollDirection & s_direction,
+	    const CallbackType & s_callback )
+      : fd( s_fd ), direction( s_direction ), callback( s_callback ),
+	when_interested( [] () { return true; } ), active( true ),
+	conditional( false ) {}
+
     Action( FileDescriptor & s_fd,
 	    const PollDirection & s_direction,
 	    const CallbackType & s_callback,
-	    const std::function<bool(void)> & s_when_interested = [] () { return true; } )
+	    const std::function<bool(void)> & s_when_interested )
       : fd( s_fd ), direction( s_direction ), callback( s_callback ),
-	when_interested( s_when_interested ), active( true ) {}
+	when_interested( s_when_interested ), active( true ),
+	conditional( true ) {}
 
     unsigned int service_count( void ) const;
+
+    /* should this action be polled right now? */
+    bool interested( void ) const;
   };
 
-private:
-  std::vector< Action > actions_;
-  std::vector< pollfd > pollfds_;
+  /* poll(2) rebuilds the whole interest set on every call; epoll(7)
+     keeps it in the kernel and is only told when it changes. Epoll
+     rechecks an fd's interest only after that fd's own actions run
+     (or on every poll, for an action with a when_interested), so a
+     loop may opt in only if no callback makes another fd reach EOF
+     or cancels another fd's action */
+  enum class Backend { Poll, Epoll };
 
-public:
   struct Result
   {
     enum class Type { Success, Timeout, Exit } result;
@@ -52,9 +74,49 @@ public:
       : result( s_result ), exit_status( s_status ) {}
   };
 
-  Poller() : actions_(), pollfds_() {}
+private:
+  Backend backend_;
+
+  std::vector< Action > actions_;
+
+  /* poll(2) backend: one pollfd per action */
+  std::vector< pollfd > pollfds_;
+
+  /* epoll(7) backend: one registration per fd, shared by its actions */
+  struct Registration
+  {
+    std::vector< size_t > actions;  /* indices into actions_ */
+    uint32_t registered_events;     /* what the kernel currently has */
+    bool added;                     /* has EPOLL_CTL_ADD been done? */
+    bool conditional;               /* does any action have a when_interested()? */
+    bool dirty;                     /* serviced since interest was last computed */
+
+    Registration() : actions(), registered_events( 0 ), added( false ),
+		     conditional( false ), dirty( false ) {}
+  };
+
+  std::unique_ptr< FileDescriptor > epoll_fd_;
+  std::unordered_map< int, Registration > registrations_;
+  std::vector< int > conditional_fds_, dirty_fds_;
+  std::vector< short > action_events_; /* per action, what we last asked for */
+  unsigned int interested_actions_;
+  std::vector< epoll_event > ready_events_;
+
+  void mark_dirty( Registration & registration, const int fd_num );
+  void update_registration( const int fd_num, Registration & registration );
+  Result run_callback( const size_t action_index );
+
+  Result poll_with_poll( const int & timeout_ms );
+  Result poll_with_epoll( const int & timeout_ms );
+
+public:
+  Poller( const Backend s_backend = Backend::Poll );
   void add_action( Action action );
   Result poll( const int & timeout_ms );
+
+  /* forbid copying */
+  Poller( const Poller & other ) = delete;
+  Poller & operator=( const Poller & other ) = delete;
 };
 
 namespace PollerShortNames {
@@ -75,6 +75,38 @@ void Socket::connect( const Address & address )
 				    address.size() ) );
 }
 
+/* room for the control messages of one datagram (just the timestamp) */
+static const size_t CONTROL_SIZE = 256;
+
+/* kernel timestamp of a received datagram (if it has one), in ms */
+static uint64_t kernel_timestamp( msghdr & header )
+{
+  uint64_t timestamp = -1;
+
+  /* find the timestamp header (if there is one) */
+  cmsghdr *ts_hdr = CMSG_FIRSTHDR( &header );
+  while ( ts_hdr ) {
+    if ( ts_hdr->cmsg_level == SOL_SOCKET
+	 and ts_hdr->cmsg_type == SO_TIMESTAMPNS ) {
+      const timespec * const kernel_time = reinterpret_cast<timespec *>( CMSG_DATA( ts_hdr ) );
+      timestamp = timestamp_ms( *kernel_time );
+    }
+    ts_hdr = CMSG_NXTHDR( &header, ts_hdr );
+  }
+
+  return timestamp;
+}
+
+/* make sure we got the whole datagram */
+static void check_flags( const msghdr & header )
+{
+  if ( header.msg_flags & MSG_TRUNC ) {
+    throw runtime_error( "recvfrom (oversized datagram)" );
+  } else if ( header.msg_flags ) {
+    throw runtime_error( "recvfrom (unhandled flag)" );
+  }
+}
+
 /* receive datagram and where it came from */
 UDPSocket::received_datagram UDPSocket::recv( void )
 {
@@ -86,7 +118,7 @@ UDPSocket::received_datagram UDPSocket::recv( void )
   iovec msg_iovec; zero( msg_iovec );
 
   char msg_payload[ RECEIVE_MTU ];
-  char msg_control[ RECEIVE_MTU ];
+  char msg_control[ CONTROL_SIZE ];
 
   /* prepare to get the source address */
   header.msg_name = &datagram_source_address;
@@ -108,29 +140,11 @@ UDPSocket::received_datagram UDPSocket::recv( void )
 
   register_read();
 
-  /* make sure we got the whole datagram */
-  if ( header.msg_flags & MSG_TRUNC ) {
-    throw runtime_error( "recvfrom (oversized datagram)" );
-  } else if ( header.msg_flags ) {
-    throw runtime_error( "recvfrom (unhandled flag)" );
-  }
-
-  uint64_t timestamp = -1;
-
-  /* find the timestamp header (if there is one) */
-  cmsghdr *ts_hdr = CMSG_FIRSTHDR( &header );
-  while ( ts_hdr ) {
-    if ( ts_hdr->cmsg_level == SOL_SOCKET
-	 and ts_hdr->cmsg_type == SO_TIMESTAMPNS ) {
-      const timespec * const kernel_time = reinterpret_cast<timespec *>( CMSG_DATA( ts_hdr ) );
-      timestamp = timestamp_ms( *kernel_time );
-    }
-    ts_hdr = CMSG_NXTHDR( &header, ts_hdr );
-  }
+  check_flags( header );
 
   received_datagram ret = { Address( datagram_source_address,
 				     header.msg_namelen ),
-			    timestamp,
+			    kernel_timestamp( header ),
 			    string( msg_payload, recv_len ) };
 
   return ret;
@@ -170,6 +184,156 @@ void UDPSocket::send( const string & payload )
   }
 }
 
+/* buffers for capacity datagrams of up to mtu bytes each */
+UDPSocket::ReceivedBatch::ReceivedBatch( const size_t capacity, const size_t mtu )
+  : headers_( capacity ),
+    iovecs_( capacity ),
+    addresses_( capacity ),
+    payloads_( capacity * mtu ),
+    controls_( capacity * CONTROL_SIZE ),
+    timestamps_( capacity ),
+    count_( 0 )
+{
+  for ( size_t i = 0; i < capacity; i++ ) {
+    zero( headers_[ i ] );
+    zero( iovecs_[ i ] );
+
+    /* prepare to get the payload */
+    iovecs_[ i ].iov_base = &payloads_[ i * mtu ];
+    iovecs_[ i ].iov_len = mtu;
+    headers_[ i ].msg_hdr.msg_iov = &iovecs_[ i ];
+    headers_[ i ].msg_hdr.msg_iovlen = 1;
+
+    /* prepare to get the source address and timestamp */
+    headers_[ i ].msg_hdr.msg_name = &addresses_[ i ];
+    headers_[ i ].msg_hdr.msg_control = &controls_[ i * CONTROL_SIZE ];
+  }
+}
+
+Address UDPSocket::ReceivedBatch::source_address( const size_t i ) const
+{
+  return Address( addresses_.at( i ), headers_.at( i ).msg_hdr.msg_namelen );
+}
+
+const char * UDPSocket::ReceivedBatch::payload( const size_t i ) const
+{
+  return static_cast<const char *>( iovecs_.at( i ).iov_base );
+}
+
+size_t UDPSocket::ReceivedBatch::payload_length( const size_t i ) const
+{
+  return headers_.at( i ).msg_len;
+}
+
+/* receive several datagrams, their timestamps, and where they came from */
+void UDPSocket::recv( ReceivedBatch & batch )
+{
+  /* the kernel shrinks these to what it filled in */
+  for ( auto & header : batch.headers_ ) {
+    header.msg_hdr.msg_namelen = sizeof( Address::raw );
+    header.msg_hdr.msg_controllen = CONTROL_SIZE;
+  }
+
+  /* call recvmmsg, blocking only until the first datagram arrives */
+  batch.count_ = SystemCall( "recvmmsg",
+			     recvmmsg( fd_num(), batch.headers_.data(), batch.headers_.size(),
+				       MSG_WAITFORONE, nullptr ) );
+
+  for ( size_t i = 0; i < batch.count_; i++ ) {
+    register_read();
+    check_flags( batch.headers_[ i ].msg_hdr );
+    batch.timestamps_[ i ] = kernel_timestamp( batch.headers_[ i ].msg_hdr );
+  }
+}
+
+UDPSocket::SendBatch::SendBatch( const size_t capacity )
+  : payloads_( capacity ),
+    tails_( capacity ),
+    destinations_( capacity ),
+    headers_( capacity ),
+    iovecs_( 2 * capacity ),
+    count_( 0 )
+{}
+
+/* queue a datagram to the connected address */
+void UDPSocket::SendBatch::push( const string & payload )
+{
+  push( Address(), payload );
+}
+
+/* queue a datagram to a specified address */
+void UDPSocket::SendBatch::push( const Address & destination, const string & payload )
+{
+  if ( full() ) {
+    throw runtime_error( "SendBatch is full" );
+  }
+
+  /* assign() reuses the buffer once it has grown */
+  payloads_[ count_ ].assign( payload );
+  tails_[ count_ ] = make_pair( nullptr, 0 );
+  destinations_[ count_ ] = destination;
+  count_++;
+}
+
+/* queue a datagram to the connected address, copying only its header */
+void UDPSocket::SendBatch::push( const string & datagram, const size_t header_length )
+{
+  if ( full() ) {
+    throw runtime_error( "SendBatch is full" );
+  }
+
+  if ( header_length > datagram.size() ) {
+    throw runtime_error( "SendBatch: header longer than the datagram" );
+  }
+
+  payloads_[ count_ ].assign( datagram, 0, header_length );
+  tails_[ count_ ] = make_pair( datagram.data() + header_length, datagram.size() - header_length );
+  destinations_[ count_ ] = Address();
+  count_++;
+}
+
+/* send the queued datagrams with as few calls to sendmmsg as it takes */
+void UDPSocket::send( SendBatch & batch )
+{
+  for ( size_t i = 0; i < batch.count_; i++ ) {
+    mmsghdr & header = batch.headers_[ i ];
+    zero( header );
+
+    iovec * const iov = &batch.iovecs_[ 2 * i ];
+    iov[ 0 ].iov_base = &batch.payloads_[ i ][ 0 ];
+    iov[ 0 ].iov_len = batch.payloads_[ i ].size();
+    iov[ 1 ].iov_base = const_cast<char *>( batch.tails_[ i ].first );
+    iov[ 1 ].iov_len = batch.tails_[ i ].second;
+    header.msg_hdr.msg_iov = iov;
+    header.msg_hdr.msg_iovlen = iov[ 1 ].iov_len ? 2 : 1;
+
+    const Address & destination = batch.destinations_[ i ];
+    if ( destination.size() ) {
+      header.msg_hdr.msg_name = const_cast<sockaddr *>( &destination.to_sockaddr() );
+      header.msg_hdr.msg_namelen = destination.size();
+    }
+  }
+
+  size_t sent = 0;
+  while ( sent < batch.count_ ) {
+    const size_t count = SystemCall( "sendmmsg",
+				     sendmmsg( fd_num(), &batch.headers_[ sent ],
+					       batch.count_ - sent, 0 ) );
+
+    for ( size_t i = sent; i < sent + count; i++ ) {
+      register_write();
+
+      if ( batch.headers_[ i ].msg_len != batch.payloads_[ i ].size() + batch.tails_[ i ].second ) {
+	throw runtime_error( "datagram payload too big for sendmmsg()" );
+      }
+    }
+
+    sent += count;
+  }
+
+  batch.count_ = 0;
+}
+
 /* mark the socket as listening for incoming connections */
 void TCPSocket::listen( const int backlog )
 {
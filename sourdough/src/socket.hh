@@ -2,6 +2,11 @@
 #define SOCKET_HH
 
 #include <functional>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include <sys/socket.h>
 
 #include "address.hh"
 #include "file_descriptor.hh"
@@ -63,6 +68,81 @@ public:
 
   /* turn on timestamps on receipt */
   void set_timestamps( void );
+
+  /* buffers for several datagrams received in one system call,
+     reused from one recv() to the next */
+  class ReceivedBatch
+  {
+  private:
+    friend class UDPSocket;
+
+    std::vector<mmsghdr> headers_;
+    std::vector<iovec> iovecs_;
+    std::vector<Address::raw> addresses_;
+    std::vector<char> payloads_;
+    std::vector<char> controls_;
+    std::vector<uint64_t> timestamps_;
+    size_t count_;
+
+  public:
+    ReceivedBatch( const size_t capacity, const size_t mtu = 65536 );
+
+    /* number of datagrams received */
+    size_t size( void ) const { return count_; }
+
+    /* accessors for the ith datagram */
+    Address source_address( const size_t i ) const;
+    uint64_t timestamp( const size_t i ) const { return timestamps_.at( i ); }
+    const char * payload( const size_t i ) const;
+    size_t payload_length( const size_t i ) const;
+
+    /* ban copying (the headers point into the buffers) */
+    ReceivedBatch( const ReceivedBatch & other ) = delete;
+    ReceivedBatch & operator=( const ReceivedBatch & other ) = delete;
+  };
+
+  /* receive as many datagrams as the batch holds
+     (waiting for the first, but not for the rest) */
+  void recv( ReceivedBatch & batch );
+
+  /* datagrams queued to be sent in one system call; each is copied
+     in (to buffers reused from one send() to the next), or only its
+     header is, and the rest is pointed to where the caller keeps it */
+  class SendBatch
+  {
+  private:
+    friend class UDPSocket;
+
+    std::vector<std::string> payloads_; /* or just the header */
+    std::vector<std::pair<const char *, size_t>> tails_; /* the rest, not copied */
+    std::vector<Address> destinations_; /* empty Address: the connected one */
+    std::vector<mmsghdr> headers_;
+    std::vector<iovec> iovecs_; /* two per datagram */
+    size_t count_;
+
+  public:
+    SendBatch( const size_t capacity );
+
+    size_t size( void ) const { return count_; }
+    bool full( void ) const { return count_ == payloads_.size(); }
+
+    /* queue a datagram to the connected address */
+    void push( const std::string & payload );
+
+    /* queue a datagram to a specified address */
+    void push( const Address & destination, const std::string & payload );
+
+    /* queue a datagram to the connected address, copying only its first
+       header_length bytes: the rest must stay as it is until send() */
+    void push( const std::string & datagram, const size_t header_length );
+
+    /* ban copying (the headers point into the buffers) */
+    SendBatch( const SendBatch & other ) = delete;
+    SendBatch & operator=( const SendBatch & other ) = delete;
+  };
+
+  /* send all the queued datagrams, and empty the batch */
+  void send( SendBatch & batch );
 };
 
 /* TCP socket */
@@ -0,0 +1,47 @@
+#include <cstring>
+#include <algorithm>
+
+#include <sys/timerfd.h>
+
+#include "timerfd.hh"
+#include "util.hh"
+
+using namespace std;
+
+/* nanoseconds per second */
+static const uint64_t BILLION = 1000000000;
+
+TimerFD::TimerFD()
+  : FileDescriptor( SystemCall( "timerfd_create",
+				timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC ) ) )
+{}
+
+/* become readable at the given time */
+void TimerFD::arm_at( const uint64_t deadline_ns )
+{
+  itimerspec setting;
+  zero( setting );
+
+  /* a zero it_value would disarm the timer */
+  const uint64_t deadline = max( deadline_ns, uint64_t( 1 ) );
+  setting.it_value.tv_sec = deadline / BILLION;
+  setting.it_value.tv_nsec = deadline % BILLION;
+
+  SystemCall( "timerfd_settime",
+	      timerfd_settime( fd_num(), TFD_TIMER_ABSTIME, &setting, nullptr ) );
+}
+
+/* consume the expirations since the last read */
+uint64_t TimerFD::read_expirations( void )
+{
+  const string expirations_str = read( sizeof( uint64_t ) );
+
+  if ( expirations_str.size() != sizeof( uint64_t ) ) {
+    throw runtime_error( "timerfd read size mismatch" );
+  }
+
+  uint64_t expirations;
+  memcpy( &expirations, expirations_str.data(), sizeof( expirations ) );
+
+  return expirations;
+}
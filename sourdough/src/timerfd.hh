@@ -0,0 +1,22 @@
+#ifndef TIMERFD_HH
+#define TIMERFD_HH
+
+#include <cstdint>
+
+#include "file_descriptor.hh"
+
+/* timer file descriptor on the monotonic clock, armed with
+   absolute deadlines in nanoseconds (see timestamp_ns()) */
+class TimerFD : public FileDescriptor
+{
+public:
+  TimerFD();
+
+  /* become readable at the given time */
+  void arm_at( const uint64_t deadline_ns );
+
+  /* consume the expirations since the last read */
+  uint64_t read_expirations( void );
+};
+
+#endif /* TIMERFD_HH */
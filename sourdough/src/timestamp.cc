@@ -34,3 +34,11 @@ uint64_t timestamp_ms( const timespec & ts )
   const static uint64_t EPOCH = timestamp_ms_raw( current_time() );
   return timestamp_ms_raw( ts ) - EPOCH;
 }
+
+/* Current time in nanoseconds on the monotonic clock */
+uint64_t timestamp_ns( void )
+{
+  timespec ts;
+  SystemCall( "clock_gettime", clock_gettime( CLOCK_MONOTONIC, &ts ) );
+  return ts.tv_sec * BILLION + ts.tv_nsec;
+}
@@ -8,4 +8,8 @@
 uint64_t timestamp_ms( void );
 uint64_t timestamp_ms( const timespec & ts );
 
+/* Current time in nanoseconds on the monotonic clock
+   (for timers, which must not jump with the wall clock) */
+uint64_t timestamp_ns( void );
+
 #endif /* TIMESTAMP_HH */